@@ -0,0 +1,61 @@
+#ifndef CHANGEQUEUE_H
+#define CHANGEQUEUE_H
+
+#include <mutex>
+#include <deque>
+#include <chrono>
+#include <functional>
+#include <yder.h>
+
+/* Time in microseconds the UI thread may spend applying changes each frame */
+#define CHANGEQUEUE_BUDGET_US	(2000)
+
+/* Statistics on how far behind the UI is on applying changes */
+struct changequeue_stats_t {
+	unsigned int backlog;			/* Batches waiting to be applied */
+	unsigned int max_backlog;		/* Largest backlog seen */
+	double avg_backlog;				/* Average backlog at the start of frames that had work */
+	unsigned long applied;			/* Total batches applied */
+	unsigned long frames;			/* Frames that applied at least one batch */
+	unsigned long over_budget;		/* Frames that ran past the budget */
+};
+
+/* Queue of changes prepared by background threads, to be applied on the UI
+ * thread a few at a time so that a large refresh is spread over several
+ * frames instead of stalling one */
+class Changequeue {
+
+	private:
+		struct batch_t {
+			const void* owner;				/* Object the change applies to */
+			std::function<void(void)> apply;	/* Apply change; runs on UI thread */
+			std::function<void(void)> discard;	/* Free change without applying */
+		};
+
+		/* Pending changes, in order */
+		std::deque<struct batch_t> queue;
+
+		/* Queue mutex */
+		std::mutex cmtx;
+
+		/* Backlog statistics */
+		struct changequeue_stats_t stats;
+
+		/* Internal functions; not thread safe */
+		void _sample( void );
+
+	public:
+		Changequeue();
+		~Changequeue();
+		int push( const void* owner, std::function<void(void)> apply, std::function<void(void)> discard );
+		unsigned int drain( std::chrono::microseconds budget );
+		unsigned int purge( const void* owner );
+		unsigned int backlog( void );
+		struct changequeue_stats_t get_stats( void );
+
+};
+
+/* Changes from database refreshes to the caches shown in the UI */
+extern class Changequeue cache_changes;
+
+#endif /* CHANGEQUEUE_H */
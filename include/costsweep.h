@@ -0,0 +1,48 @@
+#ifndef COSTSWEEP_H
+#define COSTSWEEP_H
+
+#include <vector>
+#include <yder.h>
+#include <db_handle.h>
+#include <part_funct.h>
+#include <proj_funct.h>
+#include <taskpool.h>
+
+/* Maximum number of unit counts evaluated in a sweep */
+#define COSTSWEEP_MAX_POINTS	(512)
+
+/* Minimum exploded lines given to each worker thread */
+#define COSTSWEEP_LINES_PER_THREAD	(64)
+
+/* Exact and optimal project cost over a range of unit counts. Exploded lines
+ * are split over the task pool, each chunk summing its share of the curve */
+class Costsweep {
+
+	private:
+		/* Unit counts, as doubles for plotting */
+		std::vector<double> units;
+
+		/* Total and per unit costs at each unit count */
+		std::vector<double> optimal;
+		std::vector<double> exact;
+		std::vector<double> optimal_per;
+		std::vector<double> exact_per;
+
+		/* What the current sweep was computed from */
+		struct proj_t* prj;
+		unsigned int prj_ipn;
+		unsigned long stamp;
+		unsigned int max_units;
+
+	public:
+		Costsweep();
+		~Costsweep();
+		int run( struct proj_t* p, unsigned int max );
+		unsigned int size( void );
+		const double* get_units( void );
+		const double* get_optimal( bool per_unit );
+		const double* get_exact( bool per_unit );
+
+};
+
+#endif /* COSTSWEEP_H */
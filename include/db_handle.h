@@ -30,6 +30,7 @@ struct dbinfo_ptype_t {
 /* Struct for overall database information */
 struct dbinfo_t {
 	uint32_t flags;					/* Option flags */
+	unsigned int rev;				/* Revision in database; used to detect concurrent writes */
 	unsigned int nprj;				/* Number of projects in database */
 	unsigned int nbom;				/* Number of boms in database */
 	unsigned int ninv;				/* Number of inventory locations */
@@ -47,6 +48,13 @@ struct dbinfo_t {
 #define DBINFO_FLAG_INIT_SHFT	0
 #define DBINFO_FLAG_LOCK_SHFT			1
 
+/* Returned by writes when the object was changed in the database after it was
+ * read. Caller should read the object again and retry */
+#define DB_ERR_CONFLICT		(-2)
+
+/* Most other part numbers offered when a part number search has no exact match */
+#define DB_PN_SUGGEST_MAX	(5)
+
 /* Key Value pair for part info*/
 struct part_info_t {
 	char* key;	
@@ -65,6 +73,22 @@ struct part_price_t {
 	double price;	/* Price in native currency. Dollars, need to figure out setting for this later */
 };
 
+/* Segment of compiled price curve, from this break up to the next one */
+struct part_price_break_t {
+	unsigned int quantity;	/* Break quantity */
+	double price;			/* Unit price in this segment */
+	unsigned int best_q;	/* Quantity of cheapest break at or above this one */
+	double best_cost;		/* Total cost of ordering best_q */
+};
+
+/* Price breaks of a part compiled into a piecewise cost function */
+struct part_price_curve_t {
+	unsigned int rev;					/* Part revision when compiled */
+	unsigned int len;					/* Number of breaks */
+	const struct part_price_t* src;		/* Price array compiled from */
+	struct part_price_break_t* brk;		/* Breaks sorted by quantity */
+};
+
 /* Key Value pair for inventory location quantities */
 struct part_inv_t {
 	unsigned int loc;	/* Location number */
@@ -86,6 +110,7 @@ enum part_status_t {
 /* Structure for parts */
 struct part_t {
 	unsigned int ipn;				/* Internal part number */
+	unsigned int rev;				/* Revision in database */
 	unsigned int q;					/* Quantity/Stock */
 	enum part_status_t status;		/* Part production status */
 	unsigned int info_len;			/* Number of key value pairs in info */
@@ -99,6 +124,9 @@ struct part_t {
 	struct part_dist_t* dist;		/* Key Value distributor info */
 	struct part_price_t* price;		/* Key Value price break info */
 	struct part_inv_t* inv;			/* Key Value inventory location info */
+	struct part_price_curve_t* curve;	/* Compiled price breaks. Not stored in database */
+	unsigned int refs;				/* Holders besides the first; freed when the last lets go. Not stored in database */
+	int shared;						/* Handle is in the shared part table. Not stored in database */
 };
 
 /* Structure for part number with qua*/
@@ -111,6 +139,7 @@ struct bom_line_t{
 /* Structure for bill of materials */
 struct bom_t {
 	unsigned int ipn;				/* BOM Internal Part Number */
+	unsigned int rev;				/* Revision in database */
 	unsigned int nitems;			/* Number of bom line items */
 	char* name;						/* Name/Title of BOM */
 	char* ver;						/* Version */
@@ -121,24 +150,63 @@ struct bom_t {
 /* For getting specific versions of BOM */
 struct proj_bom_ver_t{
 	char* ver;
+	unsigned int q;					/* Number of BOM sets per project unit */
 	struct bom_t* bom;
 };
 
 /* For getting specific versions of subprojects */
 struct proj_subprj_ver_t{
 	char* ver;
+	unsigned int q;					/* Number of subproject units per project unit */
 	struct proj_t* prj;
 };
 
+/* Single deduplicated part line of an exploded project */
+struct proj_flat_line_t{
+	unsigned int ipn;				/* Part IPN */
+	unsigned int q;					/* Quantity needed per project unit */
+	char* type;						/* Part type; points into bom line, not owned */
+	struct part_t* part;			/* Part handle; owned by project bom, not owned */
+};
+
+/* Project exploded through all BOMs and subprojects */
+struct proj_flat_t{
+	unsigned long stamp;			/* Combined revision of project tree and its parts when built */
+	unsigned int nlines;			/* Number of unique parts */
+	unsigned int total;				/* Total number of parts per project unit */
+	struct proj_flat_line_t* line;	/* Lines sorted by type, then ipn */
+};
+
+/* Buildable units of a project, solved from exploded project and inventory */
+struct proj_build_t{
+	unsigned long stamp;			/* Stamp of exploded project solved from */
+	unsigned int gen;				/* Incremented whenever stock changes */
+	unsigned int nlines;			/* Number of exploded lines */
+	unsigned int* stock;			/* Stock over all locations, per exploded line */
+	unsigned int* units;			/* Min tree of units buildable per line; leaves start at nlines */
+};
+
+/* Counters of an exploded project, filled in a single pass over its lines */
+struct proj_stats_t{
+	unsigned long stamp;			/* Stamp of exploded project counted from */
+	unsigned long part_stamp;		/* Combined revision of parts counted */
+	unsigned int nunique;			/* Number of unique parts */
+	unsigned int ntotal;			/* Total number of parts per project unit */
+	unsigned int nmissing;			/* Unique parts that could not be loaded */
+	unsigned int status[pstat_total];	/* Unique parts in each status */
+};
+
 /* Project flags */
 #define PROJ_FLAG_DIRTY				0x0001 /* Edited locally, should be pushed to database */
 #define PROJ_FLAG_STALE				0x0002 /* Data is old, should be refreshed */
+#define PROJ_FLAG_HYDRATED			0x0004 /* Exploded, solved and counted, or tried to be */
 
 /* Structure for project */
 struct proj_t {
 	int flags;						/* Project handling flags. Not stored in database */
 	int selected;					/* If selected in UI or not. Can't use bool because of c/c++ api differences */	
 	unsigned int ipn;				/* Internal part number */
+	unsigned int rev;				/* Revision in database */
 	int nsub;						/* Number of subprojects */
 	int nboms;						/* Number of boms in project */
 	time_t time_created;			/* Date stamp of when project was created */
@@ -149,11 +217,41 @@ struct proj_t {
 	char* author;					/* Author of project, maybe department? Could be useful for a number of things. */
 	struct proj_subprj_ver_t* sub;	/* Array of subprojects */
 	struct proj_bom_ver_t* boms;	/* BOMs for project with specific version */
+	struct proj_flat_t* flat;		/* Cached exploded BOM. Not stored in database */
+	struct proj_build_t* build;		/* Cached buildable units. Not stored in database */
+	struct proj_stats_t* stats;		/* Cached part counters. Not stored in database */
 };
 
-/* Create struct from parsed item in database, from part number */
+/* Pending change of stock for a single part at a single location */
+struct inv_delta_t {
+	char* type;						/* Part type */
+	unsigned int ipn;				/* Part internal part number */
+	unsigned int loc;				/* Inventory location number */
+	int delta;						/* Signed change in quantity */
+	int err;						/* Set when written; non-zero if delta was not applied */
+	int applied;					/* Set when written; change actually made after clamping at zero */
+};
+
+/* Stock change of a single part, read back from stock history */
+struct stock_event_t {
+	double t;						/* Time of change; seconds since epoch */
+	unsigned int ipn;				/* Part internal part number */
+	unsigned int loc;				/* Inventory location number */
+	int delta;						/* Change actually made */
+};
+
+/* Create struct from parsed item in database, from part number. Only a part
+ * with the whole part number, ignoring case, is returned */
 struct part_t* get_part_from_pn( const char* pn );
 
+/* Same as get_part_from_pn. If there is no exact match, part numbers of other
+ * parts the search found are put in suggest; caller frees them with
+ * free_pn_suggest */
+struct part_t* get_part_from_pn_suggest( const char* pn, char*** suggest, unsigned int* nsuggest );
+
+/* Free part numbers from get_part_from_pn_suggest */
+void free_pn_suggest( char** suggest, unsigned int n );
+
 /* Create part struct from parsed item in database, from internal part number */
 struct part_t* get_part_from_ipn( const char* type, unsigned int ipn );
 
@@ -172,9 +270,18 @@ struct proj_t* get_proj_from_ipn( unsigned int ipn, char* version );
 /* Create project struct from parsed item in database, from internal part number with latest project version */
 struct proj_t* get_latest_proj_from_ipn( unsigned int ipn );
 
-/* Free the part structure */
+/* Release part handle; the structure is freed once no one else holds it */
 void free_part_t( struct part_t* part );
 
+/* Take another reference to a part handle already held; release with
+ * free_part_t. Constant time, unlike copy_part_t */
+struct part_t* ref_part_t( struct part_t* part );
+
+/* Share freshly loaded part. If a handle for the same part, revision and data
+ * is already shared, part is released and a reference to that handle
+ * returned. Shared handles are read only; edit a copy_part_t instead */
+struct part_t* share_part_t( struct part_t* part );
+
 /* Free the part structure, don't touch the part passed as it should be an
  * address, not an allocated pointer */
 void free_part_addr_t( struct part_t* part );
@@ -191,6 +298,15 @@ void free_dbinfo_t( struct dbinfo_t* db );
 /* Write part to database */
 int redis_write_part( struct part_t* part );
 
+/* Apply inventory deltas to parts in database as a single pipelined batch.
+ * Uses a connection of its own, so it can be called from any thread */
+int redis_write_inv_deltas( struct inv_delta_t* deltas, unsigned int n );
+
+/* Read stock history of part type, oldest first. Changes written through
+ * redis_write_inv_deltas and redis_write_part are recorded. Uses a connection
+ * of its own, so it can be called from any thread. Caller frees events */
+int redis_read_stock_history( const char* type, struct stock_event_t** events, unsigned int* n );
+
 /* Copy part structure to new structure */
 struct part_t* copy_part_t( struct part_t* src );
 
@@ -212,6 +328,16 @@ struct dbinfo_t* redis_read_dbinfo( void );
 /* Write database information */
 int redis_write_dbinfo( struct dbinfo_t* db );
 
+/* Reserve block of n consecutive IPNs for a part type, adding the type to the
+ * database if it does not exist yet. First IPN of the block is put in first */
+int redis_alloc_part_ipn( const char* type, unsigned int n, unsigned int* first );
+
+/* Reserve next project IPN */
+int redis_alloc_proj_ipn( unsigned int* ipn );
+
+/* Reserve next BOM IPN */
+int redis_alloc_bom_ipn( unsigned int* ipn );
+
 /* Import file to database */
 int redis_import_part_file( char* filepath );
 
@@ -0,0 +1,58 @@
+#ifndef INVCOALESCE_H
+#define INVCOALESCE_H
+
+#include <mutex>
+#include <map>
+#include <tuple>
+#include <string>
+#include <chrono>
+#include <yder.h>
+#include <db_handle.h>
+#include <profiler.h>
+#include <taskpool.h>
+
+/* Time in milliseconds to hold inventory changes before writing them */
+#define INVCOALESCE_WINDOW_MS	(750)
+
+/* Inventory changes keyed by part type, ipn, and location */
+typedef std::map< std::tuple< std::string, unsigned int, unsigned int >, int > invcoalesce_map_t;
+
+/* Collects rapid inventory changes, merging them per part and location so
+ * that they can be written to the database together on the task pool */
+class Invcoalesce {
+
+	private:
+		/* Pending changes */
+		invcoalesce_map_t pending;
+
+		/* Batch is being written */
+		bool writing;
+
+		/* Pending changes mutex */
+		std::mutex cmtx;
+
+		/* Time that the oldest pending change was made */
+		std::chrono::steady_clock::time_point first;
+
+		/* Time to hold changes before writing */
+		std::chrono::milliseconds window;
+
+		/* Internal functions; not thread safe */
+		int _submit( void );
+		int _write( invcoalesce_map_t* batch );
+
+	public:
+		Invcoalesce( unsigned int window_ms );
+		~Invcoalesce();
+		unsigned int size( void );
+		int add( struct part_t* p, unsigned int loc, int delta );
+		int poll( void );
+		int start( void );
+		int flush( void );
+
+};
+
+/* Inventory changes made from the UI */
+extern class Invcoalesce inv_coalesce;
+
+#endif /* INVCOALESCE_H */
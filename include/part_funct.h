@@ -11,6 +11,13 @@ extern "C" {
 /* Determine total inventory amount for part */
 unsigned int get_part_total_inventory( struct part_t * p );
 
+/* Compile price breaks into a cost curve. Cached in the part; do not free */
+struct part_price_curve_t* get_part_price_curve( struct part_t * p );
+
+/* Evaluate cost curve for n quantities at once. Optimal amount, optimal cost
+ * and exact cost are written to whichever output arrays are not NULL */
+void eval_part_price_curve( const struct part_price_curve_t* c, const unsigned int* q, unsigned int n, unsigned int* amount, double* optimal, double* exact );
+
 /* Determine optimal order amount for cost reduction. Pass the amount to check
  * against (q) */
 unsigned int get_optimal_part_amount( struct part_t * p, unsigned int q );
@@ -23,6 +30,12 @@ double get_optimal_part_cost( struct part_t * p, unsigned int q );
  * against (q) */
 double get_exact_part_cost( struct part_t * p, unsigned int q );
 
+/* Parse engineering value such as "100nF", "4.7 kOhm" or "50V" into a number in
+ * base units and its unit without prefix, written to unit. Values without a
+ * unit give an empty unit. Returns 0 on success, -1 if s is not a number
+ * optionally followed by a unit */
+int parse_si_value( const char* s, double* value, char* unit, size_t unit_len );
+
 #ifdef __cplusplus
 }
 #endif
@@ -6,7 +6,11 @@
 #include <string>
 #include <yder.h>
 #include <db_handle.h>
+#include <changequeue.h>
+#include <profiler.h>
 
+/* Number of parts handed to the UI thread in each change batch */
+#define PARTCACHE_BATCH_SIZE	(64)
 
 class Partcache {
 
@@ -23,6 +27,12 @@ class Partcache {
 		/* Selected project; Used for UI. Better to keep it here, as it becomes
 		 * thread safe then */
 		struct part_t* selected;	
+
+		/* IPN of selected part while it is being replaced by a refresh */
+		unsigned int pending_sel_ipn;
+
+		/* Incremented every time a refresh has been fully applied */
+		unsigned int gen;
 		
 		/* Internal functions; not thread safe */
 		int _write( struct part_t * p, unsigned int index );
@@ -34,6 +44,8 @@ class Partcache {
 		int _append_ipn( unsigned int ipn );
 		int _remove( unsigned int index );
 		void _DisplayNode( struct part_t* node );
+		void _apply( unsigned int start, std::vector<struct part_t*>* batch );
+		void _commit( unsigned int size );
 
 	public:
 		std::string type;
@@ -41,6 +53,7 @@ class Partcache {
 		Partcache( unsigned int size, std::string init_type );
 		~Partcache();
 		unsigned int items(void);
+		unsigned int generation(void);
 		int update( struct dbinfo_t** info );
 		int write( struct part_t * p, unsigned int index );
 		struct part_t* read( unsigned int index );
@@ -0,0 +1,92 @@
+#ifndef PARTINDEX_H
+#define PARTINDEX_H
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <yder.h>
+#include <db_handle.h>
+#include <partcache.h>
+
+/* Maximum part number suggestions shown for a BOM line */
+#define PARTINDEX_SUGGEST_MAX	(5)
+
+/* Fields part number lookups can match; combine as a mask */
+enum partindex_field_t {
+	pidx_mpn = 1,					/* Manufacturer part number */
+	pidx_mfg = 2,					/* Manufacturer */
+	pidx_dist = 4,					/* Distributor part numbers */
+	pidx_pn = pidx_mpn | pidx_dist
+};
+
+/* Whole field of a document, for exact and prefix lookup */
+struct partindex_term_t {
+	std::string key;				/* Lower case field value */
+	unsigned int doc;				/* Document in segment */
+	int field;						/* Field value came from */
+};
+
+/* Part in the index */
+struct partindex_doc_t {
+	class Partcache* cache;			/* Part type cache holding the part */
+	unsigned int idx;				/* Index of part in its cache */
+};
+
+/* Index of a single part type cache; rebuilt when the cache generation
+ * changes */
+struct partindex_seg_t {
+	class Partcache* cache;
+	unsigned int gen;				/* Cache generation indexed */
+	unsigned int items;				/* Cache items when indexed */
+	std::vector<unsigned int> idx;	/* Cache index of each document */
+	std::vector<std::string> text;	/* Lower case searchable text of each document */
+	std::unordered_map<unsigned int, std::vector<unsigned int>> post;	/* Documents of each trigram, ascending */
+	std::vector<struct partindex_term_t> terms;	/* Whole fields, sorted by key */
+};
+
+/* Case insensitive substring filter over every loaded part. Searches mpn,
+ * manufacturer, distributor part numbers and info values through a trigram
+ * index. A query that extends the previous one only rechecks its results, so
+ * typing narrows without going back to the index. Whole mpn, manufacturer and
+ * distributor part numbers are also kept sorted, for exact and prefix lookup
+ * of part numbers without the database. Used from the UI thread only */
+class Partindex {
+
+	private:
+		/* One segment per part type cache */
+		std::vector<struct partindex_seg_t> segs;
+
+		/* First document id of each segment */
+		std::vector<unsigned int> base;
+
+		/* Incremented whenever a segment is rebuilt */
+		unsigned int gen;
+
+		/* Last query and its matches, for narrowing */
+		std::string last_query;
+		unsigned int last_gen;
+		bool have_last;
+		std::vector<unsigned int> last_hits;
+
+		/* Internal functions */
+		void _build( struct partindex_seg_t* seg );
+		const std::string* _text( unsigned int id );
+		void _search( const std::string& q, std::vector<unsigned int>* hits );
+
+	public:
+		Partindex();
+		~Partindex();
+		int update( std::vector<class Partcache*>* caches );
+		unsigned int generation( void );
+		unsigned int docs( void );
+		int doc( unsigned int id, struct partindex_doc_t* d );
+		const std::vector<unsigned int>* query( const char* text );
+		unsigned int lookup( const char* key, int fields, bool prefix, std::vector<struct partindex_doc_t>* hits, unsigned int max );
+		struct part_t* find_pn( const char* pn );
+
+};
+
+/* Index behind the part filter */
+extern class Partindex part_index;
+
+#endif /* PARTINDEX_H */
@@ -0,0 +1,91 @@
+#ifndef PARTPARAM_H
+#define PARTPARAM_H
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <yder.h>
+#include <db_handle.h>
+#include <part_funct.h>
+#include <partindex.h>
+
+/* Longest unit kept for a numeric column */
+#define PARTPARAM_UNIT_LEN	(32)
+
+/* Relative difference still counted as equal for numeric values */
+#define PARTPARAM_EQ_TOL	(1e-6)
+
+/* Info values of one key and unit in base units, for every document */
+struct partparam_num_t {
+	std::string key;				/* Lower case info key */
+	std::string unit;				/* Unit without prefix; empty if unitless */
+	std::vector<double> val;		/* Value of each document; NaN if it has none */
+};
+
+/* Info values of one key as written, for every document. Values are
+ * dictionary encoded so equality is a compare of codes */
+struct partparam_str_t {
+	std::string key;				/* Lower case info key */
+	std::vector<unsigned int> code;	/* Value of each document; 0 if it has none */
+	std::unordered_map<std::string, unsigned int> dict;	/* Lower case value to code */
+};
+
+/* Single condition of a parametric query */
+struct partparam_term_t {
+	std::string key;				/* Lower case info key; empty for any key */
+	bool numeric;					/* Range on numeric columns, else equality on values */
+	double lo;						/* Inclusive range, in base units */
+	double hi;
+	std::string unit;				/* Unit numeric columns must have */
+	std::string text;				/* Lower case value for equality */
+};
+
+/* Parametric search over part info. Every info value is kept in a column per
+ * key; values with an SI prefixed unit are also kept as numbers in base units,
+ * in a column per key and unit. Queries are a comma separated list of terms,
+ * all of which must hold, like "90-110 nF, 0603, >=25 V" or "Package: 0805".
+ * Each term is checked with a straight scan over the columns it applies to.
+ * Document ids are those of the part index. Used from the UI thread only */
+class Partparam {
+
+	private:
+		/* Columns, and where to find them */
+		std::vector<struct partparam_num_t> nums;
+		std::vector<struct partparam_str_t> strs;
+		std::unordered_map<std::string, unsigned int> num_by_id;
+		std::unordered_map<std::string, unsigned int> str_by_key;
+		unsigned int ndocs;
+
+		/* Part index generation columns were built from */
+		unsigned int index_gen;
+		bool have_gen;
+
+		/* Last query and its matches */
+		std::string last_query;
+		std::string last_err;
+		unsigned int last_gen;
+		bool have_last;
+		std::vector<unsigned int> last_hits;
+
+		/* Scan buffers; one flag per document */
+		std::vector<unsigned char> match;
+		std::vector<unsigned char> term_match;
+
+		/* Internal functions */
+		void _add( unsigned int doc, const std::string& key, const char* val );
+		int _parse( const std::string& text, struct partparam_term_t* t );
+		void _scan( const struct partparam_term_t* t );
+
+	public:
+		Partparam();
+		~Partparam();
+		int update( class Partindex* index );
+		unsigned int columns( void );
+		const std::vector<unsigned int>* query( const char* text, const std::string** err );
+
+};
+
+/* Parametric search behind the part filter */
+extern class Partparam part_param;
+
+#endif /* PARTPARAM_H */
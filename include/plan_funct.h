@@ -0,0 +1,76 @@
+#ifndef PLAN_FUNCT_H
+#define PLAN_FUNCT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <db_handle.h>
+#include <yder.h>
+
+/* Single build in a production plan */
+struct plan_build_t {
+	struct proj_t* prj;				/* Project to build; owned by caller */
+	unsigned int units;				/* Units wanted */
+	unsigned int nbuild;			/* Set by planner: units buildable with allocated stock */
+	unsigned int nshort;			/* Set by planner: number of parts short for wanted units */
+};
+
+/* Part used by any build in a production plan */
+struct plan_line_t {
+	unsigned int ipn;				/* Part IPN */
+	char* type;						/* Part type; owned by project */
+	struct part_t* part;			/* Part handle; owned by project */
+	unsigned int stock;				/* Stock over all locations */
+	unsigned int demand;			/* Quantity needed by all builds */
+	unsigned int alloc;				/* Stock allocated to builds */
+	unsigned int shortage;			/* Quantity missing to cover all builds */
+	unsigned int order_q;			/* Quantity to purchase; may round up to a cheaper break */
+	double order_cost;				/* Cost of purchasing order_q */
+	double separate_cost;			/* Cost if each build purchased its own shortage */
+	unsigned int short_start;		/* First entry for this part in plan shorts */
+	unsigned int short_len;			/* Number of builds short of this part */
+};
+
+/* Shortage of a single part for a single build */
+struct plan_short_t {
+	unsigned int line;				/* Index of part in plan lines */
+	unsigned int build;				/* Index of build */
+	unsigned int q;					/* Quantity short */
+};
+
+/* Result of planning builds against shared stock */
+struct plan_t {
+	unsigned int nbuilds;			/* Number of builds planned */
+	struct plan_build_t* builds;	/* Builds in priority order; owned by caller */
+	unsigned int nlines;			/* Number of unique parts over all builds */
+	struct plan_line_t* line;		/* Parts sorted by type, then ipn */
+	unsigned int nshorts;			/* Number of per build shortages */
+	struct plan_short_t* shorts;	/* Per build shortages, grouped by part */
+	unsigned int nshort;			/* Number of parts to purchase */
+	double purchase_cost;			/* Total cost of consolidated purchase list */
+	double separate_cost;			/* Total cost if every build purchased on its own */
+};
+
+/* Plan builds against shared stock. Builds are given stock in order, so the
+ * first build has the highest priority. Purchases are not priced until
+ * plan_purchase or plan_purchase_lines is called */
+struct plan_t* plan_builds( struct plan_build_t* builds, unsigned int nbuilds );
+
+/* Price purchase for plan lines [start, end). Ranges can be run in parallel */
+int plan_purchase_lines( struct plan_t* plan, unsigned int start, unsigned int end );
+
+/* Total up purchase once all lines have been priced */
+int plan_purchase_total( struct plan_t* plan );
+
+/* Price and total up purchase for whole plan */
+int plan_purchase( struct plan_t* plan );
+
+/* Free the plan structure; builds and projects are not touched */
+void free_plan_t( struct plan_t* plan );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PLAN_FUNCT_H */
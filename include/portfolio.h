@@ -0,0 +1,112 @@
+#ifndef PORTFOLIO_H
+#define PORTFOLIO_H
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <yder.h>
+#include <db_handle.h>
+#include <part_funct.h>
+#include <proj_funct.h>
+#include <prjcache.h>
+#include <taskpool.h>
+
+/* Projects computed by each task on the task pool */
+#define PORTFOLIO_PROJECTS_PER_TASK	(2)
+
+/* Analytics of a single project in the portfolio */
+struct portfolio_row_t {
+	struct proj_t* prj;				/* Project in cache; not owned */
+	unsigned int ipn;				/* Project IPN */
+	std::string pn;					/* Project part number */
+	std::string name;				/* Project name */
+	std::string ver;				/* Project version */
+	unsigned long stamp;			/* Exploded project stamp results are from */
+	unsigned int gen;				/* Build solver generation results are from */
+	bool valid;						/* Results are computed */
+	bool busy;						/* Project or its results are being computed */
+	unsigned int nlines;			/* Unique parts in exploded project */
+	double optimal_cost;			/* Optimal cost of target units */
+	double exact_cost;				/* Exact cost of target units */
+	unsigned int nbuild;			/* Units buildable with current inventory */
+	unsigned int nshort;			/* Parts short for target units */
+	unsigned int status[pstat_total];	/* Unique parts in each status */
+};
+
+/* Stock change waiting to be applied to every project */
+struct portfolio_stock_t {
+	std::string type;
+	unsigned int ipn;
+	unsigned int stock;
+};
+
+/* Project handed to the task pool. Lines are copied with their own part
+ * references, so the project can change or go away while it is computed */
+struct portfolio_job_t {
+	struct proj_t* prj;				/* Project copied from; only compared */
+	unsigned int ipn;				/* Project IPN */
+	unsigned long stamp;			/* Exploded project stamp copied */
+	unsigned int gen;				/* Build solver generation copied */
+	unsigned int units;				/* Units results are computed for */
+	struct proj_flat_t flat;		/* Copy of exploded lines; types not copied */
+	std::vector<unsigned int> stock;	/* Stock per exploded line */
+	unsigned int status[pstat_total];	/* Unique parts in each status */
+	double optimal_cost;			/* Results filled in on the task pool */
+	double exact_cost;
+	unsigned int nbuild;
+	unsigned int nshort;
+};
+
+/* Cost, buildability and part status of every project in the project cache.
+ * Projects are computed on the task pool and the results swapped in on the UI
+ * thread through cache_changes. Only projects whose exploded BOM or build
+ * solver changed are computed again */
+class Portfolio {
+
+	private:
+		/* Results in cache order */
+		std::vector<struct portfolio_row_t> rows;
+
+		/* Stock changes not yet applied, and their mutex */
+		std::vector<struct portfolio_stock_t> pending;
+		std::mutex pending_mtx;
+
+		/* What the current results were computed for */
+		unsigned int cache_gen;
+		unsigned int target;
+		bool have_gen;
+
+		/* Rollup tasks not swapped in yet, and projects still hydrating */
+		unsigned int nrunning;
+		unsigned int nwaiting;
+
+		/* Totals over all projects */
+		double optimal_total;
+		unsigned int nshort_prj;
+		unsigned int status_total[pstat_total];
+
+		/* Internal functions */
+		int _copy( struct portfolio_job_t* job, struct proj_t* p, struct proj_flat_t* flat, struct proj_build_t* build );
+		void _compute( struct portfolio_job_t* job );
+		void _done( std::vector<struct portfolio_job_t>* jobs );
+		void _totals( void );
+		void _match( class Prjcache* cache );
+
+	public:
+		Portfolio();
+		~Portfolio();
+		int update( class Prjcache* cache, unsigned int units, bool force );
+		void stock_changed( const char* type, unsigned int ipn, unsigned int stock );
+		unsigned int size( void );
+		const struct portfolio_row_t* row( unsigned int index );
+		unsigned int get_units( void );
+		double get_optimal_total( void );
+		unsigned int get_nshort_projects( void );
+		const unsigned int* get_status_mix( void );
+
+};
+
+/* Portfolio shown in the portfolio window; stock changes are sent here */
+extern class Portfolio portfolio;
+
+#endif /* PORTFOLIO_H */
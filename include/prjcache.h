@@ -2,10 +2,31 @@
 #define PRJCACHE_H
 
 #include <mutex>
+#include <atomic>
 #include <vector>
+#include <set>
 #include <yder.h>
 #include <db_handle.h>
+#include <proj_funct.h>
+#include <changequeue.h>
+#include <taskpool.h>
+#include <profiler.h>
 
+/* Number of projects handed to the UI thread in each change batch */
+#define PRJCACHE_BATCH_SIZE	(16)
+
+/* Most projects hydrated ahead of selection at once */
+#define PRJCACHE_PREFETCH_MAX	(2)
+
+/* Steps in hydrating a project: explode, solve, count */
+#define PRJCACHE_HYDRATE_STEPS	(3)
+
+/* Project being hydrated on the task pool */
+struct prjcache_hydrate_t {
+	struct proj_t* prj;				/* Project hydrated; only retired while running */
+	std::atomic<unsigned int> step;	/* Steps finished */
+	bool prefetch;					/* Started by hovering instead of selection */
+};
 
 class Prjcache {
 
@@ -22,6 +43,28 @@ class Prjcache {
 		/* Selected project; Used for UI. Better to keep it here, as it becomes
 		 * thread safe then */
 		struct proj_t* selected;	
+
+		/* IPN of selected project while it is being replaced by a refresh */
+		unsigned int pending_sel_ipn;
+
+		/* Index selected before its project was loaded */
+		unsigned int pending_sel_idx;
+
+		/* Incremented every time a refresh has been fully applied */
+		unsigned int gen;
+
+		/* Hydrations on the task pool, and projects replaced while one of
+		 * them was still reading the tree */
+		std::vector<struct prjcache_hydrate_t*> hydrating;
+		std::vector<struct proj_t*> retired;
+
+		/* Hydration tasks not finished yet */
+		std::atomic<unsigned int> nrunning;
+
+		/* IPNs of projects hydrated before, so refreshes bring them in
+		 * hydrated, and their mutex */
+		std::set<unsigned int> keep_ipn;
+		std::mutex keep_mtx;
 		
 		/* Internal functions; not thread safe */
 		int _write( struct proj_t * p, unsigned int index );
@@ -33,12 +76,22 @@ class Prjcache {
 		int _append_ipn( unsigned int ipn );
 		int _remove( unsigned int index );
 		void _DisplayNode( struct proj_t* node );
+		void _apply( unsigned int start, std::vector<struct proj_t*>* batch );
+		void _commit( unsigned int size );
+		void _release( struct proj_t* p );
+		void _reap( void );
+		bool _ready( struct proj_t* p );
+		struct prjcache_hydrate_t* _find_hydrate( struct proj_t* p );
+		int _hydrate( struct proj_t* p, bool prefetch );
+		void _hydrate_done( struct prjcache_hydrate_t* job, struct proj_hydrate_t* h );
+		void _hydrate_kept( struct proj_t* p );
 
 	public:
 
 		Prjcache( unsigned int size );
 		~Prjcache();
 		unsigned int items(void);
+		unsigned int generation(void);
 		int update( struct dbinfo_t** info );
 		int write( struct proj_t * p, unsigned int index );
 		struct proj_t* read( unsigned int index );
@@ -54,6 +107,10 @@ class Prjcache {
 		struct proj_t* get_selected( void );
 		void display_projects( bool all_prj );
 
+		/* Exploding, solving and counting projects off the UI thread */
+		int hydrate( struct proj_t* p );
+		float hydrate_progress( struct proj_t* p );
+
 		/* Acess cache mutex */
 		bool getmutex( bool blocking );
 		void releasemutex( void );
@@ -0,0 +1,94 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+/* Frame profiler; built in with PROFILE=1, otherwise every macro below is
+ * empty and nothing is compiled in */
+
+/* Scopes timed by the profiler */
+enum prof_scope_t {
+	prof_frame,						/* Whole frame, without waiting for events */
+	prof_changes,					/* Applying refreshed cache data */
+	prof_menu,						/* Menu bar */
+	prof_projects,					/* Project view */
+	prof_parts,						/* Part view */
+	prof_windows,					/* Planner, portfolio and other windows */
+	prof_rollup,					/* Project cost and build calculations */
+	prof_cache_read,				/* Reads from project and part caches */
+	prof_lock_wait,					/* Waiting for cache mutexes */
+	prof_db,						/* Database reads and writes */
+	prof_render,					/* ImGui render and draw calls */
+	prof_total
+};
+
+#ifdef PROFILER_ENABLE
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+/* Number of frames kept for plotting */
+#define PROFILER_FRAMES	(600)
+
+/* Collects time spent in each scope from any thread, and keeps a history of
+ * the last frames for plotting */
+class Profiler {
+
+	private:
+		/* Time in nanoseconds and calls this frame, per scope */
+		std::atomic<unsigned long long> acc[prof_total];
+		std::atomic<unsigned int> calls[prof_total];
+
+		/* History in milliseconds, per scope; ring buffers written by the UI
+		 * thread only */
+		std::vector<double> hist[prof_total];
+		std::vector<unsigned int> hist_calls[prof_total];
+		unsigned int head;
+		unsigned int nframes;
+		bool paused;
+
+		/* Start of current frame */
+		std::chrono::steady_clock::time_point frame_start;
+
+	public:
+		Profiler();
+		~Profiler();
+		void add( enum prof_scope_t scope, unsigned long long ns );
+		void frame_begin( void );
+		void frame_end( void );
+		void window( bool* show );
+
+};
+
+/* Times a scope from construction to destruction */
+class Profscope {
+
+	private:
+		enum prof_scope_t scope;
+		std::chrono::steady_clock::time_point start;
+
+	public:
+		Profscope( enum prof_scope_t s );
+		~Profscope();
+
+};
+
+/* Profiler for the whole program */
+extern class Profiler profiler;
+
+#define PROF_CAT_( a, b )		a##b
+#define PROF_CAT( a, b )		PROF_CAT_( a, b )
+#define PROF_SCOPE( s )			class Profscope PROF_CAT( prof_scope_, __LINE__ )( s )
+#define PROF_FRAME_BEGIN()		profiler.frame_begin()
+#define PROF_FRAME_END()		profiler.frame_end()
+#define PROF_WINDOW( show )		profiler.window( show )
+
+#else
+
+#define PROF_SCOPE( s )
+#define PROF_FRAME_BEGIN()
+#define PROF_FRAME_END()
+#define PROF_WINDOW( show )
+
+#endif /* PROFILER_ENABLE */
+
+#endif /* PROFILER_H */
@@ -8,6 +8,41 @@ extern "C" {
 #include <db_handle.h>
 #include <yder.h>
 
+/* Part without enough stock to build a target number of units */
+struct proj_shortfall_t {
+	struct part_t* part;			/* Part handle; owned by project */
+	char* type;						/* Part type; owned by project */
+	unsigned int ipn;				/* Part IPN */
+	unsigned int need;				/* Quantity needed for target */
+	unsigned int have;				/* Stock over all locations */
+};
+
+/* Exploded project, build solver and part counters prepared without touching
+ * the project, so they can be built on another thread and attached later */
+struct proj_hydrate_t {
+	struct proj_t* prj;				/* Project hydrated; not owned */
+	unsigned int nsub;				/* Number of subprojects exploded */
+	struct proj_t** sub;			/* Subproject of each explosion; not owned */
+	struct proj_flat_t** subflat;	/* Explosion of each subproject */
+	struct proj_flat_t* flat;		/* Explosion of project */
+	struct proj_build_t* build;		/* Build solver of project */
+	struct proj_stats_t* stats;		/* Part counters of project */
+};
+
+/* Compare exploded lines by part type, then ipn; qsort/bsearch compatible */
+int cmp_proj_flat_line( const void* a, const void* b );
+
+/* Explode project through all BOMs and subprojects into deduplicated part
+ * lines per unit. Cached in the project; do not free */
+struct proj_flat_t* get_proj_flat( struct proj_t * p );
+
+/* Flatten single BOM into deduplicated part lines per BOM set. Lines point
+ * into the BOM; free with free_proj_flat_t */
+struct proj_flat_t* get_bom_flat( struct bom_t* bom );
+
+/* Free flattened BOM; lines are not owned, so the BOM is not touched */
+void free_proj_flat_t( struct proj_flat_t* flat );
+
 /* Get number of unique items in project BOM and subprojects */
 unsigned int get_num_all_uniq_proj_items( struct proj_t * p );
 
@@ -17,21 +52,61 @@ unsigned int get_num_all_proj_type_items( struct proj_t * p, char * ptype );
 /* Get number of total parts used in project */
 unsigned int get_num_all_proj_items( struct proj_t * p );
 
-/* Return the first part that is the limiting factor for production */
+/* Solve buildable units from exploded project and inventory. Cached in the
+ * project; do not free */
+struct proj_build_t* get_proj_build( struct proj_t* p );
+
+/* Update stock of single part in build solver. Returns 1 if part is not used */
+int update_proj_build_stock( struct proj_t* p, const char* type, unsigned int ipn, unsigned int stock );
+
+/* Return parts that bind the number of buildable units; NULL terminated */
 struct part_t ** get_proj_prod_lim_factor( struct proj_t* p );
 
 /* Determine number of units that can be manufacturered with current inventory */
 unsigned int get_proj_prod_nunit( struct proj_t* p );
 
+/* Get parts with too little stock to build target units; returns number short */
+unsigned int get_proj_prod_shortfall( struct proj_t* p, unsigned int target, struct proj_shortfall_t** short_parts );
+
 /* Get optimal project cost with number of units passed */
 double get_optimal_project_cost( struct proj_t * p, unsigned int units );
 
 /* Get exact project cost with number of units passed */
 double get_exact_project_cost( struct proj_t * p, unsigned int units );
 
+/* Add exact and optimal cost of exploded lines [start, end) at each of n unit
+ * counts to the optimal and exact arrays */
+int sum_proj_flat_cost( struct proj_flat_t* flat, unsigned int start, unsigned int end, const unsigned int* units, unsigned int n, double* optimal, double* exact );
+
+/* Get optimal and exact project cost for each of n unit counts */
+int get_project_cost_sweep( struct proj_t * p, const unsigned int* units, unsigned int n, double* optimal, double* exact );
+
+/* Count parts of exploded project by status in a single pass. Cached in the
+ * project and counted again only when the project or its parts change; do
+ * not free */
+struct proj_stats_t* get_proj_stats( struct proj_t* p );
+
 /* Retrieve total number of supplied part status */
 unsigned int get_num_proj_partstatus( struct proj_t * p, enum part_status_t status );
 
+/* Explode project and its subprojects without writing to any of them. Only
+ * reads the tree, so can run on another thread as long as the tree is not
+ * freed. Returns NULL on failure */
+struct proj_hydrate_t* hydrate_proj_flat( struct proj_t* p );
+
+/* Solve buildable units of hydrated project. Only reads the parts */
+int hydrate_proj_build( struct proj_hydrate_t* h );
+
+/* Count parts of hydrated project by status. Only reads the parts */
+int hydrate_proj_stats( struct proj_hydrate_t* h );
+
+/* Attach hydrated results to the project and its subprojects; must not race
+ * anything else using them. Whatever is attached is taken out of h */
+int attach_proj_hydrate( struct proj_hydrate_t* h );
+
+/* Free hydration results; the projects are not touched */
+void free_proj_hydrate_t( struct proj_hydrate_t* h );
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,75 @@
+#ifndef STOCKHIST_H
+#define STOCKHIST_H
+
+#include <vector>
+#include <string>
+#include <yder.h>
+#include <db_handle.h>
+#include <part_funct.h>
+#include <partcache.h>
+#include <taskpool.h>
+#include <changequeue.h>
+
+/* Stock level over time as points of a step line, with the downsampled view
+ * last drawn */
+struct stockhist_series_t {
+	std::vector<double> t;			/* Time of each point; seconds since epoch */
+	std::vector<double> q;			/* Stock at each point */
+	std::vector<double> view_t;		/* Downsampled points to draw */
+	std::vector<double> view_q;
+	double view_min;				/* Time range view was made for */
+	double view_max;
+	unsigned int view_width;		/* Pixel width view was made for */
+	bool view_valid;
+};
+
+/* Stock level history of a part type and of a single part in it. Levels are
+ * worked back from current stock through the recorded changes, so stock set
+ * before history was recorded shows up as a step at the start of it. History
+ * is read on the task pool and swapped in through cache_changes. Used from the
+ * UI thread only */
+class Stockhist {
+
+	private:
+		/* Part type loaded, and its changes oldest first */
+		std::string type;
+		std::vector<struct stock_event_t> events;
+		bool loaded;
+
+		/* Read in progress; only the last one started is swapped in */
+		bool loading;
+		unsigned int load_seq;
+
+		/* Level of whole part type */
+		struct stockhist_series_t type_series;
+
+		/* Level of single part, and what it was built for */
+		struct stockhist_series_t part_series;
+		unsigned int part_ipn;
+		unsigned int part_stock;
+		bool have_part;
+
+		/* Internal functions */
+		void _steps( bool all, unsigned int ipn, long long stock, struct stockhist_series_t* s );
+		void _loaded( unsigned int seq, bool ok, struct stock_event_t* ev, unsigned int n, long long stock );
+
+	public:
+		Stockhist();
+		~Stockhist();
+		int load( class Partcache* cache );
+		int set_part( struct part_t* p );
+		bool is_loaded( void );
+		bool is_loading( void );
+		const std::string& get_type( void );
+		unsigned int size( void );
+		struct stockhist_series_t* get_type_series( void );
+		struct stockhist_series_t* get_part_series( void );
+
+};
+
+/* Downsample series to the points inside [x_min, x_max] with at most width
+ * points, using Largest-Triangle-Three-Buckets. Only redone when the range or
+ * width changed. Returns number of points in the view */
+unsigned int stockhist_view( struct stockhist_series_t* s, double x_min, double x_max, unsigned int width );
+
+#endif /* STOCKHIST_H */
@@ -0,0 +1,22 @@
+#ifndef TABLESORT_H
+#define TABLESORT_H
+
+#include <vector>
+#include <functional>
+#include <imgui.h>
+#include <yder.h>
+#include <taskpool.h>
+
+/* Tables with at least this many rows are sorted on the task pool */
+#define TABLESORT_PARALLEL_MIN	(8192)
+
+/* Compare rows a and b on a single column; negative, zero or positive. Called
+ * from several threads for large tables, so must only read row data */
+typedef std::function<int(unsigned int a, unsigned int b, int column)> tablesort_cmp_t;
+
+/* Fill perm with the display order of n rows, sorted by every column in the
+ * table sort specs. Sort is stable, so rows equal on every column stay in row
+ * order. Rows themselves are never moved */
+void tablesort_perm( std::vector<unsigned int>* perm, unsigned int n, const ImGuiTableSortSpecs* specs, tablesort_cmp_t cmp );
+
+#endif /* TABLESORT_H */
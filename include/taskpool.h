@@ -0,0 +1,50 @@
+#ifndef TASKPOOL_H
+#define TASKPOOL_H
+
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+#include <yder.h>
+
+/* Worker threads kept for analytics; 0 uses one per hardware thread */
+#define TASKPOOL_THREADS	(0)
+
+/* Fixed set of worker threads for splitting analytics work over parts and
+ * projects. Workers are started on first use */
+class Taskpool {
+
+	private:
+		/* Worker threads */
+		std::vector<std::thread> workers;
+
+		/* Tasks waiting for a worker */
+		std::deque< std::function<void(void)> > tasks;
+
+		/* Queue mutex and signal for workers */
+		std::mutex cmtx;
+		std::condition_variable cv;
+
+		/* Requested number of workers, and set when shutting down */
+		unsigned int nthreads;
+		bool stop;
+
+		/* Internal functions; not thread safe */
+		void _start( void );
+		void _worker( void );
+
+	public:
+		Taskpool( unsigned int threads );
+		~Taskpool();
+		unsigned int size( void );
+		int submit( std::function<void(void)> task );
+		void parallel_for( unsigned int n, unsigned int min_chunk, std::function<void(unsigned int, unsigned int)> fn );
+
+};
+
+/* Workers shared by analytics */
+extern class Taskpool task_pool;
+
+#endif /* TASKPOOL_H */
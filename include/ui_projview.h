@@ -9,8 +9,24 @@
 #include <misc/cpp/imgui_stdlib.h>
 #include <prjcache.h>
 #include <proj_funct.h>
+#include <invcoalesce.h>
+#include <costsweep.h>
+#include <plan_funct.h>
+#include <taskpool.h>
+#include <portfolio.h>
+#include <tablesort.h>
+#include <profiler.h>
+#include <string>
 
 void show_project_view( int * db_stat, struct dbinfo_t** info, bool show_all_projects, class Prjcache* cache, ImGuiTableFlags table_flags );
-void partinfo_window( struct dbinfo_t** info, struct part_t* selected_item);
+/* Returns true if stock of part was changed, in which case selected_item is
+ * swapped for a handle holding the new stock */
+bool partinfo_window( struct dbinfo_t** info, struct part_t** selected_item);
+
+/* Plan several project builds against shared stock */
+void planner_window( bool* show, class Prjcache* cache );
+
+/* Cost, buildability and part status of every loaded project */
+void portfolio_window( bool* show, class Prjcache* cache );
 
 #endif /* UI_PROJVIEW_H */
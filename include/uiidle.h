@@ -0,0 +1,47 @@
+#ifndef UIIDLE_H
+#define UIIDLE_H
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <yder.h>
+
+/* Longest time in seconds the UI sleeps without an event before drawing */
+#define UIIDLE_TIMEOUT_S	(1.0)
+
+/* Sleep in seconds while background work is waiting on a timer */
+#define UIIDLE_BUSY_TIMEOUT_S	(0.1)
+
+/* Time in milliseconds to keep drawing at full rate after input or a wake up,
+ * so hover, popups and animations can settle */
+#define UIIDLE_ACTIVE_MS	(500)
+
+/* Decides whether the UI thread draws continuously or sleeps until input or
+ * a background thread has something to show */
+class Uiidle {
+
+	private:
+		/* Set by background threads; cleared when the UI thread sees it */
+		std::atomic<bool> woken;
+
+		/* Window exists, so empty events can be posted, and its mutex */
+		bool ready;
+		std::mutex ready_mtx;
+
+		/* Draw at full rate until this time */
+		std::chrono::steady_clock::time_point active_until;
+
+	public:
+		Uiidle();
+		~Uiidle();
+		void set_ready( bool r );
+		void wake( void );
+		void active( void );
+		void wait( double timeout );
+
+};
+
+/* Idle control of the main UI loop */
+extern class Uiidle ui_idle;
+
+#endif /* UIIDLE_H */
@@ -0,0 +1,140 @@
+#include <changequeue.h>
+#include <uiidle.h>
+
+/* Changes from database refreshes to the caches shown in the UI */
+class Changequeue cache_changes;
+
+/* Private functions for operations; NOT THREAD SAFE. USE MUTEX IN CALLED
+ * FUNCTION */
+
+/* Record backlog at the start of a frame that has work to do */
+void Changequeue::_sample( void ){
+	stats.backlog = queue.size();
+	if( stats.backlog > stats.max_backlog ){
+		stats.max_backlog = stats.backlog;
+	}
+	stats.frames++;
+	stats.avg_backlog += ((double)stats.backlog - stats.avg_backlog) / (double)stats.frames;
+}
+
+/* Public functions */
+
+Changequeue::Changequeue(){
+	cmtx.lock();
+	stats = {};
+	cmtx.unlock();
+}
+
+/* Destructor; anything still queued is freed without being applied */
+Changequeue::~Changequeue(){
+	cmtx.lock();
+	for( auto& b : queue ){
+		if( b.discard ){
+			b.discard();
+		}
+	}
+	queue.clear();
+	cmtx.unlock();
+}
+
+/* Add change to the end of the queue */
+int Changequeue::push( const void* owner, std::function<void(void)> apply, std::function<void(void)> discard ){
+	if( !apply ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return -1;
+	}
+	cmtx.lock();
+	queue.push_back( { owner, apply, discard } );
+	stats.backlog = queue.size();
+	cmtx.unlock();
+
+	/* UI may be sleeping */
+	ui_idle.wake();
+	return 0;
+}
+
+/* Apply changes in order until the budget runs out. At least one change is
+ * applied each call so the queue always makes progress. Returns number of
+ * changes applied */
+unsigned int Changequeue::drain( std::chrono::microseconds budget ){
+	auto start = std::chrono::steady_clock::now();
+	unsigned int napplied = 0;
+	struct batch_t b;
+
+	cmtx.lock();
+	if( queue.empty() ){
+		cmtx.unlock();
+		return 0;
+	}
+	_sample();
+	cmtx.unlock();
+
+	do {
+		cmtx.lock();
+		if( queue.empty() ){
+			cmtx.unlock();
+			break;
+		}
+		b = queue.front();
+		queue.pop_front();
+		cmtx.unlock();
+
+		/* Apply outside of queue lock so producers are never held up */
+		b.apply();
+		napplied++;
+	} while( (std::chrono::steady_clock::now() - start) < budget );
+
+	cmtx.lock();
+	stats.applied += napplied;
+	stats.backlog = queue.size();
+	if( (std::chrono::steady_clock::now() - start) > budget ){
+		stats.over_budget++;
+	}
+	if( queue.empty() ){
+		y_log_message( Y_LOG_LEVEL_DEBUG, "Change queue empty; %lu batches applied over %lu frames, max backlog %u, average backlog %0.1f, %lu frames over budget",
+				stats.applied, stats.frames, stats.max_backlog, stats.avg_backlog, stats.over_budget );
+	}
+	cmtx.unlock();
+
+	return napplied;
+}
+
+/* Remove all changes for owner without applying them. Used when a newer
+ * refresh replaces them, or when the owner is deleted */
+unsigned int Changequeue::purge( const void* owner ){
+	unsigned int npurged = 0;
+	cmtx.lock();
+	for( auto itr = queue.begin(); itr != queue.end(); ){
+		if( owner == itr->owner ){
+			if( itr->discard ){
+				itr->discard();
+			}
+			itr = queue.erase( itr );
+			npurged++;
+		}
+		else {
+			++itr;
+		}
+	}
+	stats.backlog = queue.size();
+	cmtx.unlock();
+	return npurged;
+}
+
+/* Return number of changes waiting */
+unsigned int Changequeue::backlog( void ){
+	unsigned int len = 0;
+	cmtx.lock();
+	len = queue.size();
+	cmtx.unlock();
+	return len;
+}
+
+/* Copy of backlog statistics, for tuning the budget */
+struct changequeue_stats_t Changequeue::get_stats( void ){
+	struct changequeue_stats_t s;
+	cmtx.lock();
+	s = stats;
+	cmtx.unlock();
+	return s;
+}
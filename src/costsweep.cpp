@@ -0,0 +1,96 @@
+#include <costsweep.h>
+#include <mutex>
+
+Costsweep::Costsweep(){
+	prj = nullptr;
+	prj_ipn = 0;
+	stamp = 0;
+	max_units = 0;
+}
+
+Costsweep::~Costsweep(){
+
+}
+
+/* Compute sweep from 1 to max units; does nothing if project and range have
+ * not changed since the last run */
+int Costsweep::run( struct proj_t* p, unsigned int max ){
+	if( nullptr == p ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return -1;
+	}
+	if( 0 == max ){
+		max = 1;
+	}
+
+	struct proj_flat_t* flat = get_proj_flat( p );
+	if( nullptr == flat ){
+		return -1;
+	}
+
+	/* Nothing changed */
+	if( p == prj && p->ipn == prj_ipn && flat->stamp == stamp && max == max_units && !units.empty() ){
+		return 0;
+	}
+
+	/* Spread points evenly over the range */
+	unsigned int n = ( max < COSTSWEEP_MAX_POINTS ) ? max : COSTSWEEP_MAX_POINTS;
+	std::vector<unsigned int> q( n );
+	for( unsigned int i = 0; i < n; i++ ){
+		q[i] = ( n > 1 ) ? 1 + (unsigned int)( (unsigned long long)(max - 1) * i / (n - 1) ) : 1;
+	}
+
+	/* Compile price curves up front; workers only read them */
+	for( unsigned int i = 0; i < flat->nlines; i++ ){
+		if( nullptr != flat->line[i].part ){
+			get_part_price_curve( flat->line[i].part );
+		}
+	}
+
+	/* Each chunk of lines is summed on its own, then added to the totals */
+	std::mutex sum_mtx;
+	units.assign( n, 0.0 );
+	optimal.assign( n, 0.0 );
+	exact.assign( n, 0.0 );
+	optimal_per.assign( n, 0.0 );
+	exact_per.assign( n, 0.0 );
+	task_pool.parallel_for( flat->nlines, COSTSWEEP_LINES_PER_THREAD, [&]( unsigned int start, unsigned int end ){
+		std::vector<double> part_opt( n, 0.0 );
+		std::vector<double> part_exact( n, 0.0 );
+		sum_proj_flat_cost( flat, start, end, q.data(), n, part_opt.data(), part_exact.data() );
+		std::lock_guard<std::mutex> lock( sum_mtx );
+		for( unsigned int i = 0; i < n; i++ ){
+			optimal[i] += part_opt[i];
+			exact[i] += part_exact[i];
+		}
+	});
+
+	for( unsigned int i = 0; i < n; i++ ){
+		units[i] = (double)q[i];
+		optimal_per[i] = optimal[i] / units[i];
+		exact_per[i] = exact[i] / units[i];
+	}
+
+	prj = p;
+	prj_ipn = p->ipn;
+	stamp = flat->stamp;
+	max_units = max;
+	y_log_message( Y_LOG_LEVEL_DEBUG, "Cost sweep of %u points over %u parts", n, flat->nlines );
+	return 0;
+}
+
+unsigned int Costsweep::size( void ){
+	return units.size();
+}
+
+const double* Costsweep::get_units( void ){
+	return units.data();
+}
+
+const double* Costsweep::get_optimal( bool per_unit ){
+	return per_unit ? optimal_per.data() : optimal.data();
+}
+
+const double* Costsweep::get_exact( bool per_unit ){
+	return per_unit ? exact_per.data() : exact.data();
+}
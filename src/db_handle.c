@@ -2,8 +2,11 @@
 #include <redis-wrapper/redis-json.h>
 #include <json-c/json.h>
 #include <string.h>
+#include <strings.h>
 #include <yder.h>
+#include <limits.h>
 #include <db_handle.h>
+#include <part_funct.h>
 #include <unistd.h>
 #include <stdio.h>
 	
@@ -11,6 +14,10 @@
 /* Redis Context for handling in database */
 static redisContext *rc;
 
+/* Where database is, for connections of their own */
+static char db_host[256] = "127.0.0.1";
+static int db_port = 6379;
+
 static int dbinfo_mtx = 0;
 
 static struct dbinfo_t dbinfo = {0};
@@ -25,6 +32,19 @@ static void unlock( volatile int *exclusion ){
 	__sync_lock_release( exclusion );
 }
 
+/* Number of buckets in table of shared part handles */
+#define PART_SHARE_BUCKETS	(4096)
+
+/* Shared part handle in table */
+struct part_share_t {
+	struct part_t* part;
+	struct part_share_t* next;
+};
+
+/* Parts shared between caches, BOMs and the UI, by type and ipn */
+static struct part_share_t* part_share[PART_SHARE_BUCKETS];
+static int part_share_mtx = 0;
+
 /* Remove escape characters for display */
 static char* remove_escape_char( char* s, size_t len ){
 	char* out = calloc( len + 1, sizeof(char) );
@@ -139,6 +159,95 @@ static char* sanitize_redis_string(  char* s ){
 	return out;
 }
 
+/* Approximate number of changes kept in stock history of each part type */
+#define STOCK_HISTORY_MAXLEN	(1000000)
+
+/* Number of stock history entries read per round trip */
+#define STOCK_HISTORY_PAGE		(10000)
+
+/* Replace whole object only if its revision in the database still matches the
+ * revision it was read at. Runs as a single script on the server. If a stock
+ * history stream is given, the change in quantity at each inventory location
+ * is added to it, so history covers stock set by whole part writes too.
+ * KEYS[1]: object key, KEYS[2]: stock history stream, if any,
+ * ARGV[1]: expected revision, ARGV[2]: new object, ARGV[3]: stream length to
+ * keep */
+static const char* cas_set_script =
+	"local cur = redis.call('JSON.GET', KEYS[1], '$.rev') "
+	"local rev = 0 "
+	"if cur then rev = cjson.decode(cur)[1] or 0 end "
+	"if rev ~= tonumber(ARGV[1]) then return -1 end "
+	"local old = {} "
+	"if KEYS[2] and cur then "
+		"for _, l in ipairs(cjson.decode(redis.call('JSON.GET', KEYS[1], '$.inv'))[1] or {}) do "
+			"old[l.loc] = (old[l.loc] or 0) + l.q "
+		"end "
+	"end "
+	"redis.call('JSON.SET', KEYS[1], '$', ARGV[2]) "
+	"if KEYS[2] then "
+		"local obj = cjson.decode(ARGV[2]) "
+		"local new = {} "
+		"local locs = {} "
+		"if type(obj.inv) == 'table' then "
+			"for _, l in ipairs(obj.inv) do new[l.loc] = (new[l.loc] or 0) + l.q end "
+		"end "
+		"for loc in pairs(old) do locs[#locs + 1] = loc end "
+		"for loc in pairs(new) do if not old[loc] then locs[#locs + 1] = loc end end "
+		"table.sort(locs) "
+		"for _, loc in ipairs(locs) do "
+			"local d = (new[loc] or 0) - (old[loc] or 0) "
+			"if d ~= 0 then "
+				"redis.call('XADD', KEYS[2], 'MAXLEN', '~', ARGV[3], '*', 'ipn', obj.ipn, 'loc', loc, 'delta', d) "
+			"end "
+		"end "
+	"end "
+	"return rev + 1";
+
+/* Write json object to key with compare and set on revision. On success the
+ * revision is updated to the one that was written. history is the stock
+ * history stream to record inventory changes in, or NULL */
+static int cas_json_set( const char* key, unsigned int* rev, struct json_object* root, const char* history ){
+	redisReply* reply = NULL;
+	int retval = -1;
+
+	if( NULL == rc ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "Database is not connected. Could not write %s", key );
+		return -1;
+	}
+
+	/* Object carries the revision it will have once written */
+	json_object_object_add( root, "rev", json_object_new_int64( *rev + 1 ) );
+
+	/* Stream is passed as a key, so the server knows the script touches it */
+	if( NULL != history ){
+		reply = redisCommand( rc, "EVAL %s 2 %s %s %u %s %d", cas_set_script, key, history, *rev, json_object_to_json_string( root ), STOCK_HISTORY_MAXLEN );
+	}
+	else {
+		reply = redisCommand( rc, "EVAL %s 1 %s %u %s %d", cas_set_script, key, *rev, json_object_to_json_string( root ), STOCK_HISTORY_MAXLEN );
+	}
+	if( NULL == reply ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "Lost connection while writing %s", key );
+		return -1;
+	}
+
+	if( REDIS_REPLY_INTEGER == reply->type ){
+		if( reply->integer < 0 ){
+			y_log_message( Y_LOG_LEVEL_WARNING, "%s was changed by another client since revision %u; not written", key, *rev );
+			retval = DB_ERR_CONFLICT;
+		}
+		else {
+			*rev = (unsigned int)reply->integer;
+			retval = 0;
+		}
+	}
+	else {
+		y_log_message( Y_LOG_LEVEL_ERROR, "Could not write %s: %s", key, (REDIS_REPLY_ERROR == reply->type) ? reply->str : "unexpected reply" );
+	}
+
+	freeReplyObject( reply );
+	return retval;
+}
+
 /* Parse part json object to part_t */
 static int parse_json_part( struct part_t * part, struct json_object* restrict jpart ){
 
@@ -166,6 +275,9 @@ static int parse_json_part( struct part_t * part, struct json_object* restrict j
 	/* Internal part number */
 	part->ipn = json_object_get_int64( jipn );
 
+	/* Revision; missing in objects written before revisions were tracked */
+	part->rev = json_object_get_int64( json_object_object_get( jpart, "rev" ) );
+
 	/* Internal Stock */
 	part->q = json_object_get_int64( jq );
 
@@ -358,6 +470,7 @@ static int parse_json_bom( struct bom_t * bom, struct json_object* restrict jbom
 
 	/* Internal part number */
 	bom->ipn = json_object_get_int64( jipn );
+	bom->rev = json_object_get_int64( json_object_object_get( jbom, "rev" ) );
 
 	/* BOM Version */
 	jstrlen = json_object_get_string_len( jversion );
@@ -439,12 +552,40 @@ static int parse_json_bom( struct bom_t * bom, struct json_object* restrict jbom
 			bom = NULL;
 			return -1;
 		}
+		bom->parts[i] = share_part_t( bom->parts[i] );
 
 	}
 
 	return 0;
 }
 
+/* Projects being loaded on this thread, outermost first. Used to catch
+ * subproject references that loop back to a parent */
+#define PROJ_LOAD_DEPTH_MAX		32
+static _Thread_local struct {
+	unsigned int ipn;
+	const char* ver;
+} proj_load_stack[PROJ_LOAD_DEPTH_MAX];
+static _Thread_local unsigned int proj_load_depth = 0;
+
+/* Push project onto load stack; fails if it is already being loaded */
+static int proj_load_push( unsigned int ipn, const char* ver ){
+	for( unsigned int i = 0; i < proj_load_depth; i++ ){
+		if( proj_load_stack[i].ipn == ipn && !strcmp( proj_load_stack[i].ver, ver ) ){
+			y_log_message( Y_LOG_LEVEL_ERROR, "Project %u:%s references itself through its subprojects; not loading cycle", ipn, ver );
+			return -1;
+		}
+	}
+	if( proj_load_depth >= PROJ_LOAD_DEPTH_MAX ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "Subprojects of project %u:%s nested deeper than %d", ipn, ver, PROJ_LOAD_DEPTH_MAX );
+		return -1;
+	}
+	proj_load_stack[proj_load_depth].ipn = ipn;
+	proj_load_stack[proj_load_depth].ver = ver;
+	proj_load_depth++;
+	return 0;
+}
+
 /* Parse project json object to proj_t */
 static int parse_json_proj( struct proj_t * prj, struct json_object* restrict jprj ){
 
@@ -483,6 +624,7 @@ static int parse_json_proj( struct proj_t * prj, struct json_object* restrict jp
 
 	/* Internal part number */
 	prj->ipn = json_object_get_int64( jipn );
+	prj->rev = json_object_get_int64( json_object_object_get( jprj, "rev" ) );
 
 	/* Creation time */
 	prj->time_created = (time_t) json_object_get_int64( jtcreate );
@@ -567,6 +709,12 @@ static int parse_json_proj( struct proj_t * prj, struct json_object* restrict jp
 				}
 				strcpy( prj->boms[i].ver, json_object_get_string( jval ) );
 
+				/* Sets per unit; older entries don't have it */
+				prj->boms[i].q = 1;
+				if( NULL != json_object_object_get( jbom_itr, "q" ) ){
+					prj->boms[i].q = json_object_get_int64( json_object_object_get( jbom_itr, "q" ) );
+				}
+
 				//json_object_put( jbom_itr );
 				unsigned int bom_ipn = json_object_get_int64( jkey );
 				prj->boms[i].bom = get_bom_from_ipn( bom_ipn, prj->boms[i].ver );
@@ -630,6 +778,12 @@ static int parse_json_proj( struct proj_t * prj, struct json_object* restrict jp
 						return -1;
 					}
 
+					/* Units per parent unit; older entries don't have it */
+					prj->sub[i].q = 1;
+					if( NULL != json_object_object_get( jprj_itr, "q" ) ){
+						prj->sub[i].q = json_object_get_int64( json_object_object_get( jprj_itr, "q" ) );
+					}
+
 					/* Use ipn of subproject to get subproject info */
 					if( NULL != jkey ){
 						unsigned int ipn = json_object_get_int64(jkey);
@@ -713,6 +867,7 @@ static int parse_json_dbinfo( struct dbinfo_t * db, struct json_object* restrict
 
 	/* Number of kinds of objects  */
 	db->nprj  = json_object_get_int64( jnprj );
+	db->rev   = json_object_get_int64( json_object_object_get( jdb, "rev" ) );
 	db->nbom  = json_object_get_int64( jnbom );
 	db->nptype = (unsigned int)json_object_array_length( jptypes );
 	db->ninv = (unsigned int)json_object_array_length( jinvs );
@@ -796,9 +951,58 @@ static int parse_json_dbinfo( struct dbinfo_t * db, struct json_object* restrict
 
 
 
-/* Free the part structure */
+/* Bucket of part in shared table */
+static unsigned int part_share_bucket( const char* type, unsigned int ipn ){
+	unsigned int h = ipn * 2654435761u;
+	if( NULL != type ){
+		for( const char* c = type; '\0' != *c; c++ ){
+			h = ( h ^ (unsigned char)*c ) * 16777619u;
+		}
+	}
+	return h % PART_SHARE_BUCKETS;
+}
+
+/* Take reference to handle found in shared table, unless its last holder is
+ * already freeing it */
+static int part_try_ref( struct part_t* part ){
+	unsigned int refs = __atomic_load_n( &part->refs, __ATOMIC_ACQUIRE );
+	do {
+		if( UINT_MAX == refs ){
+			return -1;
+		}
+	} while( !__atomic_compare_exchange_n( &part->refs, &refs, refs + 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) );
+	return 0;
+}
+
+/* Take part out of shared table */
+static void part_share_remove( struct part_t* part ){
+	unsigned int b = part_share_bucket( part->type, part->ipn );
+	while( lock( &part_share_mtx ) );
+	for( struct part_share_t** e = &part_share[b]; NULL != *e; e = &(*e)->next ){
+		if( (*e)->part == part ){
+			struct part_share_t* tmp = *e;
+			*e = tmp->next;
+			free( tmp );
+			break;
+		}
+	}
+	unlock( &part_share_mtx );
+	part->shared = 0;
+}
+
+
+/* Release part handle; the structure is freed by its last holder */
 void free_part_t( struct part_t* part ){
 	if( NULL != part ){
+		/* Someone else still holds the handle. Once this drops past zero
+		 * the handle can no longer be found in the shared table */
+		if( __atomic_fetch_sub( &part->refs, 1, __ATOMIC_ACQ_REL ) > 0 ){
+			return;
+		}
+		if( part->shared ){
+			part_share_remove( part );
+		}
+
 //		y_log_message( Y_LOG_LEVEL_DEBUG, "Freeing part:%d", part->ipn );
 		/* Zero out other data */
 		part->ipn = 0;
@@ -868,6 +1072,12 @@ void free_part_t( struct part_t* part ){
 			part->price_len = 0;
 		}
 
+		if( NULL != part->curve ){
+			free( part->curve->brk );
+			free( part->curve );
+			part->curve = NULL;
+		}
+
 		if( NULL != part->inv ){
 			for( unsigned int i = 0; i < part->inv_len; i++ ){
 				part->inv[i].q = 0;
@@ -956,6 +1166,12 @@ void free_part_addr_t( struct part_t* part ){
 			part->price_len = 0;
 		}
 
+		if( NULL != part->curve ){
+			free( part->curve->brk );
+			free( part->curve );
+			part->curve = NULL;
+		}
+
 		if( NULL != part->inv ){
 			for( unsigned int i = 0; i < part->inv_len; i++ ){
 				part->inv[i].q = 0;
@@ -1062,6 +1278,24 @@ void free_proj_t( struct proj_t* prj ){
 			prj->nboms = 0;
 		}
 
+		/* Free cached exploded BOM; lines point into the boms, so nothing else
+		 * to free */
+		if( NULL != prj->flat ){
+			free( prj->flat->line );
+			free( prj->flat );
+			prj->flat = NULL;
+		}
+		if( NULL != prj->build ){
+			free( prj->build->stock );
+			free( prj->build->units );
+			free( prj->build );
+			prj->build = NULL;
+		}
+		if( NULL != prj->stats ){
+			free( prj->stats );
+			prj->stats = NULL;
+		}
+
 		/* free subprojects, which requires recursion and could get messy */
 		if( NULL != prj->sub ){
 			for( unsigned int i = 0; i < prj->nsub; i++ ){
@@ -1297,7 +1531,14 @@ int redis_write_part( struct part_t* part ){
 		y_log_message(Y_LOG_LEVEL_DEBUG, "Created name: %s", dbpart_name);
 
 		/* Write object to database */
-		retval = redis_json_set( rc, dbpart_name, "$", json_object_to_json_string(part_root) );
+		/* Stock set here shows up in history like batched changes */
+		char* history = NULL;
+		asprintf( &history, "stock:%s", part->type );
+		if( NULL == history ){
+			y_log_message( Y_LOG_LEVEL_WARNING, "Could not allocate memory for stock history name; %s written without history", dbpart_name );
+		}
+		retval = cas_json_set( dbpart_name, &part->rev, part_root, history );
+		free( history );
 		y_log_message(Y_LOG_LEVEL_DEBUG, "JSON Object to send:\n%s\n", json_object_to_json_string_ext(part_root, JSON_C_TO_STRING_PRETTY));
 	}
 
@@ -1312,6 +1553,368 @@ int redis_write_part( struct part_t* part ){
 
 }
 
+/* States of an inventory delta while it is being written */
+#define INV_DELTA_FAILED	(-1)
+#define INV_DELTA_DONE		(0)
+#define INV_DELTA_SENT		(1)	/* Script queued */
+
+/* Outcomes reported by inventory delta script */
+#define INV_SCRIPT_OK		(0)
+#define INV_SCRIPT_NO_LOC	(1)	/* Nothing to remove at location */
+#define INV_SCRIPT_CLAMPED	(2)	/* Went below zero, set to zero */
+
+/* Change quantity at one location of a part and bump its revision, so that
+ * anyone holding the old part cannot overwrite the new stock. Parts written
+ * before revisions were tracked get one here. Locations the part does not
+ * have yet are appended, and stock taken below zero is clamped.
+ * KEYS[1]: part key, ARGV[1]: location, ARGV[2]: change in quantity.
+ * Returns { outcome, change actually made } */
+static const char* inv_delta_script =
+	"local path = '$.inv[?(@.loc==' .. ARGV[1] .. ')].q' "
+	"local delta = tonumber(ARGV[2]) "
+	"local q = cjson.decode(redis.call('JSON.NUMINCRBY', KEYS[1], path, delta)) "
+	"local outcome = 0 "
+	"local applied = delta "
+	"if #q == 0 then "
+		"if delta < 0 then return {1, 0} end "
+		"redis.call('JSON.SET', KEYS[1], '$.inv', '[]', 'NX') "
+		"redis.call('JSON.ARRAPPEND', KEYS[1], '$.inv', '{\"loc\":' .. ARGV[1] .. ',\"q\":' .. delta .. '}') "
+	"elseif q[1] < 0 then "
+		"redis.call('JSON.SET', KEYS[1], path, 0) "
+		"applied = delta - q[1] "
+		"outcome = 2 "
+	"end "
+	"local rev = cjson.decode(redis.call('JSON.GET', KEYS[1], '$.rev'))[1] or 0 "
+	"redis.call('JSON.SET', KEYS[1], '$.rev', rev + 1) "
+	"return {outcome, applied}";
+
+/* Append written stock changes to the history stream of their part type
+ * through connection c. History is only shown in the UI, so failures are
+ * logged and ignored */
+static void stock_history_add( redisContext* c, struct inv_delta_t* deltas, unsigned int n ){
+	redisReply* reply = NULL;
+	unsigned int nsent = 0;
+
+	for( unsigned int i = 0; i < n; i++ ){
+		if( INV_DELTA_DONE != deltas[i].err || 0 == deltas[i].applied ){
+			continue;
+		}
+		if( REDIS_OK == redisAppendCommand( c, "XADD stock:%s MAXLEN ~ %d * ipn %u loc %u delta %d", deltas[i].type, STOCK_HISTORY_MAXLEN, deltas[i].ipn, deltas[i].loc, deltas[i].applied ) ){
+			nsent++;
+		}
+	}
+
+	for( unsigned int i = 0; i < nsent; i++ ){
+		reply = NULL;
+		if( REDIS_OK != redisGetReply( c, (void**)&reply ) || NULL == reply ){
+			y_log_message( Y_LOG_LEVEL_ERROR, "Lost connection while writing stock history" );
+			return;
+		}
+		if( REDIS_REPLY_ERROR == reply->type ){
+			y_log_message( Y_LOG_LEVEL_WARNING, "Could not write stock history: %s", reply->str );
+		}
+		freeReplyObject( reply );
+	}
+}
+
+/* Apply inventory deltas to parts in database as a single pipelined batch.
+ * Only the quantity at each location is changed, so the rest of the part
+ * document is not rewritten. The batch is sent on a connection of its own, so
+ * it does not get in the way of the database thread */
+int redis_write_inv_deltas( struct inv_delta_t* deltas, unsigned int n ){
+	redisContext* c = NULL;
+	char* key = NULL;
+	redisReply* reply = NULL;
+	int retval = 0;
+
+	if( NULL == deltas ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return -1;
+	}
+
+	for( unsigned int i = 0; i < n; i++ ){
+		deltas[i].err = INV_DELTA_FAILED;
+		deltas[i].applied = 0;
+	}
+
+	if( NULL == rc ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "Database is not connected. Could not write %u inventory changes", n );
+		return -1;
+	}
+
+	if( init_redis( &c, db_host, db_port ) ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "Could not connect to database to write %u inventory changes", n );
+		if( NULL != c ){
+			redisFree( c );
+		}
+		return -1;
+	}
+
+	for( unsigned int i = 0; i < n; i++ ){
+		if( 0 == deltas[i].delta ){
+			deltas[i].err = INV_DELTA_DONE;
+			continue;
+		}
+		key = NULL;
+		asprintf( &key, "part:%s:%u", deltas[i].type, deltas[i].ipn );
+		if( NULL == key ){
+			y_log_message( Y_LOG_LEVEL_ERROR, "Could not allocate memory for part key of ipn %u", deltas[i].ipn );
+			continue;
+		}
+		if( REDIS_OK == redisAppendCommand( c, "EVAL %s 1 %s %u %d", inv_delta_script, key, deltas[i].loc, deltas[i].delta ) ){
+			deltas[i].err = INV_DELTA_SENT;
+		}
+		free( key );
+	}
+
+	for( unsigned int i = 0; i < n; i++ ){
+		if( INV_DELTA_SENT != deltas[i].err ){
+			continue;
+		}
+		reply = NULL;
+		if( REDIS_OK != redisGetReply( c, (void**)&reply ) || NULL == reply ){
+			y_log_message( Y_LOG_LEVEL_ERROR, "Lost connection while writing inventory changes" );
+			deltas[i].err = INV_DELTA_FAILED;
+			continue;
+		}
+
+		if( REDIS_REPLY_ARRAY == reply->type && 2 == reply->elements && REDIS_REPLY_INTEGER == reply->element[0]->type && REDIS_REPLY_INTEGER == reply->element[1]->type ){
+			if( INV_SCRIPT_NO_LOC == reply->element[0]->integer ){
+				y_log_message( Y_LOG_LEVEL_WARNING, "Part %s:%u has no stock at location %u to remove", deltas[i].type, deltas[i].ipn, deltas[i].loc );
+			}
+			else if( INV_SCRIPT_CLAMPED == reply->element[0]->integer ){
+				y_log_message( Y_LOG_LEVEL_WARNING, "Stock of part %s:%u at location %u went below zero, set to 0", deltas[i].type, deltas[i].ipn, deltas[i].loc );
+			}
+			deltas[i].applied = (int)reply->element[1]->integer;
+			deltas[i].err = INV_DELTA_DONE;
+		}
+		else {
+			y_log_message( Y_LOG_LEVEL_ERROR, "Could not change inventory of part %s:%u: %s", deltas[i].type, deltas[i].ipn, (REDIS_REPLY_ERROR == reply->type) ? reply->str : "unexpected reply" );
+			deltas[i].err = INV_DELTA_FAILED;
+		}
+		freeReplyObject( reply );
+	}
+
+	for( unsigned int i = 0; i < n; i++ ){
+		if( INV_DELTA_DONE != deltas[i].err ){
+			y_log_message( Y_LOG_LEVEL_ERROR, "Could not write inventory change of %d to part %s:%u at location %u", deltas[i].delta, deltas[i].type, deltas[i].ipn, deltas[i].loc );
+			retval = -1;
+		}
+	}
+	y_log_message( Y_LOG_LEVEL_DEBUG, "Wrote %u inventory changes in batch", n );
+
+	stock_history_add( c, deltas, n );
+	redisFree( c );
+
+	return retval;
+}
+
+/* Read stock history of part type through connection c, oldest first, a page
+ * at a time */
+static int read_stock_history( redisContext* c, const char* type, struct stock_event_t** events, unsigned int* n ){
+	redisReply* reply = NULL;
+	char start[48] = "-";
+	unsigned int size = 0;
+	size_t nread = 0;
+
+	do {
+		reply = redisCommand( c, "XRANGE stock:%s %s + COUNT %d", type, start, STOCK_HISTORY_PAGE );
+		if( NULL == reply || REDIS_REPLY_ARRAY != reply->type ){
+			y_log_message( Y_LOG_LEVEL_ERROR, "Could not read stock history of %s: %s", type, ( NULL != reply && REDIS_REPLY_ERROR == reply->type ) ? reply->str : "unexpected reply" );
+			if( NULL != reply ){
+				freeReplyObject( reply );
+			}
+			free( *events );
+			*events = NULL;
+			*n = 0;
+			return -1;
+		}
+
+		if( *n + reply->elements > size ){
+			unsigned int new_size = size ? size : STOCK_HISTORY_PAGE;
+			while( new_size < *n + reply->elements ){
+				new_size *= 2;
+			}
+			struct stock_event_t* tmp = realloc( *events, new_size * sizeof( struct stock_event_t ) );
+			if( NULL == tmp ){
+				y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; could not allocate memory for stock history", __func__ );
+				freeReplyObject( reply );
+				free( *events );
+				*events = NULL;
+				*n = 0;
+				return -1;
+			}
+			*events = tmp;
+			size = new_size;
+		}
+
+		/* Entries are [id, [field, value, ...]]; id is milliseconds-sequence */
+		for( size_t i = 0; i < reply->elements; i++ ){
+			redisReply* e = reply->element[i];
+			unsigned long long ms = 0;
+			unsigned long long seq = 0;
+			if( REDIS_REPLY_ARRAY != e->type || e->elements < 2 || REDIS_REPLY_STRING != e->element[0]->type || REDIS_REPLY_ARRAY != e->element[1]->type ){
+				continue;
+			}
+			if( 2 != sscanf( e->element[0]->str, "%llu-%llu", &ms, &seq ) ){
+				continue;
+			}
+			/* Next page starts right after this entry */
+			snprintf( start, sizeof( start ), "%llu-%llu", ms, seq + 1 );
+
+			struct stock_event_t* ev = &(*events)[*n];
+			memset( ev, 0, sizeof( struct stock_event_t ) );
+			ev->t = (double)ms / 1000.0;
+			redisReply* f = e->element[1];
+			for( size_t j = 0; j + 1 < f->elements; j += 2 ){
+				if( REDIS_REPLY_STRING != f->element[j]->type || REDIS_REPLY_STRING != f->element[j + 1]->type ){
+					continue;
+				}
+				if( 0 == strcmp( f->element[j]->str, "ipn" ) ){
+					ev->ipn = (unsigned int)strtoul( f->element[j + 1]->str, NULL, 10 );
+				}
+				else if( 0 == strcmp( f->element[j]->str, "loc" ) ){
+					ev->loc = (unsigned int)strtoul( f->element[j + 1]->str, NULL, 10 );
+				}
+				else if( 0 == strcmp( f->element[j]->str, "delta" ) ){
+					ev->delta = (int)strtol( f->element[j + 1]->str, NULL, 10 );
+				}
+			}
+			(*n)++;
+		}
+		nread = reply->elements;
+		freeReplyObject( reply );
+	} while( nread >= STOCK_HISTORY_PAGE );
+
+	y_log_message( Y_LOG_LEVEL_DEBUG, "Read %u stock changes of part type %s", *n, type );
+	return 0;
+}
+
+/* Read stock history of part type, oldest first. History can be long, so it is
+ * read on a connection of its own and may be called from any thread. Caller
+ * frees events */
+int redis_read_stock_history( const char* type, struct stock_event_t** events, unsigned int* n ){
+	redisContext* c = NULL;
+	int retval = -1;
+
+	if( NULL == type || NULL == events || NULL == n ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return -1;
+	}
+	*events = NULL;
+	*n = 0;
+
+	if( NULL == rc ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "Database is not connected. Could not read stock history of %s", type );
+		return -1;
+	}
+
+	if( init_redis( &c, db_host, db_port ) ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "Could not connect to database to read stock history of %s", type );
+		if( NULL != c ){
+			redisFree( c );
+		}
+		return -1;
+	}
+	retval = read_stock_history( c, type, events, n );
+	redisFree( c );
+	return retval;
+}
+
+/* Take another reference to a part handle already held */
+struct part_t* ref_part_t( struct part_t* part ){
+	if( NULL == part ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return NULL;
+	}
+	__atomic_add_fetch( &part->refs, 1, __ATOMIC_ACQ_REL );
+	return part;
+}
+
+/* Compare strings that may be NULL */
+static int part_str_eq( const char* a, const char* b ){
+	if( NULL == a || NULL == b ){
+		return a == b;
+	}
+	return !strcmp( a, b );
+}
+
+/* Check if two loaded parts hold the same data. Revisions are not enough on
+ * their own, as parts written by older clients never change theirs */
+static int part_same_content( const struct part_t* a, const struct part_t* b ){
+	if( a->q != b->q || a->status != b->status || a->info_len != b->info_len || a->dist_len != b->dist_len || a->price_len != b->price_len || a->inv_len != b->inv_len ){
+		return 0;
+	}
+	if( !part_str_eq( a->mfg, b->mfg ) || !part_str_eq( a->mpn, b->mpn ) ){
+		return 0;
+	}
+	for( unsigned int i = 0; i < a->inv_len; i++ ){
+		if( a->inv[i].loc != b->inv[i].loc || a->inv[i].q != b->inv[i].q ){
+			return 0;
+		}
+	}
+	for( unsigned int i = 0; i < a->price_len; i++ ){
+		if( a->price[i].quantity != b->price[i].quantity || a->price[i].price != b->price[i].price ){
+			return 0;
+		}
+	}
+	for( unsigned int i = 0; i < a->info_len; i++ ){
+		if( !part_str_eq( a->info[i].key, b->info[i].key ) || !part_str_eq( a->info[i].val, b->info[i].val ) ){
+			return 0;
+		}
+	}
+	for( unsigned int i = 0; i < a->dist_len; i++ ){
+		if( !part_str_eq( a->dist[i].name, b->dist[i].name ) || !part_str_eq( a->dist[i].pn, b->dist[i].pn ) ){
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* Share freshly loaded part. Loading the same part and revision again, for
+ * another cache or BOM, hands out the handle already in memory as long as it
+ * still holds the same data */
+struct part_t* share_part_t( struct part_t* part ){
+	unsigned int b = 0;
+
+	if( NULL == part ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return NULL;
+	}
+	if( part->shared ){
+		return part;
+	}
+
+	/* Compiled before anyone else can see the handle, so readers on other
+	 * threads never compile it themselves */
+	get_part_price_curve( part );
+
+	b = part_share_bucket( part->type, part->ipn );
+	while( lock( &part_share_mtx ) );
+	for( struct part_share_t* e = part_share[b]; NULL != e; e = e->next ){
+		struct part_t* s = e->part;
+		if( s->ipn == part->ipn && s->rev == part->rev && NULL != s->type && NULL != part->type && !strcmp( s->type, part->type ) && part_same_content( s, part ) && !part_try_ref( s ) ){
+			unlock( &part_share_mtx );
+			free_part_t( part );
+			return s;
+		}
+	}
+
+	struct part_share_t* e = malloc( sizeof( struct part_share_t ) );
+	if( NULL == e ){
+		/* Still usable, just not shared */
+		unlock( &part_share_mtx );
+		y_log_message( Y_LOG_LEVEL_WARNING, "Could not allocate memory to share part %u", part->ipn );
+		return part;
+	}
+	e->part = part;
+	e->next = part_share[b];
+	part_share[b] = e;
+	part->shared = 1;
+	unlock( &part_share_mtx );
+	return part;
+}
+
 /* Copy part structure to new structure */
 struct part_t* copy_part_t( struct part_t* src ){
 	struct part_t* dest;
@@ -1333,6 +1936,7 @@ struct part_t* copy_part_t( struct part_t* src ){
 
 	/* Copy data over */
 	dest->ipn = src->ipn;
+	dest->rev = src->rev;
 	dest->q = src->q;
 	dest->type = calloc( strlen(src->type) + 1, sizeof( char ) );
 	if( NULL == dest->type ){
@@ -1464,6 +2068,7 @@ struct bom_t* copy_bom_t( struct bom_t* src ){
 
 	/* Copy data over */
 	dest->ipn = src->ipn;
+	dest->rev = src->rev;
 	dest->name = calloc( strlen(src->name) + 1, sizeof( char ) );
 	if( NULL == dest->name ){
 		y_log_message( Y_LOG_LEVEL_ERROR, "Could not allocate memory for destination bom name" );
@@ -1501,7 +2106,8 @@ struct bom_t* copy_bom_t( struct bom_t* src ){
 		return NULL;
 	}
 	for( unsigned int i = 0; i < dest->nitems; i++ ){
-		dest->parts[i] = copy_part_t( src->parts[i] );
+		/* Parts are shared handles; no need to copy them */
+		dest->parts[i] = ref_part_t( src->parts[i] );
 
 		if( NULL == dest->parts[i] ){
 			y_log_message( Y_LOG_LEVEL_ERROR, "Failed to copy part to destination bom" );
@@ -1539,6 +2145,7 @@ struct dbinfo_t* copy_dbinfo_t( struct dbinfo_t* src ){
 
 	/* Copy data over */
 	dest->flags = src->flags;
+	dest->rev = src->rev;
 	dest->nprj = src->nprj;
 	dest->nbom = src->nbom;
 	dest->nptype = src->nptype;
@@ -1667,7 +2274,7 @@ int redis_write_bom( struct bom_t* bom ){
 		y_log_message(Y_LOG_LEVEL_DEBUG, "Created name: %s", dbbom_name);
 
 		/* Write object to database */
-		retval = redis_json_set( rc, dbbom_name, "$", json_object_to_json_string(bom_root) );
+		retval = cas_json_set( dbbom_name, &bom->rev, bom_root, NULL );
 		//y_log_message(Y_LOG_LEVEL_DEBUG, "JSON Object to send:\n%s\n", json_object_to_json_string_ext(bom_root, JSON_C_TO_STRING_PRETTY));
 	}
 
@@ -1743,6 +2350,7 @@ int redis_write_proj( struct proj_t* prj ){
 			}			
 			json_object_object_add( bom_itr, "ipn", json_object_new_int64(prj->boms[i].bom->ipn) );
 			json_object_object_add( bom_itr, "ver", json_object_new_string(prj->boms[i].ver) );
+			json_object_object_add( bom_itr, "q", json_object_new_int64( prj->boms[i].q ? prj->boms[i].q : 1 ) );
 			json_object_array_put_idx( boms, i, bom_itr);
 		}
 
@@ -1760,6 +2368,7 @@ int redis_write_proj( struct proj_t* prj ){
 			}			
 			json_object_object_add( sub_itr, "ipn", json_object_new_int64(prj->sub[i].prj->ipn) );
 			json_object_object_add( sub_itr, "ver", json_object_new_string(prj->sub[i].ver) );
+			json_object_object_add( sub_itr, "q", json_object_new_int64( prj->sub[i].q ? prj->sub[i].q : 1 ) );
 			json_object_array_put_idx( sub, i, sub_itr );
 		}
 		
@@ -1781,7 +2390,7 @@ int redis_write_proj( struct proj_t* prj ){
 		y_log_message(Y_LOG_LEVEL_DEBUG, "Created name: %s", dbprj_name);
 
 		/* Write object to database */
-		retval = redis_json_set( rc, dbprj_name, "$", json_object_to_json_string(prj_root) );
+		retval = cas_json_set( dbprj_name, &prj->rev, prj_root, NULL );
 //		y_log_message(Y_LOG_LEVEL_DEBUG, "JSON Object to send:\n%s\n", json_object_to_json_string_ext(prj_root, JSON_C_TO_STRING_PRETTY));
 	}
 
@@ -1823,6 +2432,48 @@ int redis_import_part_file( char* filepath ){
 	struct part_t* part = NULL;
 	int parse_part_retval = 0;
 
+	/* Reserve one block of IPNs per part type for parts in the file that
+	 * do not have one yet. This also adds any new part types to dbinfo */
+	struct import_ipn_t {
+		const char* type;
+		unsigned int count;
+		unsigned int next;
+	};
+	struct import_ipn_t* blocks = NULL;
+	unsigned int nblocks = 0;
+	for( size_t i = 0; i < array_len; i++ ){
+		struct json_object* jtype = json_object_object_get( json_object_array_get_idx( root, (int)i ), "type" );
+		struct json_object* jipn = json_object_object_get( json_object_array_get_idx( root, (int)i ), "ipn" );
+		if( NULL == jtype ){
+			continue;
+		}
+		unsigned int j = 0;
+		while( j < nblocks && strcmp( blocks[j].type, json_object_get_string( jtype ) ) ){
+			j++;
+		}
+		if( j == nblocks ){
+			struct import_ipn_t* tmp = realloc( blocks, (nblocks + 1) * sizeof( struct import_ipn_t ) );
+			if( NULL == tmp ){
+				y_log_message( Y_LOG_LEVEL_ERROR, "Could not allocate memory for IPN blocks while importing %s", filepath );
+				continue;
+			}
+			blocks = tmp;
+			blocks[j].type = json_object_get_string( jtype );
+			blocks[j].count = 0;
+			blocks[j].next = 0;
+			nblocks++;
+		}
+		if( NULL == jipn || 0 == json_object_get_int64( jipn ) ){
+			blocks[j].count++;
+		}
+	}
+	for( unsigned int j = 0; j < nblocks; j++ ){
+		if( redis_alloc_part_ipn( blocks[j].type, blocks[j].count, &blocks[j].next ) ){
+			y_log_message( Y_LOG_LEVEL_ERROR, "Could not reserve IPNs for type %s while importing %s", blocks[j].type, filepath );
+			blocks[j].count = 0;
+		}
+	}
+
 
 	for( size_t i = 0; i < array_len; i++ ){
 		y_log_message(Y_LOG_LEVEL_DEBUG, "JSON Index: %d", i);
@@ -1847,6 +2498,23 @@ int redis_import_part_file( char* filepath ){
 
 				/* Convert json object to part_t */
 				parse_part_retval = parse_json_part( part, jo_idx );
+				if( !parse_part_retval && 0 == part->ipn ){
+					/* Take next IPN from the block reserved for this type */
+					unsigned int j = 0;
+					while( j < nblocks && strcmp( blocks[j].type, part->type ) ){
+						j++;
+					}
+					if( j < nblocks && blocks[j].count > 0 ){
+						part->ipn = blocks[j].next++;
+						blocks[j].count--;
+					}
+					else {
+						y_log_message( Y_LOG_LEVEL_ERROR, "No IPN available for part mpn: %s", part->mpn );
+						free_part_t( part );
+						part = NULL;
+						parse_part_retval = -1;
+					}
+				}
 				if( !parse_part_retval ){
 					/* No parsing errors, write to database */
 					if( redis_write_part( part ) ){
@@ -1866,6 +2534,8 @@ int redis_import_part_file( char* filepath ){
 		}
 	}
 
+	free( blocks );
+
 	/* Cleanup root object */
 	y_log_message(Y_LOG_LEVEL_DEBUG, "Root object cleanup");
 	json_object_put(root);
@@ -1887,6 +2557,8 @@ int redis_connect( const char* hostname, int port ){
 		y_log_message(Y_LOG_LEVEL_ERROR, "Could not connect to redis database");
 		return -1;
 	}
+	snprintf( db_host, sizeof( db_host ), "%s", hostname );
+	db_port = port;
 	y_log_message(Y_LOG_LEVEL_INFO, "Established connection to redis database");
 
 
@@ -1903,9 +2575,19 @@ void redis_disconnect( void ){
 	rc = NULL;
 }
 
-/* Create struct from parsed item in database, from part number */
-struct part_t* get_part_from_pn( const char* pn ){
+/* Create struct from parsed item in database, from part number. If there is
+ * no exact match and suggest is not NULL, part numbers of the other parts
+ * found are put there instead */
+struct part_t* get_part_from_pn_suggest( const char* pn, char*** suggest, unsigned int* nsuggest ){
 	struct part_t * part = NULL;	
+
+	if( NULL != suggest ){
+		*suggest = NULL;
+	}
+	if( NULL != nsuggest ){
+		*nsuggest = 0;
+	}
+
 	if( NULL == rc ){
 		y_log_message( Y_LOG_LEVEL_ERROR, "Database is not connected. Could not get info of part: %s", pn);
 		return NULL;
@@ -1937,28 +2619,77 @@ struct part_t* get_part_from_pn( const char* pn ){
 		free( pn_sanitized );
 	}
 
-	/* Returns back a few elements; need to grab the second one to get the
-	 * right object */
-	if( NULL == reply || reply->type != REDIS_REPLY_ARRAY || reply->elements != 3 ){
+	/* Reply is the number of matches, then the key and document of each
+	 * match */
+	if( NULL == reply || reply->type != REDIS_REPLY_ARRAY || reply->elements < 1 ){
 		y_log_message( Y_LOG_LEVEL_ERROR, "Database search did not reply correctly for part pn %s", pn );
 		free( part ); /* don't need to free other parts of array as they have not been allocated yet */
 		part = NULL;
 	}
+	else if( reply->elements < 3 ){
+		y_log_message( Y_LOG_LEVEL_WARNING, "No part in database with part number %s", pn );
+		free( part );
+		part = NULL;
+	}
 	else {
+		/* Search on mpn is tokenized, so several parts can match. Only one
+		 * with the whole part number is taken; the rest are only offered */
+		struct json_object* jexact = NULL;
+		unsigned int nexact = 0;
+		char** near = NULL;
+		unsigned int nnear = 0;
+		if( NULL != suggest && NULL != nsuggest ){
+			near = calloc( DB_PN_SUGGEST_MAX, sizeof( char* ) );
+		}
+		for( size_t i = 2; i < reply->elements; i += 2 ){
+			redisReply* doc = reply->element[i];
+			if( REDIS_REPLY_ARRAY != doc->type || doc->elements < 2 || REDIS_REPLY_STRING != doc->element[1]->type ){
+				continue;
+			}
+			jpart = json_tokener_parse( doc->element[1]->str );
+			if( NULL == jpart ){
+				continue;
+			}
+			const char* mpn = json_object_get_string( json_object_object_get( jpart, "mpn" ) );
+			if( NULL != mpn && 0 == strcasecmp( mpn, pn ) ){
+				nexact++;
+				if( NULL == jexact ){
+					jexact = jpart;
+					continue;
+				}
+			}
+			else if( NULL != mpn && NULL != near && nnear < DB_PN_SUGGEST_MAX ){
+				near[nnear] = strdup( mpn );
+				if( NULL != near[nnear] ){
+					nnear++;
+				}
+			}
+			json_object_put( jpart );
+		}
 
-		/* Should be correct response, get second element parsed into jbom */
-		jpart = json_tokener_parse( reply->element[2]->element[1]->str );	
-	 	if( NULL != jpart ){
+		if( nexact > 1 ){
+			y_log_message( Y_LOG_LEVEL_WARNING, "%u parts in database have part number %s; using the first", nexact, pn );
+		}
+	 	if( NULL != jexact ){
 			/* Parse the json */
-			parse_json_part( part, jpart );
-
-			/* Free data */
-			json_object_put( jpart );
+			parse_json_part( part, jexact );
+			free_pn_suggest( near, nnear );
 		}
 		else {
+			y_log_message( Y_LOG_LEVEL_WARNING, "No part in database with part number %s; %zu other parts matched the search", pn, ( reply->elements - 1 ) / 2 );
 			free( part );
 			part = NULL;
+			if( nnear > 0 ){
+				*suggest = near;
+				*nsuggest = nnear;
+			}
+			else {
+				free( near );
+			}
 		}
+
+		/* Free data */
+		json_object_put( jexact );
 	}
 
 	/* Free redis reply */
@@ -1968,6 +2699,22 @@ struct part_t* get_part_from_pn( const char* pn ){
 
 }
 
+/* Create struct from parsed item in database, from part number */
+struct part_t* get_part_from_pn( const char* pn ){
+	return get_part_from_pn_suggest( pn, NULL, NULL );
+}
+
+/* Free part numbers from get_part_from_pn_suggest */
+void free_pn_suggest( char** suggest, unsigned int n ){
+	if( NULL == suggest ){
+		return;
+	}
+	for( unsigned int i = 0; i < n; i++ ){
+		free( suggest[i] );
+	}
+	free( suggest );
+}
+
 /* Create struct from parsed item in database, from internal part number */
 struct part_t* get_part_from_ipn( const char* type, unsigned int ipn ){
 	struct part_t * part = NULL;	
@@ -2309,10 +3056,21 @@ struct proj_t* get_proj_from_ipn( unsigned int ipn, char* version ){
 		return NULL;
 	}
 
+	if( NULL == version ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return NULL;
+	}
+
+	/* Stop subprojects that point back to a parent */
+	if( proj_load_push( ipn, version ) ){
+		return NULL;
+	}
+
 	/* Allocate and create database name */
 	asprintf( &dbprj_name, "prj:%u:%s", ipn, version);
 	if( NULL == dbprj_name ){
 		y_log_message( Y_LOG_LEVEL_ERROR, "Could not allocate memory for dbprj_name");
+		proj_load_depth--;
 		return NULL;
 	}
 
@@ -2320,6 +3078,8 @@ struct proj_t* get_proj_from_ipn( unsigned int ipn, char* version ){
 	prj = calloc( 1, sizeof( struct proj_t ) );
 	if( NULL == prj ){
 		y_log_message( Y_LOG_LEVEL_ERROR, "Could not allocate memory for project: %ld", ipn);
+		free( dbprj_name );
+		proj_load_depth--;
 		return NULL;
 	}
 
@@ -2332,14 +3092,17 @@ struct proj_t* get_proj_from_ipn( unsigned int ipn, char* version ){
 
 	/* get project, store in json object */
 	if( !redis_json_get( rc, dbprj_name, "$", &jprj ) ){
-		/* Parse the json */
-		parse_json_proj( prj, jprj );
+		/* Parse the json; project is freed on failure */
+		if( parse_json_proj( prj, jprj ) ){
+			prj = NULL;
+		}
 	}
 	else {
 		y_log_message(Y_LOG_LEVEL_ERROR, "Could not get project %s", dbprj_name);
 		free_proj_t( prj );
 		prj = NULL;
 	}
+	proj_load_depth--;
 
 #if 0
 	/* Search part number by IPN */
@@ -2677,35 +3440,125 @@ static int write_dbinfo( struct dbinfo_t* db ){
 	y_log_message(Y_LOG_LEVEL_DEBUG, "Added items to object");
 
 	/* Write object to database */
-	int retval = redis_json_set( rc, dbinfo_name, "$", json_object_to_json_string(dbinfo_root) );
+	int retval = cas_json_set( dbinfo_name, &db->rev, dbinfo_root, NULL );
 	//y_log_message(Y_LOG_LEVEL_DEBUG, "JSON Object to send:\n%s\n", json_object_to_json_string_ext(dbinfo_root, JSON_C_TO_STRING_PRETTY));
 
 	/* Cleanup json object */
 	json_object_put( dbinfo_root );
 
-	return 0;
+	return retval;
 }
 
-/* Write database information; read modify write  */
+/* Write database information; only succeeds if nobody else has written it
+ * since it was read. Returns DB_ERR_CONFLICT otherwise */
 int redis_write_dbinfo( struct dbinfo_t* db ){
-#if 0
-	struct dbinfo_t* db_check;
-	do{
-		db_check = redis_read_dbinfo();
-		if( (db_check->flags & DBINFO_FLAG_LOCK) == DBINFO_FLAG_LOCK ){
-			sleep(2); /* Wait a little until lock is free */
-		}
+	return write_dbinfo( db );
+}
 
-	} while( (db_check->flags & DBINFO_FLAG_LOCK) == DBINFO_FLAG_LOCK );
+/* Find part type in dbinfo, appending it if it does not exist, and reserve a
+ * block of IPNs for it. Runs as a single script on the server, so clients
+ * creating parts at the same time can never be handed the same IPN.
+ * KEYS[1]: dbinfo key, ARGV[1]: part type, ARGV[2]: number of IPNs */
+static const char* alloc_part_ipn_script =
+	"local types = cjson.decode(redis.call('JSON.GET', KEYS[1], '$.ptypes[*].type')) "
+	"local idx = -1 "
+	"for i, t in ipairs(types) do "
+		"if t == ARGV[1] then idx = i - 1 break end "
+	"end "
+	"if idx < 0 then "
+		"redis.call('JSON.ARRAPPEND', KEYS[1], '$.ptypes', cjson.encode({type = ARGV[1], npart = 0})) "
+		"idx = #types "
+	"end "
+	"local last = cjson.decode(redis.call('JSON.NUMINCRBY', KEYS[1], '$.ptypes[' .. idx .. '].npart', ARGV[2])) "
+	"redis.call('JSON.NUMINCRBY', KEYS[1], '$.rev', 1) "
+	"return last[1]";
+
+/* Increment counter in dbinfo and bump its revision.
+ * KEYS[1]: dbinfo key, ARGV[1]: path of counter, ARGV[2]: increment */
+static const char* alloc_counter_script =
+	"local last = cjson.decode(redis.call('JSON.NUMINCRBY', KEYS[1], ARGV[1], ARGV[2])) "
+	"redis.call('JSON.NUMINCRBY', KEYS[1], '$.rev', 1) "
+	"return last[1]";
+
+/* Reserve IPNs from a counter in dbinfo; returns the last IPN reserved */
+static int alloc_dbinfo_counter( const char* path, unsigned int n, unsigned int* last ){
+	redisReply* reply = NULL;
+	int retval = -1;
 
-	/* Cleanup temporary info */
-	free_dbinfo_t( db_check );
-	free( db_check );
-#endif
+	if( NULL == rc ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "Database is not connected. Could not increment %s", path );
+		return -1;
+	}
 
-	/* now write data */
-	return write_dbinfo( db );
+	/* Increment in place; nothing else in dbinfo is rewritten */
+	reply = redisCommand( rc, "EVAL %s 1 popdb %s %u", alloc_counter_script, path, n );
+	if( NULL == reply ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "Lost connection while incrementing %s", path );
+		return -1;
+	}
+
+	if( REDIS_REPLY_INTEGER == reply->type && reply->integer > 0 ){
+		*last = (unsigned int)reply->integer;
+		retval = 0;
+	}
+	if( retval ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "Could not increment %s: %s", path, (REDIS_REPLY_ERROR == reply->type) ? reply->str : "unexpected reply" );
+	}
+
+	freeReplyObject( reply );
+	return retval;
+}
+
+/* Reserve block of n consecutive IPNs for a part type */
+int redis_alloc_part_ipn( const char* type, unsigned int n, unsigned int* first ){
+	redisReply* reply = NULL;
+	int retval = -1;
+
+	if( NULL == type || NULL == first ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return -1;
+	}
+	if( NULL == rc ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "Database is not connected. Could not allocate IPN for type %s", type );
+		return -1;
+	}
+
+	reply = redisCommand( rc, "EVAL %s 1 popdb %s %u", alloc_part_ipn_script, type, n );
+	if( NULL == reply ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "Lost connection while allocating IPN for type %s", type );
+		return -1;
+	}
+
+	if( REDIS_REPLY_INTEGER == reply->type ){
+		/* Script returns the last IPN of the block */
+		*first = (unsigned int)reply->integer - n + 1;
+		y_log_message( Y_LOG_LEVEL_DEBUG, "Reserved %u IPNs for type %s starting at %u", n, type, *first );
+		retval = 0;
+	}
+	else {
+		y_log_message( Y_LOG_LEVEL_ERROR, "Could not allocate IPN for type %s: %s", type, (REDIS_REPLY_ERROR == reply->type) ? reply->str : "unexpected reply" );
+	}
 
+	freeReplyObject( reply );
+	return retval;
+}
+
+/* Reserve next project IPN */
+int redis_alloc_proj_ipn( unsigned int* ipn ){
+	if( NULL == ipn ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return -1;
+	}
+	return alloc_dbinfo_counter( "$.nprj", 1, ipn );
+}
+
+/* Reserve next BOM IPN */
+int redis_alloc_bom_ipn( unsigned int* ipn ){
+	if( NULL == ipn ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return -1;
+	}
+	return alloc_dbinfo_counter( "$.nbom", 1, ipn );
 }
 
 /* Lock access to dbinfo */
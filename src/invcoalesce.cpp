@@ -0,0 +1,189 @@
+#include <invcoalesce.h>
+#include <vector>
+#include <thread>
+
+/* Inventory changes made from the UI */
+class Invcoalesce inv_coalesce( INVCOALESCE_WINDOW_MS );
+
+/* Private functions for operations; NOT THREAD SAFE. USE MUTEX IN CALLED
+ * FUNCTION */
+
+/* Hand all pending changes to the task pool as one batch. Does nothing while
+ * another batch is still being written */
+int Invcoalesce::_submit( void ){
+	if( pending.empty() || writing ){
+		return 0;
+	}
+
+	invcoalesce_map_t* batch = new invcoalesce_map_t;
+	batch->swap( pending );
+	writing = true;
+
+	int retval = task_pool.submit( [this, batch](){
+		_write( batch );
+		delete batch;
+		while( !cmtx.try_lock() );
+		writing = false;
+		cmtx.unlock();
+	});
+	if( retval ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "Could not start writing %zu inventory changes", batch->size() );
+		pending.swap( *batch );
+		delete batch;
+		writing = false;
+		return -1;
+	}
+	return 0;
+}
+
+/* Write batch of changes. Changes that could not be written are put back and
+ * tried again after another window. Takes the mutex itself, so it must not be
+ * held when called */
+int Invcoalesce::_write( invcoalesce_map_t* batch ){
+	std::vector< struct inv_delta_t > deltas;
+	deltas.reserve( batch->size() );
+	for( auto& itr : *batch ){
+		struct inv_delta_t d;
+		d.type = const_cast<char*>( std::get<0>( itr.first ).c_str() );
+		d.ipn = std::get<1>( itr.first );
+		d.loc = std::get<2>( itr.first );
+		d.delta = itr.second;
+		d.err = 0;
+		d.applied = 0;
+		deltas.push_back( d );
+	}
+
+	int retval = 0;
+	{
+		PROF_SCOPE( prof_db );
+		retval = redis_write_inv_deltas( deltas.data(), deltas.size() );
+	}
+
+	/* Merge what was not written with changes made in the meantime */
+	unsigned int nfailed = 0;
+	unsigned int i = 0;
+	while( !cmtx.try_lock() );
+	for( auto itr = batch->begin(); itr != batch->end(); ++itr, i++ ){
+		if( 0 == deltas[i].err ){
+			continue;
+		}
+		if( pending.empty() ){
+			first = std::chrono::steady_clock::now();
+		}
+		pending[itr->first] += itr->second;
+		if( 0 == pending[itr->first] ){
+			pending.erase( itr->first );
+		}
+		nfailed++;
+	}
+	if( nfailed > 0 ){
+		y_log_message( Y_LOG_LEVEL_WARNING, "%u inventory changes still pending after write", nfailed );
+		first = std::chrono::steady_clock::now();
+	}
+	cmtx.unlock();
+
+	return retval;
+}
+
+/* Public functions */
+
+Invcoalesce::Invcoalesce( unsigned int window_ms ){
+	while( !cmtx.try_lock() );
+	writing = false;
+	window = std::chrono::milliseconds( window_ms );
+	first = std::chrono::steady_clock::now();
+	cmtx.unlock();
+}
+
+/* Destructor; anything left pending at this point is lost */
+Invcoalesce::~Invcoalesce(){
+	while( !cmtx.try_lock() );
+	if( !pending.empty() ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "Discarding %zu inventory changes that were never written", pending.size() );
+	}
+	pending.clear();
+	cmtx.unlock();
+}
+
+/* Return number of pending changes */
+unsigned int Invcoalesce::size( void ){
+	unsigned int len = 0;
+	while( !cmtx.try_lock() );
+	len = pending.size();
+	cmtx.unlock();
+	return len;
+}
+
+/* Add change in stock for part at location; merged with any other pending
+ * change of the same part and location */
+int Invcoalesce::add( struct part_t* p, unsigned int loc, int delta ){
+	if( nullptr == p || nullptr == p->type ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return -1;
+	}
+
+	while( !cmtx.try_lock() );
+	if( pending.empty() ){
+		first = std::chrono::steady_clock::now();
+	}
+	auto key = std::make_tuple( std::string( p->type ), p->ipn, loc );
+	pending[key] += delta;
+	/* Changes that cancel out do not need to be written */
+	if( 0 == pending[key] ){
+		pending.erase( key );
+	}
+	cmtx.unlock();
+
+	return 0;
+}
+
+/* Start writing pending changes on the task pool if the oldest one has been
+ * held for the full window. Cheap enough to call every frame */
+int Invcoalesce::poll( void ){
+	int retval = 0;
+	if( cmtx.try_lock() ){
+		if( !pending.empty() && (std::chrono::steady_clock::now() - first) >= window ){
+			retval = _submit();
+		}
+		cmtx.unlock();
+	}
+	return retval;
+}
+
+/* Start writing all pending changes on the task pool without waiting for the
+ * window */
+int Invcoalesce::start( void ){
+	int retval = 0;
+	while( !cmtx.try_lock() );
+	retval = _submit();
+	cmtx.unlock();
+	return retval;
+}
+
+/* Write all pending changes now on the calling thread, after any batch still
+ * being written on the task pool */
+int Invcoalesce::flush( void ){
+	invcoalesce_map_t batch;
+	int retval = 0;
+
+	while( true ){
+		while( !cmtx.try_lock() );
+		if( !writing ){
+			break;
+		}
+		cmtx.unlock();
+		std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+	}
+	batch.swap( pending );
+	writing = true;
+	cmtx.unlock();
+
+	if( !batch.empty() ){
+		retval = _write( &batch );
+	}
+
+	while( !cmtx.try_lock() );
+	writing = false;
+	cmtx.unlock();
+	return retval;
+}
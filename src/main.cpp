@@ -7,6 +7,7 @@
 #include <time.h>
 #include <vector>
 #include <iterator>
+#include <algorithm>
 #include <atomic>
 #include <sstream>
 #include <GLFW/glfw3.h>
@@ -18,10 +19,19 @@
 #include <L2DFileDialog.h>
 #include <prjcache.h>
 #include <partcache.h>
+#include <invcoalesce.h>
+#include <changequeue.h>
+#include <uiidle.h>
+#include <profiler.h>
 //#include <invcache.h>
 #include <ui_projview.h>
 #include <ui_parts.h>
 #include <proj_funct.h>
+#include <part_funct.h>
+#include <tablesort.h>
+#include <partindex.h>
+#include <partparam.h>
+#include <stockhist.h>
 #include <ctype.h>
 #include <dbstat_def.h>
 
@@ -56,7 +66,7 @@ static void glfw_error_callback(int error, const char* description){
 static void show_part_select_window( struct dbinfo_t ** info, std::vector< Partcache*>* cache, int* selected );
 
 static void new_proj_window( struct dbinfo_t** info );
-static void new_bom_window( struct dbinfo_t** info );
+static void new_bom_window( struct dbinfo_t** info, std::vector<Partcache*>* caches );
 static void show_root_window( struct dbinfo_t** info, class Prjcache* prj_cache, std::vector< Partcache*>* part_cache );
 static void import_parts_window( void );
 static void db_settings_window( struct db_settings_t * set );
@@ -85,12 +95,26 @@ enum view_type {
 
 static enum view_type current_view = project_view;
 
+/* Change the current view; pending inventory changes are sent right away so
+ * the new view is not showing stale stock for long */
+static void set_view( enum view_type view ){
+	if( view != current_view ){
+		inv_coalesce.start();
+		current_view = view;
+	}
+}
+
 bool show_new_part_window = false;
 bool show_edit_part_window = false;
 bool show_new_proj_window = false;
 bool show_new_bom_window = false;
 bool show_import_parts_window = false;
 bool show_db_settings_window = false;
+bool show_planner_window = false;
+bool show_portfolio_window = false;
+#ifdef PROFILER_ENABLE
+bool show_profiler_window = false;
+#endif
 
 #define DEFAULT_ROOT_W	1280
 #define DEFAULT_ROOT_H	720
@@ -98,6 +122,47 @@ bool show_db_settings_window = false;
 /* Variable to continue running */
 static std::atomic<bool> run_flag = true;
 
+/* Part type of a cache to be created on the UI thread */
+struct part_cache_type_t {
+	unsigned int npart;
+	std::string name;
+};
+
+/* Part type caches are created and deleted on the UI thread only, as the UI,
+ * part_index and the part table hold pointers to them. The database thread
+ * asks for a resize through cache_changes, and does not take the set again
+ * until every resize it asked for has been applied. Mutex guards the vector
+ * and the counters */
+static std::mutex part_cache_mtx;
+static unsigned int part_cache_want = 0;
+static unsigned int part_cache_have = 0;
+
+/* Incremented whenever part type caches are created or deleted; UI thread
+ * only */
+static unsigned int part_caches_gen = 0;
+
+/* Resize part type caches to nptype, creating caches of types from the
+ * current size up. Runs on the UI thread */
+static void part_cache_resize( std::vector<Partcache*>* part_cache, unsigned int nptype, const std::vector<struct part_cache_type_t>* types, unsigned int seq ){
+	part_cache_mtx.lock();
+	unsigned int old_size = part_cache->size();
+	for( unsigned int i = nptype; i < old_size; i++ ){
+		/* Drops its refreshes still queued too */
+		delete (*part_cache)[i];
+	}
+	part_cache->resize( nptype, nullptr );
+	for( unsigned int i = old_size; i < nptype && ( i - old_size ) < types->size(); i++ ){
+		(*part_cache)[i] = new Partcache( (*types)[i - old_size].npart, (*types)[i - old_size].name );
+	}
+	part_cache_have = seq;
+	part_cache_mtx.unlock();
+
+	/* Nothing may keep pointing at a deleted cache */
+	part_index.update( part_cache );
+	part_caches_gen++;
+	y_log_message( Y_LOG_LEVEL_DEBUG, "Resized partcache to %u", nptype );
+}
+
 static int thread_db_connection( Prjcache* prj_cache, std::vector<Partcache*>* part_cache ) {
 	
 	/* Just need some buffer before beginning */
@@ -109,6 +174,7 @@ static int thread_db_connection( Prjcache* prj_cache, std::vector<Partcache*>* p
 	while( run_flag ){
 		/* Check flags for projects and handle them */
 		if( db_stat == DB_STAT_CONNECTED ){
+			PROF_SCOPE( prof_db );
 
 			/* update dbinfo */
 			if( mutex_lock_dbinfo() == 0 ){
@@ -132,40 +198,45 @@ static int thread_db_connection( Prjcache* prj_cache, std::vector<Partcache*>* p
 					/* Update caches */
 					prj_cache->update( &dbinfo );
 
-					/* Ensure that the vector is the correct size for the part types */
-					if( dbinfo->nptype > part_cache->size() ){
-						/* Data is out of date, critical to update */
-						mutex_spin_lock_dbinfo();
-						/* Fix the size */
-						unsigned int old_size = part_cache->size();
-
-						part_cache->assign(dbinfo->nptype, nullptr);
-						for( unsigned int i = old_size; i < part_cache->size(); i++){
-							(*part_cache)[i] = new Partcache(dbinfo->ptypes[i].npart, dbinfo->ptypes[i].name);
-							if( (*part_cache)[i]->update( &dbinfo ) ){
-								y_log_message( Y_LOG_LEVEL_ERROR,"Could not update part cache: %s", (*part_cache)[i]->type.c_str()); 
-							}
-						}
-						/* Unlock dbinfo */
-						mutex_unlock_dbinfo();
-						y_log_message( Y_LOG_LEVEL_DEBUG, "Resized partcache to %d", dbinfo->nptype);
+					/* Caches are only created and deleted on the UI thread.
+					 * Take the current set, unless a resize asked for before
+					 * has not been applied yet */
+					std::vector<Partcache*> caches;
+					bool settled = false;
+					part_cache_mtx.lock();
+					settled = ( part_cache_have == part_cache_want );
+					if( settled ){
+						caches = *part_cache;
 					}
-					else if( dbinfo->nptype < part_cache->size() ){
-						/* Data is out of date, critical to update */
+					part_cache_mtx.unlock();
+
+					if( settled && dbinfo->nptype != caches.size() ){
+						std::vector<struct part_cache_type_t> types;
 						mutex_spin_lock_dbinfo();
-						unsigned int old_size = part_cache->size();
-						/* Delete extra caches */
-						for( unsigned int i = dbinfo->nptype; i < old_size ; i++ ){
-							delete ((*part_cache)[i]);
+						for( unsigned int i = caches.size(); i < dbinfo->nptype; i++ ){
+							types.push_back( { dbinfo->ptypes[i].npart, dbinfo->ptypes[i].name } );
 						}
-						part_cache->resize(dbinfo->nptype);
-						/* Unlock dbinfo */
+						unsigned int nptype = dbinfo->nptype;
 						mutex_unlock_dbinfo();
+
+						part_cache_mtx.lock();
+						unsigned int seq = ++part_cache_want;
+						part_cache_mtx.unlock();
+						cache_changes.push( part_cache, [part_cache, nptype, types, seq](){
+								part_cache_resize( part_cache, nptype, &types, seq );
+							}, nullptr );
+
+						/* Caches past the new size are deleted once this is
+						 * applied; new ones are loaded on the next refresh */
+						if( nptype < caches.size() ){
+							caches.resize( nptype );
+						}
 					}
-					for( unsigned int i = 0; i < part_cache->size() ; i++ ){
-						if( nullptr != (*part_cache)[i] ){
-							if( (*part_cache)[i]->update( &dbinfo ) ){
-								y_log_message( Y_LOG_LEVEL_ERROR,"Could not update part cache: %s", (*part_cache)[i]->type.c_str()); 
+
+					for( unsigned int i = 0; i < caches.size() ; i++ ){
+						if( nullptr != caches[i] ){
+							if( caches[i]->update( &dbinfo ) ){
+								y_log_message( Y_LOG_LEVEL_ERROR,"Could not update part cache: %s", caches[i]->type.c_str()); 
 							}
 						}
 					}
@@ -182,6 +253,19 @@ static int thread_db_connection( Prjcache* prj_cache, std::vector<Partcache*>* p
 	return 0;
 }
 
+/* Input this frame that needs following frames drawn */
+static bool ui_interacting( ImGuiIO& io ){
+	if( 0.0f != io.MouseDelta.x || 0.0f != io.MouseDelta.y || 0.0f != io.MouseWheel ){
+		return true;
+	}
+	for( unsigned int i = 0; i < sizeof( io.MouseDown ) / sizeof( io.MouseDown[0] ); i++ ){
+		if( io.MouseDown[i] ){
+			return true;
+		}
+	}
+	return ImGui::IsAnyItemActive() || io.WantTextInput;
+}
+
 static int thread_ui( class Prjcache* prj_cache, std::vector<Partcache *>* part_cache  ) {
 
 	y_log_message( Y_LOG_LEVEL_INFO, "Start thread_ui" );
@@ -258,21 +342,42 @@ static int thread_ui( class Prjcache* prj_cache, std::vector<Partcache *>* part_
 	/* Use first project as first selected node */
 	prj_cache->select(0);
 
+	/* Background threads may wake the loop from here on */
+	ui_idle.set_ready( true );
+
 	/* Main application loop */
 	while( !glfwWindowShouldClose(window) ) {
 
-		/* Poll and handle events */
-		glfwPollEvents();
+		/* Handle events. While idle, sleep until input or a background
+		 * thread wakes the loop; pending changes are drawn at full rate, and
+		 * coalesced inventory only needs a short timer */
+		if( cache_changes.backlog() > 0 ){
+			ui_idle.active();
+		}
+		ui_idle.wait( ( inv_coalesce.size() > 0 ) ? UIIDLE_BUSY_TIMEOUT_S : UIIDLE_TIMEOUT_S );
+		PROF_FRAME_BEGIN();
 
 		if( !run_flag ){
 			y_log_message(Y_LOG_LEVEL_DEBUG, "Quit button pressed");
 			glfwSetWindowShouldClose(window, true);
 		}
+
+		/* Apply refreshed cache data, a little at a time so large refreshes
+		 * are spread across frames */
+		{
+			PROF_SCOPE( prof_changes );
+			cache_changes.drain( std::chrono::microseconds( CHANGEQUEUE_BUDGET_US ) );
+		}
 		/* Start ImGui frame */
 		ImGui_ImplOpenGL3_NewFrame();
 		ImGui_ImplGlfw_NewFrame();
 		ImGui::NewFrame();
 
+		/* Keep drawing while the user is interacting */
+		if( ui_interacting( io ) ){
+			ui_idle.active();
+		}
+
 		/* Setup root window. Keep size dynamic to maximum area */
 		ImGui::SetNextWindowPos(ImVec2(main_viewport->WorkPos.x, main_viewport->WorkPos.y));
 		ImGui::SetNextWindowSize(ImVec2(display_w, display_h));
@@ -297,7 +402,7 @@ static int thread_ui( class Prjcache* prj_cache, std::vector<Partcache *>* part_
 			new_proj_window( &dbinfo );
 		}
 		if( show_new_bom_window ){
-			new_bom_window( &dbinfo );
+			new_bom_window( &dbinfo, part_cache );
 		}
 		if( show_import_parts_window ){
 			import_parts_window();
@@ -305,25 +410,48 @@ static int thread_ui( class Prjcache* prj_cache, std::vector<Partcache *>* part_
 		if( show_db_settings_window ){
 			db_settings_window(&db_set );
 		}
+		{
+			PROF_SCOPE( prof_windows );
+			if( show_planner_window ){
+				planner_window( &show_planner_window, prj_cache );
+			}
+			if( show_portfolio_window ){
+				portfolio_window( &show_portfolio_window, prj_cache );
+			}
+		}
+#ifdef PROFILER_ENABLE
+		if( show_profiler_window ){
+			PROF_WINDOW( &show_profiler_window );
+		}
+#endif
 		show_root_window( &dbinfo, prj_cache, part_cache);
 		ImGui::End();
 
+		/* Write inventory changes once they have settled */
+		inv_coalesce.poll();
+
 		/* End Projects view creation */
 
 
 		/* Rendering section */
-		ImGui::Render();
-		glfwGetFramebufferSize( window, &display_w, &display_h);
-		glViewport(0, 0, display_w, display_h);
-		glClearColor( clear_color.x * clear_color.w, clear_color.y * clear_color.w, clear_color.z * clear_color.w, clear_color.w);
-		glClear( GL_COLOR_BUFFER_BIT );
-		ImGui_ImplOpenGL3_RenderDrawData( ImGui::GetDrawData());
+		{
+			PROF_SCOPE( prof_render );
+			ImGui::Render();
+			glfwGetFramebufferSize( window, &display_w, &display_h);
+			glViewport(0, 0, display_w, display_h);
+			glClearColor( clear_color.x * clear_color.w, clear_color.y * clear_color.w, clear_color.z * clear_color.w, clear_color.w);
+			glClear( GL_COLOR_BUFFER_BIT );
+			ImGui_ImplOpenGL3_RenderDrawData( ImGui::GetDrawData());
+		}
 
+		/* Swap waits for vsync, so it is left out of the frame time */
+		PROF_FRAME_END();
 		glfwSwapBuffers(window);
 
 	}
 
 	/* Application cleanup */
+	ui_idle.set_ready( false );
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
@@ -378,9 +506,13 @@ int open_db( struct db_settings_t* set, struct dbinfo_t** info, class Prjcache*
 			retval = prjcache->update( info );
 
 			/* Ensure that the vector is the correct size for the part types */
+			part_cache_mtx.lock();
 			if( (*info)->nptype != partcaches->size() ){
 				/* Fix the size */
-				partcaches->assign((*info)->nptype, nullptr);
+				for( unsigned int i = (*info)->nptype; i < partcaches->size(); i++ ){
+					delete (*partcaches)[i];
+				}
+				partcaches->resize((*info)->nptype, nullptr);
 				y_log_message( Y_LOG_LEVEL_DEBUG, "Resized partcache to %d", (*info)->nptype);
 			}
 
@@ -396,6 +528,8 @@ int open_db( struct db_settings_t* set, struct dbinfo_t** info, class Prjcache*
 					y_log_message( Y_LOG_LEVEL_ERROR,"Could not update part cache: %s", (*partcaches)[i]->type.c_str());
 				}
 			}
+			part_caches_gen++;
+			part_cache_mtx.unlock();
 
 			db_stat = DB_STAT_CONNECTED;
 		}
@@ -432,6 +566,9 @@ int main( int, char** ){
 	/* Cleanup */
 	db_stat = DB_STAT_DISCONNECTED;
 
+	/* Write any inventory changes still waiting */
+	inv_coalesce.flush();
+
 	/* Disconnect from database */
 	redis_disconnect();
 
@@ -493,14 +630,16 @@ static void show_part_select_window( struct dbinfo_t ** info, std::vector< Partc
 //		mutex_spin_lock_dbinfo();
 		//if( nullptr != info && nullptr != (*info) && cache->size() > 0 ){
 		bool is_selected = false;
-		if( cache->size() > 0 ){
-			bool node_clicked[cache->size()] = {false};
-			if( DB_STAT_DISCONNECTED != db_stat ){
-				for( unsigned int i = 0; i < cache->size(); i++ ){
+		if( cache->size() > 0 && DB_STAT_DISCONNECTED != db_stat ){
+			/* Only types in view are drawn */
+			ImGuiListClipper clipper;
+			clipper.Begin( (int)cache->size() );
+			while( clipper.Step() ){
+				for( int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++ ){
 					/* Check if item has been clicked */
-					node_clicked[i] = (*selected == i);
-					(*cache)[i]->display_parts(&(node_clicked[i]));
-					if( node_clicked[i] ){
+					bool node_clicked = (*selected == i);
+					(*cache)[i]->display_parts( &node_clicked );
+					if( node_clicked ){
 						y_log_message( Y_LOG_LEVEL_DEBUG, "Part type %s is open", (*cache)[i]->type.c_str() );
 						*selected = i;
 					}
@@ -842,6 +981,7 @@ static void new_proj_window( struct dbinfo_t** info ){
 			for( unsigned int i = 0; i < nboms; i++){
 				prj->boms[i].ver = (char *)calloc( strlen( (char *)bom_versions[i].c_str() ) + 1, sizeof( char ) );
 				strcpy( prj->boms[i].ver, (char *)bom_versions[i].c_str());
+				prj->boms[i].q = 1;
 				prj->boms[i].bom = (struct bom_t*)calloc( 1, sizeof( struct bom_t ) );
 				prj->boms[i].bom->ipn = bom_ipns[i];
 			}
@@ -855,23 +995,24 @@ static void new_proj_window( struct dbinfo_t** info ){
 			for( unsigned int i = 0; i < nsubprj; i++){
 				prj->sub[i].ver = (char *)calloc( strlen( (char *)subprj_versions[i].c_str() ) + 1, sizeof( char ) );
 				strcpy( prj->sub[i].ver, (char *)subprj_versions[i].c_str());
+				prj->sub[i].q = 1;
 				prj->sub[i].prj = (struct proj_t*)calloc( 1, sizeof( struct proj_t ) );
 				prj->sub[i].prj->ipn = subprj_ipns[i];
 
 			}
 
-			/* Increment database information */
+			/* Reserve project number on the server */
 			mutex_spin_lock_dbinfo();
-			(*info)->nprj++;
-			prj->ipn = (*info)->nprj;
-			/* Perform the write */
-			redis_write_proj( prj ); /* NOTE: Segfault due to data race occurred; need to investigate */
-			y_log_message(Y_LOG_LEVEL_DEBUG, "Data written to database");
+			if( redis_alloc_proj_ipn( &prj->ipn ) ){
+				y_log_message(Y_LOG_LEVEL_ERROR, "Could not allocate IPN for new project");
+			}
+			else {
+				/* Perform the write */
+				redis_write_proj( prj ); /* NOTE: Segfault due to data race occurred; need to investigate */
+				y_log_message(Y_LOG_LEVEL_DEBUG, "Data written to database");
+			}
 			show_new_proj_window = false;
 
-
-			redis_write_dbinfo( *info );
-
 			/* Make sure to read back the same data incase something went wrong */
 			if( nullptr != (*info) ){
 				/* free existing data */
@@ -932,7 +1073,86 @@ static void new_proj_window( struct dbinfo_t** info ){
 
 }
 
-static void new_bom_window( struct dbinfo_t** info ){
+/* Resolve part number of every BOM line, from loaded parts where possible and
+ * from the database otherwise. Only whole part numbers are taken; for lines
+ * that are not found, part numbers the database search turned up instead are
+ * put in suggest. Parts are new references; on failure none are kept. Returns
+ * true if every line was found */
+static bool resolve_bom_parts( std::vector<std::string>* names, std::vector<struct part_t*>* parts, std::vector<std::vector<std::string>>* suggest ){
+	bool found = true;
+
+	parts->assign( names->size(), nullptr );
+	suggest->assign( names->size(), std::vector<std::string>() );
+	for( unsigned int i = 0; i < names->size(); i++ ){
+		y_log_message(Y_LOG_LEVEL_DEBUG, "Get part number: %s", (*names)[i].c_str());
+		(*parts)[i] = part_index.find_pn( (*names)[i].c_str() );
+		if( nullptr == (*parts)[i] ){
+			/* Not loaded; database search is a round trip */
+			char** near = nullptr;
+			unsigned int nnear = 0;
+			(*parts)[i] = get_part_from_pn_suggest( (*names)[i].c_str(), &near, &nnear );
+			for( unsigned int j = 0; j < nnear; j++ ){
+				(*suggest)[i].push_back( near[j] );
+			}
+			free_pn_suggest( near, nnear );
+		}
+		if( nullptr == (*parts)[i] ){
+			y_log_message(Y_LOG_LEVEL_ERROR, "Could not find part %s for BOM line %u", (*names)[i].c_str(), i + 1);
+			found = false;
+		}
+	}
+
+	if( !found ){
+		for( auto p : *parts ){
+			if( nullptr != p ){
+				free_part_t( p );
+			}
+		}
+		parts->clear();
+	}
+	return found;
+}
+
+/* Show what part number of BOM line resolves to among loaded parts. Prefix
+ * matches are offered while the part number is incomplete; picking one fills
+ * it in */
+static void bom_line_lookup( std::string* pn ){
+	static std::vector<struct partindex_doc_t> hits;
+
+	if( pn->empty() ){
+		return;
+	}
+
+	if( part_index.lookup( pn->c_str(), pidx_pn, false, &hits, 0 ) > 0 ){
+		struct part_t* p = hits[0].cache->read( hits[0].idx );
+		if( nullptr != p ){
+			ImGui::TextDisabled( "%s, %s%s", ( nullptr != p->mfg ) ? p->mfg : "", ( nullptr != p->type ) ? p->type : "", ( hits.size() > 1 ) ? " (several parts match)" : "" );
+		}
+		return;
+	}
+
+	if( 0 == part_index.lookup( pn->c_str(), pidx_pn, true, &hits, PARTINDEX_SUGGEST_MAX ) ){
+		ImGui::TextDisabled( "Not loaded; will be looked up in database" );
+		return;
+	}
+	ImGui::Indent();
+	for( unsigned int i = 0; i < hits.size(); i++ ){
+		struct part_t* p = hits[i].cache->read( hits[i].idx );
+		if( nullptr == p || nullptr == p->mpn ){
+			continue;
+		}
+		ImGui::PushID( (int)i );
+		if( ImGui::Selectable( p->mpn ) ){
+			*pn = p->mpn;
+		}
+		ImGui::SameLine();
+		ImGui::TextDisabled( "%s", ( nullptr != p->mfg ) ? p->mfg : "" );
+		ImGui::PopID();
+	}
+	ImGui::Unindent();
+}
+
+static void new_bom_window( struct dbinfo_t** info, std::vector<Partcache*>* caches ){
 	static struct bom_t * bom = NULL;
 
 	/* Buffers for text input. Can also be used for santizing inputs */
@@ -983,6 +1203,14 @@ static void new_bom_window( struct dbinfo_t** info ){
 		std::string line_pn_ident;
 		std::string line_q_ident;
 
+		/* Part numbers offered for lines not found on the last save */
+		static std::vector<std::vector<std::string>> line_suggest;
+
+		/* Part numbers are checked against loaded parts as they are typed */
+		if( nullptr != caches ){
+			part_index.update( caches );
+		}
+
 		for( unsigned int i = 0; i < nparts; i++ ){
 			line_pn_ident = "##line_pn" + std::to_string(i);
 			line_q_ident = "##line_q" + std::to_string(i);
@@ -991,6 +1219,27 @@ static void new_bom_window( struct dbinfo_t** info ){
 			ImGui::Text("Manufacturer Part Number");
 			ImGui::SameLine();
 			ImGui::InputText(line_pn_ident.c_str(), &(*line_name_itr), ImGuiInputTextFlags_CharsNoBlank  );
+			ImGui::PushID( (int)i );
+			bom_line_lookup( &(*line_name_itr) );
+
+			/* Part number was not found when saving; offer what the
+			 * database search found instead */
+			if( i < line_suggest.size() && !line_suggest[i].empty() ){
+				ImGui::TextDisabled( "Not found in database; similar part numbers:" );
+				ImGui::Indent();
+				for( unsigned int j = 0; j < line_suggest[i].size(); j++ ){
+					ImGui::PushID( (int)j );
+					if( ImGui::Selectable( line_suggest[i][j].c_str() ) ){
+						*line_name_itr = line_suggest[i][j];
+						line_suggest[i].clear();
+						ImGui::PopID();
+						break;
+					}
+					ImGui::PopID();
+				}
+				ImGui::Unindent();
+			}
+			ImGui::PopID();
 
 			ImGui::Text("Quantity");
 			ImGui::SameLine();
@@ -1004,8 +1253,15 @@ static void new_bom_window( struct dbinfo_t** info ){
 		
 
 
-		/* Save and cancel buttons */
-		if( ImGui::Button("Save", ImVec2(0,0)) ){
+		/* Save and cancel buttons. Nothing is written unless every part was
+		 * found */
+		static std::vector<struct part_t*> line_parts;
+		static bool parts_missing = false;
+		bool save = ImGui::Button("Save", ImVec2(0,0));
+		if( save ){
+			parts_missing = !resolve_bom_parts( &line_name, &line_parts, &line_suggest );
+		}
+		if( save && !parts_missing ){
 
 			/* Check if valid to copy */
 			bom = (struct bom_t *)calloc(1, sizeof(struct bom_t));
@@ -1033,9 +1289,12 @@ static void new_bom_window( struct dbinfo_t** info ){
 				return;
 			}
 			for( unsigned int i = 0; i < bom->nitems; i++){
-				y_log_message(Y_LOG_LEVEL_DEBUG, "Get part number: %s", line_name[i].c_str());
-				bom->parts[i] = get_part_from_pn( line_name[i].c_str() );
+				bom->parts[i] = ( i < line_parts.size() ) ? line_parts[i] : nullptr;
 			}
+			for( unsigned int i = bom->nitems; i < line_parts.size(); i++ ){
+				free_part_t( line_parts[i] );
+			}
+			line_parts.clear();
 
 			/* Line items */
 			bom->line = (struct bom_line_t*)calloc( bom->nitems, sizeof( struct bom_line_t) );
@@ -1053,18 +1312,18 @@ static void new_bom_window( struct dbinfo_t** info ){
 
 			}
 
-			/* Increment database information */
+			/* Reserve BOM number on the server */
 			mutex_spin_lock_dbinfo();
-			(*info)->nbom++;
-			bom->ipn = (*info)->nbom;
-			/* Perform the write */
-			redis_write_bom( bom );
-			y_log_message(Y_LOG_LEVEL_DEBUG, "New BOM written to database");
+			if( redis_alloc_bom_ipn( &bom->ipn ) ){
+				y_log_message(Y_LOG_LEVEL_ERROR, "Could not allocate IPN for new BOM");
+			}
+			else {
+				/* Perform the write */
+				redis_write_bom( bom );
+				y_log_message(Y_LOG_LEVEL_DEBUG, "New BOM written to database");
+			}
 			show_new_bom_window = false;
 
-
-			redis_write_dbinfo( *info );
-
 			/* Make sure to read back the same data incase something went wrong */
 			if( nullptr != (*info) ){
 				/* free existing data */
@@ -1086,6 +1345,10 @@ static void new_bom_window( struct dbinfo_t** info ){
 		ImGui::SameLine();
 		if ( ImGui::Button("Cancel", ImVec2(0, 0) )){
 			show_new_bom_window = false;
+			line_suggest.clear();
+		}
+		if( parts_missing ){
+			ImGui::Text("Some parts could not be found; BOM was not saved");
 		}
 
 		ImGui::End();
@@ -1273,13 +1536,13 @@ static void show_menu_bar( class Prjcache* prjcache, std::vector<Partcache*>* pa
 		/* View Menu */
 		if( ImGui::BeginMenu("View") ){
 			if( ImGui::MenuItem("Project View") ){
-				current_view = project_view;	
+				set_view( project_view );
 			}
 			else if( ImGui::MenuItem("Part View") ){
-				current_view = part_view;
+				set_view( part_view );
 			}
 			else if( ImGui::MenuItem("Inventory View") ){
-				current_view = inventory_view;
+				set_view( inventory_view );
 			}
 			else if( !show_all_projects && ImGui::MenuItem("Show All Projects") ){
 				show_all_projects = true;
@@ -1287,6 +1550,11 @@ static void show_menu_bar( class Prjcache* prjcache, std::vector<Partcache*>* pa
 			else if( show_all_projects && ImGui::MenuItem("Hide All Projects") ){
 				show_all_projects = false;
 			}
+#ifdef PROFILER_ENABLE
+			else if( ImGui::MenuItem("Profiler") ){
+				show_profiler_window = true;
+			}
+#endif
 			ImGui::EndMenu();
 		}
 
@@ -1294,6 +1562,12 @@ static void show_menu_bar( class Prjcache* prjcache, std::vector<Partcache*>* pa
 		if( ImGui::BeginMenu("Project") ){
 			if( ImGui::MenuItem("Generate Report") ){
 				
+			}
+			else if( ImGui::MenuItem("Production Planner") ){
+				show_planner_window = true;
+			}
+			else if( ImGui::MenuItem("Portfolio") ){
+				show_portfolio_window = true;
 			}
 			else if( ImGui::MenuItem("Manage Project BOM")){
 
@@ -1364,13 +1638,106 @@ static void show_menu_bar( class Prjcache* prjcache, std::vector<Partcache*>* pa
 }
 
 
-static void part_info_tab( struct dbinfo_t** info, class Partcache* cache ){
+/* Sort keys of a part in the part table, copied out of the cache */
+struct part_status_disp_t {
+	const char* label;
+	bool colored;					/* Use col instead of default text colour */
+	ImVec4 col;
+};
+
+/* Status text and colour in the part table, indexed by part status */
+static const struct part_status_disp_t part_status_disp[pstat_total] = {
+	{ "Unknown", true, ImVec4(1.0f, 0.8117647f, 0.0f, 1.0f) },
+	{ "Production", false, ImVec4(1.0f, 1.0f, 1.0f, 1.0f) },
+	{ "Low Stock", true, ImVec4(1.0f, 0.8117647f, 0.0f, 1.0f) },
+	{ "Unavailable", true, ImVec4(1.0f, 0.0f, 0.0f, 1.0f) },
+	{ "Not Recommended for New Designs", true, ImVec4(1.0f, 0.0f, 0.0f, 1.0f) },
+	{ "Last Time Buy", true, ImVec4(1.0f, 0.0f, 0.0f, 1.0f) },
+	{ "Obsolete", true, ImVec4(1.0f, 0.0f, 0.0f, 1.0f) }
+};
+
+/* Display record of a part in the part table. Built once per cache
+ * generation, so drawing a row only emits prepared text */
+struct part_row_t {
+	class Partcache* cache;			/* Part type cache holding the part */
+	unsigned int idx;				/* Index in part cache */
+	std::string mpn;
+	std::string mfg;
+	std::string type;
+	unsigned int q;					/* Stock over all locations */
+	std::string q_str;				/* Formatted stock */
+	enum part_status_t status;
+	const struct part_status_disp_t* disp;
+};
+
+/* Fill display record from part */
+static void set_part_row( struct part_row_t* row, class Partcache* cache, unsigned int idx, struct part_t* p ){
+	row->cache = cache;
+	row->idx = idx;
+	row->mpn = ( nullptr != p->mpn ) ? p->mpn : "";
+	row->mfg = ( nullptr != p->mfg ) ? p->mfg : "";
+	row->type = ( nullptr != p->type ) ? p->type : "";
+	row->q = get_part_total_inventory( p );
+	row->q_str = std::to_string( row->q );
+	row->status = p->status;
+	if( p->status < 0 || p->status >= pstat_total ){
+		row->disp = &part_status_disp[pstat_unknown];
+	}
+	else {
+		row->disp = &part_status_disp[p->status];
+	}
+}
+
+/* Compare part table rows on a single column */
+static int cmp_part_row( const struct part_row_t* ra, const struct part_row_t* rb, int column ){
+	switch( column ){
+		case 0:
+			return ra->mpn.compare( rb->mpn );
+		case 1:
+			return ra->mfg.compare( rb->mfg );
+		case 2:
+			return (ra->q > rb->q) - (ra->q < rb->q);
+		case 3:
+			return ra->type.compare( rb->type );
+		case 4:
+			return (ra->status > rb->status) - (ra->status < rb->status);
+		default:
+			return 0;
+	}
+}
+
+static void part_info_tab( struct dbinfo_t** info, class Partcache* cache, std::vector<class Partcache*>* caches ){
 
 	static part_t *selected_item = NULL;	
+	static char filter[128] = "";
+	static char param[128] = "";
 
 
 	ImGui::Text("Project BOM Tab");
 
+	/* Filter over parts of every type; replaces the rows of this type while
+	 * there is text in it */
+	ImGui::SetNextItemWidth( -FLT_MIN );
+	ImGui::InputTextWithHint( "##part_filter", "Filter all parts by P/N, manufacturer, distributor P/N or info", filter, sizeof( filter ) - 1 );
+
+	/* Parametric filter over info values; both filters must hold */
+	ImGui::SetNextItemWidth( -FLT_MIN );
+	ImGui::InputTextWithHint( "##part_param", "Parametric filter, such as 90-110 nF, 0603, >=25 V or Package: 0805", param, sizeof( param ) - 1 );
+	bool text_filtering = ( '\0' != filter[0] );
+	bool param_filtering = ( '\0' != param[0] );
+	bool filtering = ( ( text_filtering || param_filtering ) && nullptr != caches );
+	const std::string* param_err = nullptr;
+	if( filtering ){
+		part_index.update( caches );
+		if( param_filtering ){
+			part_param.update( &part_index );
+			part_param.query( param, &param_err );
+		}
+	}
+	if( nullptr != param_err ){
+		ImGui::TextDisabled( "%s", param_err->c_str() );
+	}
+
 	/* Part Specific table view */
 
 	static ImGuiTableFlags table_flags = ImGuiTableFlags_SizingStretchProp | \
@@ -1393,108 +1760,204 @@ static void part_info_tab( struct dbinfo_t** info, class Partcache* cache ){
 
 		ImGui::TableHeadersRow();
 
-#if 0 
-		/* Sort the bom items list based off of what is currently
-		 * selected for sorting */
-		if(ImGuiTableSortSpecs* bom_sort_specs = ImGui::TableGetSortSpecs()){
-			/* Criteria changed; need to resort */
-			if( bom_sort_specs->SpecsDirty ){
-				if( bom.item.size() > 1 ){
-					//qsort( &bom.item[0], (size_t)bom.item.size(), sizeof( bom.item[0] ) );	
-				}
-				bom_sort_specs->SpecsDirty = false;
-			}
-		}
-#endif
-			
 		if( nullptr != cache ){
-			/* Used for selecting specific item in BOM */
-			bool item_sel[ cache->items() ] = {};
-			char part_mpn_label[64]; /* May need to change size at some point */
-			struct part_t* part = nullptr;
-			struct part_t* tmp = nullptr;
-			for( int i = 0; i < cache->items(); i++){
-				ImGui::TableNextRow();
-#if 0
-				if( nullptr != part ){
-					free_part_t( part );
-					part = nullptr;
+			/* Display records of loaded parts; only rebuilt when the cache
+			 * changes, so selection survives between frames. While filtering,
+			 * rows are every indexed part in document order. Parts are only
+			 * read from the cache when clicked */
+			static std::vector<struct part_row_t> rows;
+			static std::vector<unsigned int> order;
+			static std::vector<unsigned int> rank;
+			static std::vector<unsigned int> shown;
+			static std::string shown_filter;
+			static std::string shown_param;
+			static class Partcache* rows_cache = nullptr;
+			static unsigned int rows_gen = 0;
+			static unsigned int rows_items = 0;
+			static class Partcache* sel_cache = nullptr;
+			static unsigned int sel_idx = (unsigned int)-1;
+			bool rows_changed = false;
+
+			/* Caches were created or deleted; rows may point at a deleted one */
+			static unsigned int rows_caches_gen = 0;
+			if( rows_caches_gen != part_caches_gen ){
+				rows.clear();
+				rows_cache = nullptr;
+				rows_items = (unsigned int)-1;
+				sel_cache = nullptr;
+				sel_idx = (unsigned int)-1;
+				rows_caches_gen = part_caches_gen;
+			}
+
+			class Partcache* src = filtering ? nullptr : cache;
+			unsigned int src_gen = filtering ? part_index.generation() : cache->generation();
+			unsigned int src_items = filtering ? part_index.docs() : cache->items();
+			if( src != rows_cache || src_gen != rows_gen || src_items != rows_items ){
+				rows.clear();
+				if( filtering ){
+					for( unsigned int i = 0; i < src_items; i++ ){
+						struct partindex_doc_t d;
+						struct part_row_t row;
+						struct part_t* p = nullptr;
+						if( !part_index.doc( i, &d ) ){
+							p = d.cache->read( d.idx );
+						}
+						if( nullptr != p ){
+							set_part_row( &row, d.cache, d.idx, p );
+						}
+						else {
+							/* Keep rows lined up with document ids */
+							row.cache = nullptr;
+							row.idx = (unsigned int)-1;
+							row.q = 0;
+							row.status = pstat_unknown;
+							row.disp = &part_status_disp[pstat_unknown];
+						}
+						rows.push_back( row );
+					}
 				}
-				tmp = cache->read(i);
-				/* Copy part to temporary storage */
-				part = copy_part_t( tmp );
-#endif
-				part = cache->read(i);
-				/* Part number */
-				ImGui::TableSetColumnIndex(0);
-				snprintf(part_mpn_label, 64, "%s", part->mpn);
-				ImGui::Selectable(part_mpn_label, &item_sel[i], ImGuiSelectableFlags_SpanAllColumns);
-
-				/* Manufacturer */
-				ImGui::TableSetColumnIndex(1);
-				ImGui::Text("%s", part->mfg );
-
-				/* Quantity */
-				ImGui::TableSetColumnIndex(2);
-				unsigned int total = 0;
-				for( unsigned int i = 0; i < part->inv_len; i++ ){
-					total += part->inv[i].q;	
+				else {
+					for( unsigned int i = 0; i < src_items; i++ ){
+						/* Entries are empty until the first refresh is applied */
+						struct part_t* p = cache->read(i);
+						if( nullptr != p ){
+							struct part_row_t row;
+							set_part_row( &row, cache, i, p );
+							rows.push_back( row );
+						}
+					}
 				}
-				ImGui::Text("%d", total );
-
-				/* Type */
-				ImGui::TableSetColumnIndex(3);
-				ImGui::Text("%s", part->type);
+				rows_cache = src;
+				rows_gen = src_gen;
+				rows_items = src_items;
+				rows_changed = true;
+			}
 
-				/* Status */
-				ImGui::TableSetColumnIndex(4);
-				switch ( part->status ) {
-					case pstat_prod:
-						ImGui::Text("Production");
-						break;
-					case pstat_low_stock:
-						ImGui::TextColored(ImVec4(1.0f, 0.8117647f, 0.0f, 1.0f),"Low Stock");
-						break;
-					case pstat_unavailable:
-						ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f),"Unavailable");
-						break;
-					case pstat_nrnd:
-						ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f),"Not Recommended for New Designs");
-						break;
-					case pstat_lasttimebuy:
-						ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f),"Last Time Buy");
-						break;
-					case pstat_obsolete:
-						ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f),"Obsolete");
-						break;
-					case pstat_unknown:
-					default:
-						/* FALLTHRU */
-						ImGui::TextColored(ImVec4(1.0f, 0.8117647f, 0.0f, 1.0f),"Unknown");
-						break;
+			/* Sort display order when criteria or rows change */
+			auto cmp = []( unsigned int a, unsigned int b, int column ){
+				return cmp_part_row( &rows[a], &rows[b], column );
+			};
+			ImGuiTableSortSpecs* sort_specs = ImGui::TableGetSortSpecs();
+			if( rows_changed || ( nullptr != sort_specs && sort_specs->SpecsDirty ) ){
+				tablesort_perm( &order, rows.size(), sort_specs, cmp );
+				if( nullptr != sort_specs ){
+					sort_specs->SpecsDirty = false;
 				}
+				rank.resize( order.size() );
+				for( unsigned int i = 0; i < order.size(); i++ ){
+					rank[order[i]] = i;
+				}
+				rows_changed = true;
+			}
 
-
-				if( item_sel[i] ){
-					/* Open popup for part info */
-					ImGui::OpenPopup("PartInfo");
-					y_log_message(Y_LOG_LEVEL_DEBUG, "%s was selected", part->mpn);
-					if( nullptr != selected_item ){
-						free_part_t( selected_item );
-						selected_item = nullptr;
+			/* Matches of the filter in sorted order. Only the matches are
+			 * ordered, by their position in the full sort */
+			const std::vector<unsigned int>* disp = &order;
+			if( filtering ){
+				if( rows_changed || shown_filter != filter || shown_param != param ){
+					if( text_filtering ){
+						const std::vector<unsigned int>* hits = part_index.query( filter );
+						shown.assign( hits->begin(), hits->end() );
+					}
+					if( param_filtering ){
+						const std::vector<unsigned int>* hits = part_param.query( param, nullptr );
+						if( text_filtering ){
+							/* Both are in ascending order */
+							std::vector<unsigned int> both;
+							std::set_intersection( shown.begin(), shown.end(), hits->begin(), hits->end(), std::back_inserter( both ) );
+							shown.swap( both );
+						}
+						else {
+							shown.assign( hits->begin(), hits->end() );
+						}
 					}
-					selected_item = copy_part_t(part);
-					gselected_part = selected_item;
+					std::sort( shown.begin(), shown.end(), []( unsigned int a, unsigned int b ){
+						return rank[a] < rank[b];
+					});
+					shown_filter = filter;
+					shown_param = param;
 				}
+				disp = &shown;
+			}
 
-//				if( nullptr != part ){
-//					free_part_t( part );
-//					part = nullptr;
-//				}
+			struct part_t* part = nullptr;
 
+			/* Only rows in view are drawn */
+			ImGuiListClipper clipper;
+			clipper.Begin( (int)disp->size() );
+			while( clipper.Step() ){
+				for( int r = clipper.DisplayStart; r < clipper.DisplayEnd; r++ ){
+					const struct part_row_t* row = &rows[(*disp)[r]];
+					ImGui::PushID( (int)row->idx );
+					ImGui::TableNextRow();
+
+					/* Part number */
+					ImGui::TableSetColumnIndex(0);
+					bool clicked = ImGui::Selectable( row->mpn.c_str(), sel_cache == row->cache && sel_idx == row->idx, ImGuiSelectableFlags_SpanAllColumns );
+
+					/* Manufacturer */
+					ImGui::TableSetColumnIndex(1);
+					ImGui::TextUnformatted( row->mfg.c_str() );
+
+					/* Quantity */
+					ImGui::TableSetColumnIndex(2);
+					ImGui::TextUnformatted( row->q_str.c_str() );
+
+					/* Type */
+					ImGui::TableSetColumnIndex(3);
+					ImGui::TextUnformatted( row->type.c_str() );
+
+					/* Status */
+					ImGui::TableSetColumnIndex(4);
+					if( row->disp->colored ){
+						ImGui::PushStyleColor( ImGuiCol_Text, row->disp->col );
+						ImGui::TextUnformatted( row->disp->label );
+						ImGui::PopStyleColor();
+					}
+					else {
+						ImGui::TextUnformatted( row->disp->label );
+					}
+					ImGui::PopID();
+
+					/* Part may have been replaced since rows were built */
+					part = ( clicked && nullptr != row->cache ) ? row->cache->read( row->idx ) : nullptr;
+					if( nullptr != part ){
+						sel_cache = row->cache;
+						sel_idx = row->idx;
+						/* Open popup for part info */
+						ImGui::OpenPopup("PartInfo");
+						y_log_message(Y_LOG_LEVEL_DEBUG, "%s was selected", part->mpn);
+						/* Hold the shared handle; stays valid through
+						 * refreshes until the popup is closed */
+						if( nullptr != selected_item ){
+							free_part_t( selected_item );
+						}
+						selected_item = ref_part_t( part );
+						if( nullptr != gselected_part ){
+							free_part_t( gselected_part );
+						}
+						gselected_part = ref_part_t( part );
+					}
+				}
+			}
+			/* Popup window for Part info; keep stock of its row current */
+			if( partinfo_window( info, &selected_item ) && nullptr != selected_item ){
+				/* Part to edit holds the new stock too */
+				if( nullptr != gselected_part ){
+					free_part_t( gselected_part );
+				}
+				gselected_part = ref_part_t( selected_item );
+				for( auto& row : rows ){
+					if( row.cache == sel_cache && row.idx == sel_idx ){
+						set_part_row( &row, row.cache, row.idx, selected_item );
+						break;
+					}
+				}
+			}
+			if( nullptr != selected_item && !ImGui::IsPopupOpen( "PartInfo" ) ){
+				free_part_t( selected_item );
+				selected_item = nullptr;
 			}
-			/* Popup window for Part info */
-			partinfo_window( info, selected_item );
 		}
 		else{
 			y_log_message(Y_LOG_LEVEL_ERROR, "Issue getting selected item for part type info tab");
@@ -1504,21 +1967,41 @@ static void part_info_tab( struct dbinfo_t** info, class Partcache* cache ){
 
 }
 
+/* Plot stock level over time; only as many points as the plot is wide are
+ * drawn, picked from the part of the history in view */
+static void plot_stock_history( const char* id, const char* label, struct stockhist_series_t* s ){
+	if( ImPlot::BeginPlot( id, ImVec2(-1, 200), ImPlotFlags_NoMouseText ) ){
+		ImPlot::SetupAxes( "Date", "Stock", ImPlotAxisFlags_None, ImPlotAxisFlags_AutoFit );
+		ImPlot::SetupAxisScale( ImAxis_X1, ImPlotScale_Time );
+		ImPlot::SetupAxisLimits( ImAxis_X1, s->t.front(), s->t.back(), ImPlotCond_Once );
+
+		ImPlotRect limits = ImPlot::GetPlotLimits();
+		unsigned int width = (unsigned int)ImPlot::GetPlotSize().x;
+		unsigned int n = stockhist_view( s, limits.X.Min, limits.X.Max, width );
+		ImPlot::PlotLine( label, s->view_t.data(), s->view_q.data(), (int)n );
+		ImPlot::EndPlot();
+	}
+}
+
 static void part_analytic_tab( class Partcache* cache ){
 
 	static std::string last_type = "";
+	static class Stockhist hist;
 
 	/* Check if cache is valid */
 	if( nullptr != cache ){
-		/* Check if already retrieved data from this project */
+		/* Check if already retrieved data from this part type */
 		if( last_type != cache->type ){
-			/* Grab new data */
+			/* Grab new data; read on the task pool */
+			if( DB_STAT_CONNECTED == db_stat ){
+				hist.load( cache );
+			}
 
-			/* Save last ipn */
+			/* Save last type */
 			last_type = cache->type;
 		}
 
-		/* Show information about project with selections for versions etc */
+		/* Show information about part type */
 		ImGui::Text("Part Analytics Tab");
 		ImGui::Separator();
 		
@@ -1526,6 +2009,46 @@ static void part_analytic_tab( class Partcache* cache ){
 		ImGui::Text("Number of unique parts: %d", cache->items());
 
 		ImGui::Spacing();
+
+		/* Stock history of type and selected part */
+		ImGui::Text("Stock History");
+		ImGui::SameLine();
+		if( ImGui::Button("Reload") && DB_STAT_CONNECTED == db_stat && !hist.is_loading() ){
+			hist.load( cache );
+		}
+		ImGui::Separator();
+
+		struct part_t* sel = cache->get_selected();
+		hist.set_part( sel );
+
+		struct stockhist_series_t* type_series = hist.get_type_series();
+		struct stockhist_series_t* part_series = hist.get_part_series();
+		if( hist.is_loading() ){
+			ImGui::TextDisabled("Loading stock history...");
+		}
+		else if( !hist.is_loaded() || hist.get_type() != cache->type ){
+			ImGui::Text("Stock history could not be read");
+		}
+		else if( nullptr == type_series ){
+			ImGui::Text("No stock changes recorded for %s", cache->type.c_str());
+		}
+		else {
+			ImGui::Text("%u recorded stock changes", hist.size());
+
+			/* Limits are set once per plot, so give each type and part its
+			 * own id */
+			ImGui::PushID( cache->type.c_str() );
+			plot_stock_history( "##stock_type", cache->type.c_str(), type_series );
+			if( nullptr != part_series ){
+				ImGui::PushID( (int)sel->ipn );
+				plot_stock_history( "##stock_part", ( nullptr != sel->mpn ) ? sel->mpn : "Part", part_series );
+				ImGui::PopID();
+			}
+			else if( nullptr != sel ){
+				ImGui::Text("No stock changes recorded for selected part");
+			}
+			ImGui::PopID();
+		}
 	}
 	else {
 		ImGui::Text("Part Type cache is invalid");
@@ -1535,14 +2058,17 @@ static void part_analytic_tab( class Partcache* cache ){
 
 static void part_data_window( struct dbinfo_t** info,  std::vector< Partcache*>* cache, int index ){
 	static part_t* p = nullptr;
-	static class Partcache* selected = (*cache)[index];
+	static class Partcache* selected = nullptr;
 	/* Show BOM/Information View */
 	ImGuiTabBarFlags tabbar_flags = ImGuiTabBarFlags_None;
 
-	/* Update index */
-	if( index > 0 || index <= (*cache).size() ){
+	/* Update index; caches past the end may have been deleted */
+	if( index >= 0 && (unsigned int)index < (*cache).size() ){
 		selected = (*cache)[index];	
 	}
+	else {
+		selected = nullptr;
+	}
 
 	if( ImGui::BeginTabBar("Part Info", tabbar_flags ) ){
 		if( ImGui::BeginTabItem("Analytics") ){
@@ -1550,7 +2076,7 @@ static void part_data_window( struct dbinfo_t** info,  std::vector< Partcache*>*
 			ImGui::EndTabItem();
 		}
 		if( ImGui::BeginTabItem("Info") ){
-			part_info_tab( info, selected );
+			part_info_tab( info, selected, cache );
 			ImGui::EndTabItem();
 		}
 		
@@ -1623,7 +2149,10 @@ static show_inventory_view( class InvCache* cache, static ImGuiTableFlags table_
 static void show_root_window( struct dbinfo_t** info, class Prjcache* prj_cache, std::vector< Partcache*>* part_cache ){
 
 	/* Create menu items */
-	show_menu_bar( prj_cache, part_cache );
+	{
+		PROF_SCOPE( prof_menu );
+		show_menu_bar( prj_cache, part_cache );
+	}
 	
 	/* Put the different items into columns*/
 	static ImGuiTableFlags table_flags = ImGuiTableFlags_SizingStretchProp | \
@@ -1634,15 +2163,19 @@ static void show_root_window( struct dbinfo_t** info, class Prjcache* prj_cache,
 										 ImGuiTableFlags_ContextMenuInBody;
 	switch( current_view ){
 
-		case part_view:
+		case part_view: {
+			PROF_SCOPE( prof_parts );
 			show_part_view( info, part_cache, table_flags );
 			break;
+		}
 		case inventory_view:
 			break;
 		case project_view:
-		default:
+		default: {
+			PROF_SCOPE( prof_projects );
 			show_project_view( &db_stat, info, show_all_projects, prj_cache, table_flags );
 			break;
+		}
 	}
 
 
@@ -1653,6 +2186,10 @@ static void show_root_window( struct dbinfo_t** info, class Prjcache* prj_cache,
 			break;
 		case DB_STAT_CONNECTED:
 			ImGui::Text("Database Connected");
+			if( cache_changes.backlog() > 0 ){
+				ImGui::SameLine();
+				ImGui::Text("(updating, %u changes pending)", cache_changes.backlog());
+			}
 			break;
 		default:
 			ImGui::Text("Unknown Database Error");
@@ -1,8 +1,67 @@
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
 #include <part_funct.h>
 
+/* SI prefixes accepted in front of a unit; micro in ASCII and both unicode
+ * forms */
+static const struct {
+	const char* sym;
+	double scale;
+} si_prefix[] = {
+	{ "p", 1e-12 },
+	{ "n", 1e-9 },
+	{ "u", 1e-6 },
+	{ "\xC2\xB5", 1e-6 },
+	{ "\xCE\xBC", 1e-6 },
+	{ "m", 1e-3 },
+	{ "k", 1e3 },
+	{ "K", 1e3 },
+	{ "M", 1e6 },
+	{ "G", 1e9 },
+	{ "T", 1e12 },
+};
+
+/* Units that can follow a prefix, and the name they are stored under */
+static const struct {
+	const char* sym;
+	const char* base;
+} si_unit[] = {
+	{ "F", "F" },
+	{ "V", "V" },
+	{ "A", "A" },
+	{ "W", "W" },
+	{ "\xCE\xA9", "\xCE\xA9" },
+	{ "\xE2\x84\xA6", "\xCE\xA9" },
+	{ "Ohm", "\xCE\xA9" },
+	{ "Ohms", "\xCE\xA9" },
+	{ "R", "\xCE\xA9" },
+	{ "Hz", "Hz" },
+	{ "H", "H" },
+	{ "s", "s" },
+	{ "m", "m" },
+	{ "g", "g" },
+	{ "Wh", "Wh" },
+	{ "Ah", "Ah" },
+	{ "VA", "VA" },
+	{ "%", "%" },
+	{ "\xC2\xB0" "C", "\xC2\xB0" "C" },
+};
+
+/* Stored name of unit; NULL if not known */
+static const char* si_find_unit( const char* s, int ignore_case ){
+	for( unsigned int i = 0; i < sizeof( si_unit ) / sizeof( si_unit[0] ); i++ ){
+		if( ignore_case ? !strcasecmp( s, si_unit[i].sym ) : !strcmp( s, si_unit[i].sym ) ){
+			return si_unit[i].base;
+		}
+	}
+	return NULL;
+}
+
 /* Determine total inventory amount for part */
 unsigned int get_part_total_inventory( struct part_t * p ){
-	unsigned int ntotal = 0;	
+	unsigned int ntotal = 0;
 
 	/* Check if part is valid */
 	if( NULL == p ){
@@ -17,185 +76,234 @@ unsigned int get_part_total_inventory( struct part_t * p ){
 	return ntotal;
 }
 
-/* Determine optimal order amount for cost reduction. Pass the amount to check
- * against (q) */
-unsigned int get_optimal_part_amount( struct part_t * p, unsigned int q ){
-	double price_tmp_exact = 0.0;
-	double price_tmp_break = 0.0;
+/* Sort price breaks by quantity */
+static int cmp_price_break( const void* a, const void* b ){
+	const struct part_price_break_t* ba = (const struct part_price_break_t*)a;
+	const struct part_price_break_t* bb = (const struct part_price_break_t*)b;
+	return (ba->quantity > bb->quantity) - (ba->quantity < bb->quantity);
+}
+
+/* Compile price breaks of part into cost curve. Cached in the part, and
+ * recompiled when the part revision or price array changes */
+struct part_price_curve_t* get_part_price_curve( struct part_t * p ){
+	struct part_price_curve_t* c = NULL;
 
 	/* Check if part is valid */
 	if( NULL == p ){
 		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
-		return 0;
+		return NULL;
 	}
 
-	/* Check if number passed is equal to zero; can't do anything there */
-	if( 0 == q ){
-		y_log_message( Y_LOG_LEVEL_WARNING, "Quantity given for checking optimal price was 0 for part: %s", p->mpn );
-		return 0;
+	/* Already compiled */
+	if( NULL != p->curve && p->curve->rev == p->rev && p->curve->src == p->price ){
+		return p->curve;
 	}
 
-	/* Check if price information exists for this part */
-	if( !p->price_len ){
-		y_log_message( Y_LOG_LEVEL_WARNING, "Did not find any price information for part: %s", p->mpn );
-		return 0;
+	c = calloc( 1, sizeof( struct part_price_curve_t ) );
+	if( NULL == c ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; could not allocate memory for price curve", __func__ );
+		return NULL;
 	}
+	c->rev = p->rev;
+	c->src = p->price;
+	c->len = p->price_len;
 
-	/* Check if first price break is higher than passed amount */
-	if( q <= p->price[0].quantity ){
-		return q;
+	if( 0 == c->len || NULL == p->price ){
+		/* Only warn once per compile, not on every lookup */
+		y_log_message( Y_LOG_LEVEL_WARNING, "Did not find any price information for part: %s", p->mpn );
+		c->len = 0;
 	}
+	else {
+		c->brk = calloc( c->len, sizeof( struct part_price_break_t ) );
+		if( NULL == c->brk ){
+			y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; could not allocate memory for price breaks", __func__ );
+			free( c );
+			return NULL;
+		}
+		for( unsigned int i = 0; i < c->len; i++ ){
+			c->brk[i].quantity = ( p->price[i].quantity > 0 ) ? (unsigned int)p->price[i].quantity : 0;
+			c->brk[i].price = p->price[i].price;
+		}
+		qsort( c->brk, c->len, sizeof( struct part_price_break_t ), cmp_price_break );
 
-	/* Check if last price break is lower than passed amount */
-	if( q >= p->price[ p->price_len - 1 ].quantity ){
-		return q;
+		/* Cheapest order at or above each break, so buying up to any larger
+		 * break is a single lookup */
+		for( unsigned int i = c->len; i-- > 0; ){
+			c->brk[i].best_q = c->brk[i].quantity;
+			c->brk[i].best_cost = c->brk[i].price * (double)c->brk[i].quantity;
+			if( i + 1 < c->len && c->brk[i + 1].best_cost < c->brk[i].best_cost ){
+				c->brk[i].best_q = c->brk[i + 1].best_q;
+				c->brk[i].best_cost = c->brk[i + 1].best_cost;
+			}
+		}
 	}
 
-	/* Loop through the price breaks; skip first, as it was checked */
-	for( unsigned int i = 1; i < p->price_len; i++ ){
-		/* Price break is exactly the same as the quantity, just return that */
-		if( q == p->price[i].quantity ){
-			return q;
-		} 
-		/* Check if price break is higher than quantity, use that number to
-		 * determine if cost is higher or lower than previous price break */
-		else if( q < p->price[i].quantity ){
-			/* Calculate cost */
-			price_tmp_exact = p->price[i-1].price * q;
-			price_tmp_break = p->price[i].price * p->price[i].quantity;
+	/* Replace stale curve */
+	if( NULL != p->curve ){
+		free( p->curve->brk );
+		free( p->curve );
+	}
+	p->curve = c;
+	return c;
+}
 
-			y_log_message(Y_LOG_LEVEL_DEBUG, "Exact price: %lf | Price Break: %lf", price_tmp_exact, price_tmp_break);
-			/* Check if exact amount or price break is cheaper */
-			if( price_tmp_exact > price_tmp_break ){
-				return p->price[i].quantity;
-			}
-			else{
-				/* Price is the same, or more expensive */
-				return q;
-			}
+/* Number of breaks with quantity at or below q, searching from lo */
+static unsigned int price_break_upper( const struct part_price_curve_t* c, unsigned int lo, unsigned int q ){
+	unsigned int hi = c->len;
+	while( lo < hi ){
+		unsigned int mid = lo + (hi - lo) / 2;
+		if( c->brk[mid].quantity <= q ){
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
 		}
 	}
-
-	y_log_message( Y_LOG_LEVEL_ERROR, "End of %s should not have been able to be reached!!", __func__ );
-	return 0;
+	return lo;
 }
 
-/* Determine optimal order cost for cost reduction. Pass the amount to check
- * against (q) */
-double get_optimal_part_cost( struct part_t * p, unsigned int q ){
-	double retval = 0.0;
-	double price_tmp_exact = 0.0;
-	double price_tmp_break = 0.0;
+/* Evaluate cost curve for n quantities. Any of amount, optimal or exact may be
+ * NULL. Ascending quantities reuse the previous search position */
+void eval_part_price_curve( const struct part_price_curve_t* c, const unsigned int* q, unsigned int n, unsigned int* amount, double* optimal, double* exact ){
+	unsigned int idx = 0;
+	unsigned int last_q = 0;
 
-	/* Check if part is valid */
-	if( NULL == p ){
+	if( NULL == q ){
 		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
-		return 0;
+		return;
 	}
 
-	/* Check if number passed is equal to zero; can't do anything there */
-	if( 0 == q ){
-		y_log_message( Y_LOG_LEVEL_WARNING, "Quantity given for checking optimal price was 0 for part: %s", p->mpn );
-		return 0;
-	}
+	for( unsigned int i = 0; i < n; i++ ){
+		unsigned int amt = 0;
+		double opt = 0.0;
+		double ex = 0.0;
 
-	/* Check if price information exists for this part */
-	if( !p->price_len ){
-		y_log_message( Y_LOG_LEVEL_WARNING, "Did not find any price information for part: %s", p->mpn );
-		return 0.0;
-	}
-
-	/* Check if first price break is higher than passed amount */
-	if( q <= p->price[0].quantity ){
-		y_log_message( Y_LOG_LEVEL_DEBUG, "Couldn't get better price for part %s, than lowest break", p->mpn );
-		return (p->price[0].price * q);
-	}
-
-	/* Check if last price break is lower than passed amount */
-	if( q >= p->price[ p->price_len - 1 ].quantity ){
-		y_log_message( Y_LOG_LEVEL_DEBUG, "Couldn't get better price for part %s, than highest break", p->mpn );
-		return (p->price[ p->price_len - 1 ].price * q);
-	}
-
-	/* Loop through the price breaks; skip first, as it was checked */
-	for( unsigned int i = 1; i < p->price_len; i++ ){
-		/* Price break is exactly the same as the quantity, just return that */
-		if( q == p->price[i].quantity ){
-			y_log_message( Y_LOG_LEVEL_DEBUG, "Price break is same as quantity");
-			return (p->price[i].price * (double)q);
-		} 
-		/* Check if price break is higher than quantity, use that number to
-		 * determine if cost is higher or lower than previous price break */
-		else if( q < p->price[i].quantity ){
-			/* Calculate cost */
-			price_tmp_exact = p->price[i-1].price * (double)q;
-			price_tmp_break = p->price[i].price * (double)p->price[i].quantity;
-
-			/* Check if exact amount or price break is cheaper */
-			if( price_tmp_exact > price_tmp_break ){
-				y_log_message( Y_LOG_LEVEL_DEBUG, "Price break optimization was used" );
-				retval = price_tmp_break;
-			}
-			else{
-				/* Price is the same, or more expensive */
-				y_log_message( Y_LOG_LEVEL_DEBUG, "Exact price was used" );
-				retval = price_tmp_exact;
+		if( NULL != c && c->len > 0 && q[i] > 0 ){
+			/* Segment q falls in; below the first break still uses its price */
+			idx = price_break_upper( c, ( q[i] >= last_q ) ? idx : 0, q[i] );
+			last_q = q[i];
+			ex = c->brk[ idx ? idx - 1 : 0 ].price * (double)q[i];
+			amt = q[i];
+			opt = ex;
+
+			/* Buy up to a larger break if that is cheaper in total */
+			if( idx < c->len && c->brk[idx].best_cost < ex ){
+				amt = c->brk[idx].best_q;
+				opt = c->brk[idx].best_cost;
 			}
 		}
+
+		if( NULL != amount ){
+			amount[i] = amt;
+		}
+		if( NULL != optimal ){
+			optimal[i] = opt;
+		}
+		if( NULL != exact ){
+			exact[i] = ex;
+		}
 	}
+}
+
+/* Determine optimal order amount for cost reduction. Pass the amount to check
+ * against (q) */
+unsigned int get_optimal_part_amount( struct part_t * p, unsigned int q ){
+	unsigned int amount = 0;
+	eval_part_price_curve( get_part_price_curve( p ), &q, 1, &amount, NULL, NULL );
+	return amount;
+}
 
-//	y_log_message( Y_LOG_LEVEL_DEBUG, "Optimal part cost: %lf", retval );
-	return retval;
+/* Determine optimal order cost for cost reduction. Pass the amount to check
+ * against (q) */
+double get_optimal_part_cost( struct part_t * p, unsigned int q ){
+	double cost = 0.0;
+	eval_part_price_curve( get_part_price_curve( p ), &q, 1, NULL, &cost, NULL );
+	return cost;
 }
 
 /* Determine exact order cost for comparing cost reduction. Pass the amount to check
  * against (q) */
 double get_exact_part_cost( struct part_t * p, unsigned int q ){
-	double retval = 0.0;
-	double price_tmp_exact = 0.0;
-	double price_tmp_break = 0.0;
+	double cost = 0.0;
+	eval_part_price_curve( get_part_price_curve( p ), &q, 1, NULL, NULL, &cost );
+	return cost;
+}
 
-	/* Check if part is valid */
-	if( NULL == p ){
+/* Parse engineering value into base units. Whole unit names are matched
+ * first so "m" stays metres, then prefixed units, then units in any case */
+int parse_si_value( const char* s, double* value, char* unit, size_t unit_len ){
+	const char* base = NULL;
+	double scale = 1.0;
+	char* end = NULL;
+	char suffix[32];
+	size_t len = 0;
+
+	if( NULL == s || NULL == value || NULL == unit || 0 == unit_len ){
 		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
-		return 0;
+		return -1;
 	}
+	unit[0] = '\0';
 
-	/* Check if number passed is equal to zero; can't do anything there */
-	if( 0 == q ){
-		y_log_message( Y_LOG_LEVEL_WARNING, "Quantity given for checking optimal price was 0 for part: %s", p->mpn );
-		return 0;
+	while( isspace( (unsigned char)*s ) ){
+		s++;
 	}
-
-	/* Check if price information exists for this part */
-	if( !p->price_len ){
-		y_log_message( Y_LOG_LEVEL_WARNING, "Did not find any price information for part: %s", p->mpn );
-		return 0.0;
+	if( !isdigit( (unsigned char)*s ) && '.' != *s && '-' != *s && '+' != *s ){
+		return -1;
+	}
+	*value = strtod( s, &end );
+	if( end == s ){
+		return -1;
 	}
 
-	/* Check if first price break is higher than passed amount */
-	if( q <= p->price[0].quantity ){
-		return (p->price[0].price * q);
+	/* Unit, without surrounding space */
+	while( isspace( (unsigned char)*end ) ){
+		end++;
 	}
+	len = strlen( end );
+	while( len > 0 && isspace( (unsigned char)end[len - 1] ) ){
+		len--;
+	}
+	if( 0 == len ){
+		return 0;
+	}
+	if( len >= sizeof( suffix ) ){
+		return -1;
+	}
+	memcpy( suffix, end, len );
+	suffix[len] = '\0';
 
-	/* Check if last price break is lower than passed amount */
-	if( q >= p->price[ p->price_len - 1 ].quantity ){
-		return (p->price[ p->price_len - 1 ].price * q);
+	base = si_find_unit( suffix, 0 );
+	for( unsigned int i = 0; NULL == base && i < sizeof( si_prefix ) / sizeof( si_prefix[0] ); i++ ){
+		size_t plen = strlen( si_prefix[i].sym );
+		if( strncmp( suffix, si_prefix[i].sym, plen ) ){
+			continue;
+		}
+		/* Prefix alone, as in "4.7k" */
+		if( '\0' == suffix[plen] ){
+			*value *= si_prefix[i].scale;
+			return 0;
+		}
+		base = si_find_unit( &suffix[plen], 1 );
+		if( NULL != base ){
+			scale = si_prefix[i].scale;
+		}
+	}
+	if( NULL == base ){
+		base = si_find_unit( suffix, 1 );
 	}
 
-	/* Loop through the price breaks; skip first, as it was checked */
-	for( unsigned int i = 1; i < p->price_len; i++ ){
-		/* Price break is exactly the same as the quantity, just return that */
-		if( q == p->price[i].quantity ){
-			return (p->price[i].price * (double)q);
-		} 
-		/* Check if price break is higher than quantity, use that number to
-		 * determine if cost is higher or lower than previous price break */
-		else if( q < p->price[i].quantity ){
-			/* Calculate cost */
-			retval = price_tmp_exact = p->price[i-1].price * (double)q;
+	/* Anything else is kept as written, as long as it looks like a unit */
+	if( NULL == base ){
+		for( size_t i = 0; i < len; i++ ){
+			if( isspace( (unsigned char)suffix[i] ) || isdigit( (unsigned char)suffix[i] ) ){
+				return -1;
+			}
 		}
+		base = suffix;
 	}
 
-	return retval;
+	*value *= scale;
+	strncpy( unit, base, unit_len - 1 );
+	unit[unit_len - 1] = '\0';
+	return 0;
 }
@@ -39,9 +39,9 @@ struct part_t* Partcache::_read( unsigned int index ){
 
 int Partcache::_clean( void ){
 	const std::lock_guard<std::mutex> lock(clean_mtx);
-	/* Clear out selected poitner */
+	/* Selection holds its own reference */
 	if( nullptr != selected ){
-		/* Will be freed soon, just need to make sure the pointer goes nowhere */
+		free_part_t( selected );
 		selected = nullptr;
 	}
 	for( unsigned int i = 0; i < cache.size(); i++ ){
@@ -74,7 +74,7 @@ int Partcache::_insert_ipn( unsigned int ipn, unsigned int index ){
 		return -1;
 	}
 	else {
-		return _insert(p, index);
+		return _insert(share_part_t(p), index);
 	}
 }
 
@@ -92,10 +92,57 @@ int Partcache::_append_ipn( unsigned int ipn ){
 		return -1;
 	}
 	else {
-		return _append(p);
+		return _append(share_part_t(p));
+	}
+}
+
+/* Replace cache entries from start with parts loaded by a refresh. The
+ * selected part is remembered by ipn while its entry is replaced */
+void Partcache::_apply( unsigned int start, std::vector<struct part_t*>* batch ){
+	for( unsigned int i = 0; i < batch->size(); i++ ){
+		unsigned int index = start + i;
+		struct part_t* p = (*batch)[i];
+		if( index < cache.size() ){
+			if( nullptr != selected && cache[index] == selected ){
+				pending_sel_ipn = selected->ipn;
+				free_part_t( selected );
+				selected = nullptr;
+			}
+			if( nullptr != cache[index] ){
+				free_part_t( cache[index] );
+			}
+			cache[index] = p;
+		}
+		else {
+			cache.push_back( p );
+		}
+
+		/* Restore selection as soon as its replacement is in the cache */
+		if( (unsigned int)-1 != pending_sel_ipn && p->ipn == pending_sel_ipn ){
+			selected = ref_part_t( p );
+			pending_sel_ipn = (unsigned int)-1;
+		}
 	}
 }
 
+/* Finish a refresh; drop entries past the new size */
+void Partcache::_commit( unsigned int size ){
+	while( cache.size() > size ){
+		if( cache.back() == selected ){
+			free_part_t( selected );
+			selected = nullptr;
+		}
+		_remove( cache.size() - 1 );
+	}
+	if( (unsigned int)-1 != pending_sel_ipn ){
+		y_log_message( Y_LOG_LEVEL_WARNING, "Selected part %s:%u no longer exists after refresh", type.c_str(), pending_sel_ipn );
+		pending_sel_ipn = (unsigned int)-1;
+	}
+
+	gen++;
+	y_log_message( Y_LOG_LEVEL_DEBUG, "Part cache %s refresh applied; generation %u", type.c_str(), gen );
+}
+
 int Partcache::_remove( unsigned int index ){
 	if( nullptr != cache[index] ){
 		free_part_t( cache[index] );
@@ -115,12 +162,16 @@ Partcache::Partcache( unsigned int size, std::string init_type ){
 
 	cache.assign(size, nullptr);
 	selected = nullptr;
+	pending_sel_ipn = (unsigned int)-1;
+	gen = 0;
 	cmtx.unlock();
 	y_log_message(Y_LOG_LEVEL_DEBUG, "Created part cache");
 }
 
 /* Destructor; check for non null pointers, and clear them out */
 Partcache::~Partcache(){
+	/* Refresh data that was never applied */
+	cache_changes.purge( this );
 	while( !cmtx.try_lock() );
 	_clean();
 	cmtx.unlock();
@@ -136,66 +187,102 @@ unsigned int Partcache::items(void){
 	return len;
 }
 
-/* Update part cache from database */
-int Partcache::update( struct dbinfo_t** info ){
-	if( cmtx.try_lock() ){
-		/* Save current selected part index to use later */
-		unsigned int selected_idx = (unsigned int)-1;
-		/* Look through cache to find where pointer matches in vector */
-		if( nullptr != selected ){
-			for( unsigned int i = 0; i < cache.size(); i++ ){
-				if( selected == cache[i] ){
-					y_log_message( Y_LOG_LEVEL_DEBUG, "Found selected part index in cache at %d", i );
-					selected_idx = i;
-					break;
-				}
-			}
-			if( selected_idx == (unsigned int)-1){
-				y_log_message( Y_LOG_LEVEL_WARNING, "Could not find selected index from part pointer during update. Could mean that selected part is a subpart." );
-				cmtx.unlock();
-				return -1;
-			}
-		}
-		/* At this point, the selected part can be updated to be the correct one
-		 * based off of what was previously selected before */
-
-		unsigned int npart = 0;
-
-		if( nullptr != (*info) ){
-			for( unsigned int i = 0; i < (*info)->nptype; i++){
-				if( !strncmp( type.c_str(), (*info)->ptypes[i].name, type.size() ) ){
-					npart = (*info)->ptypes[i].npart;
-					y_log_message(Y_LOG_LEVEL_DEBUG, "Number of parts for type %s:%u", type.c_str(), npart);
-					break;
-				}
-			}
-			if( npart == 0 ){
-				cmtx.unlock();
-				y_log_message(Y_LOG_LEVEL_WARNING, "No parts found for this (%s) part type", type.c_str());
-				return -1;
-			}
+/* Return refresh generation; changes whenever cache contents have changed */
+unsigned int Partcache::generation(void){
+	unsigned int g = 0;
+	while( !cmtx.try_lock() );
+	g = gen;
+	cmtx.unlock();
+	return g;
+}
 
-			/* Clear out cache since can't guarantee movement of parts, changing
-			 * ipns, which parts were removed, etc. */
-			_clean();
-			/* Insert new elements to cache; start from index of 1 */
-			for( unsigned int i = 1; i <= npart; i++ ){
-				/* Internal part numbers should be contiguous... but not sure if
-				 * there is a better way. */
-				_append_ipn( i );
+/* Queue a change batch for the UI thread; parts are owned by the batch until
+ * it is applied */
+static void push_batch( class Partcache* pc, std::function<void(unsigned int, std::vector<struct part_t*>*)> apply, unsigned int start, std::vector<struct part_t*>* batch ){
+	cache_changes.push( pc,
+		[apply, start, batch](){
+			apply( start, batch );
+			delete batch;
+		},
+		[batch](){
+			for( auto p : *batch ){
+				free_part_t( p );
 			}
+			delete batch;
+		} );
+}
 
-			/* Recreate selected part */
-			if( (unsigned int)-1 != selected_idx ){
-				selected = cache[selected_idx];
-			}
+/* Update part cache from database. Parts are loaded here without holding the
+ * cache, then handed to the UI thread in batches through cache_changes. The
+ * last batch commits the refresh */
+int Partcache::update( struct dbinfo_t** info ){
+	unsigned int npart = 0;
+
+	if( nullptr == info || nullptr == (*info) ){
+		y_log_message(Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__);
+		return -1;
+	}
+
+	for( unsigned int i = 0; i < (*info)->nptype; i++){
+		if( !strncmp( type.c_str(), (*info)->ptypes[i].name, type.size() ) ){
+			npart = (*info)->ptypes[i].npart;
+			y_log_message(Y_LOG_LEVEL_DEBUG, "Number of parts for type %s:%u", type.c_str(), npart);
+			break;
 		}
+	}
+	if( npart == 0 ){
+		y_log_message(Y_LOG_LEVEL_WARNING, "No parts found for this (%s) part type", type.c_str());
+		return -1;
+	}
 
+	/* A newer refresh replaces anything not applied yet */
+	cache_changes.purge( this );
+
+	auto apply = [this]( unsigned int start, std::vector<struct part_t*>* batch ){
+		while( !cmtx.try_lock() );
+		_apply( start, batch );
 		cmtx.unlock();
+	};
+
+	/* Load parts; start from ipn of 1 */
+	std::vector<struct part_t*>* batch = nullptr;
+	unsigned int size = 0;
+	for( unsigned int i = 1; i <= npart; i++ ){
+		/* Internal part numbers should be contiguous... but not sure if
+		 * there is a better way. */
+		struct part_t* p = get_part_from_ipn( type.c_str(), i );
+		if( nullptr == p ){
+			y_log_message( Y_LOG_LEVEL_ERROR, "Could not add part:%s:%d to cache; database error", type.c_str(), i);
+			continue;
+		}
+		/* Unchanged parts come back as the handle already in use */
+		p = share_part_t( p );
+		if( nullptr == batch ){
+			batch = new std::vector<struct part_t*>();
+			batch->reserve( PARTCACHE_BATCH_SIZE );
+		}
+		batch->push_back( p );
+		if( batch->size() >= PARTCACHE_BATCH_SIZE ){
+			/* Batch belongs to the UI thread once pushed */
+			unsigned int n = batch->size();
+			push_batch( this, apply, size, batch );
+			size += n;
+			batch = nullptr;
+		}
 	}
-	else {
-		y_log_message(Y_LOG_LEVEL_ERROR, "Could not lock mutex on update");
+	if( nullptr != batch ){
+		unsigned int n = batch->size();
+		push_batch( this, apply, size, batch );
+		size += n;
 	}
+
+	/* Commit record */
+	cache_changes.push( this, [this, size](){
+			while( !cmtx.try_lock() );
+			_commit( size );
+			cmtx.unlock();
+		}, nullptr );
+
 	return 0;
 }
 
@@ -211,8 +298,12 @@ int Partcache::write( struct part_t * p, unsigned int index ){
 /* Get pointer from cache; should be careful as this could have unintended
  * sideeffects if data is not copied. Will attempt without copying data first */
 struct part_t* Partcache::read( unsigned int index ){
+	PROF_SCOPE( prof_cache_read );
 	struct part_t * p = nullptr;
-	while( !cmtx.try_lock() );
+	{
+		PROF_SCOPE( prof_lock_wait );
+		while( !cmtx.try_lock() );
+	}
 	p = _read( index );
 	cmtx.unlock();
 	return p;
@@ -265,12 +356,13 @@ int Partcache::remove( unsigned int index ){
 int Partcache::select( unsigned int index ){
 	while( !cmtx.try_lock() );
 
-	/* Clear out selected poitner */
+	/* Selection holds its own reference */
 	if( nullptr != selected ){
 		free_part_t( selected );
+		selected = nullptr;
 	}	
 
-	if( index > cache.size() ){
+	if( index >= cache.size() || nullptr == cache[index] ){
 		y_log_message( Y_LOG_LEVEL_ERROR, "Project selection index %d is outside of bounds of cache", index );
 		selected = nullptr;
 		cmtx.unlock();
@@ -289,7 +381,7 @@ int Partcache::select( unsigned int index ){
 		memcpy( selected, cache[index], sizeof( *cache[index] ) );
 		y_log_message( Y_LOG_LEVEL_DEBUG, "Copied part data to selected part");
 #else 
-		selected = cache[index];
+		selected = ref_part_t( cache[index] );
 #endif
 		cmtx.unlock();
 		return 0;
@@ -309,8 +401,8 @@ int Partcache::select_ptr( struct part_t* p ){
 	}
 	if( selected_idx == (unsigned int)-1){
 		y_log_message( Y_LOG_LEVEL_ERROR, "Could not find selected index from part pointer" );
-		return -1;
 		cmtx.unlock();
+		return -1;
 	}
 
 #if 0
@@ -325,7 +417,10 @@ int Partcache::select_ptr( struct part_t* p ){
 	memcpy( selected, cache[selected_idx], sizeof( *cache[selected_idx] ) );
 	y_log_message( Y_LOG_LEVEL_DEBUG, "Copied part data to selected part");
 #else
-	selected = cache[selected_idx];
+	if( nullptr != selected ){
+		free_part_t( selected );
+	}
+	selected = ref_part_t( cache[selected_idx] );
 #endif
 	cmtx.unlock();
 	return 0;
@@ -0,0 +1,363 @@
+#include <partindex.h>
+#include <algorithm>
+#include <cctype>
+#include <unordered_set>
+
+/* Index behind the part filter */
+class Partindex part_index;
+
+/* Pack three characters into a trigram key */
+static inline unsigned int trigram( const char* s ){
+	return ( (unsigned int)(unsigned char)s[0] << 16 ) | ( (unsigned int)(unsigned char)s[1] << 8 ) | (unsigned int)(unsigned char)s[2];
+}
+
+/* Append field to searchable text in lower case. Fields are separated by a
+ * newline, which queries never contain, so no match spans two fields */
+static void add_field( std::string* text, const char* field ){
+	if( nullptr == field || '\0' == field[0] ){
+		return;
+	}
+	if( !text->empty() ){
+		text->push_back( '\n' );
+	}
+	for( const char* c = field; '\0' != *c; c++ ){
+		text->push_back( (char)tolower( (unsigned char)*c ) );
+	}
+}
+
+/* Add whole field to lookup terms in lower case */
+static void add_term( std::vector<struct partindex_term_t>* terms, const char* field, unsigned int doc, int which ){
+	if( nullptr == field || '\0' == field[0] ){
+		return;
+	}
+	struct partindex_term_t t;
+	for( const char* c = field; '\0' != *c; c++ ){
+		t.key.push_back( (char)tolower( (unsigned char)*c ) );
+	}
+	t.doc = doc;
+	t.field = which;
+	terms->push_back( std::move( t ) );
+}
+
+/* Private functions for operations */
+
+/* Index every part currently in the segment's cache */
+void Partindex::_build( struct partindex_seg_t* seg ){
+	seg->idx.clear();
+	seg->text.clear();
+	seg->post.clear();
+	seg->terms.clear();
+	seg->gen = seg->cache->generation();
+	seg->items = seg->cache->items();
+
+	for( unsigned int i = 0; i < seg->items; i++ ){
+		/* Entries are empty until the first refresh is applied */
+		struct part_t* p = seg->cache->read( i );
+		if( nullptr == p ){
+			continue;
+		}
+
+		std::string text;
+		add_field( &text, p->mpn );
+		add_field( &text, p->mfg );
+		for( unsigned int j = 0; j < p->dist_len && nullptr != p->dist; j++ ){
+			add_field( &text, p->dist[j].pn );
+		}
+		for( unsigned int j = 0; j < p->info_len && nullptr != p->info; j++ ){
+			add_field( &text, p->info[j].val );
+		}
+
+		unsigned int d = seg->idx.size();
+		for( size_t j = 0; j + 2 < text.size(); j++ ){
+			if( '\n' == text[j] || '\n' == text[j + 1] || '\n' == text[j + 2] ){
+				continue;
+			}
+			std::vector<unsigned int>* list = &seg->post[trigram( &text[j] )];
+			if( list->empty() || list->back() != d ){
+				list->push_back( d );
+			}
+		}
+
+		add_term( &seg->terms, p->mpn, d, pidx_mpn );
+		add_term( &seg->terms, p->mfg, d, pidx_mfg );
+		for( unsigned int j = 0; j < p->dist_len && nullptr != p->dist; j++ ){
+			add_term( &seg->terms, p->dist[j].pn, d, pidx_dist );
+		}
+		seg->idx.push_back( i );
+		seg->text.push_back( std::move( text ) );
+	}
+
+	std::sort( seg->terms.begin(), seg->terms.end(), []( const struct partindex_term_t& a, const struct partindex_term_t& b ){
+		return a.key < b.key;
+	});
+}
+
+/* Searchable text of document */
+const std::string* Partindex::_text( unsigned int id ){
+	/* Last segment starting at or before id */
+	unsigned int s = std::upper_bound( base.begin(), base.end(), id ) - base.begin() - 1;
+	return &segs[s].text[id - base[s]];
+}
+
+/* Find documents containing q, going through the trigram index when q is long
+ * enough to have trigrams */
+void Partindex::_search( const std::string& q, std::vector<unsigned int>* hits ){
+	hits->clear();
+
+	/* Too short for trigrams; check every document */
+	if( q.size() < 3 ){
+		for( unsigned int s = 0; s < segs.size(); s++ ){
+			for( unsigned int d = 0; d < segs[s].text.size(); d++ ){
+				if( std::string::npos != segs[s].text[d].find( q ) ){
+					hits->push_back( base[s] + d );
+				}
+			}
+		}
+		return;
+	}
+
+	std::vector<unsigned int> keys;
+	for( size_t j = 0; j + 2 < q.size(); j++ ){
+		keys.push_back( trigram( &q[j] ) );
+	}
+	std::sort( keys.begin(), keys.end() );
+	keys.erase( std::unique( keys.begin(), keys.end() ), keys.end() );
+
+	std::vector<const std::vector<unsigned int>*> lists;
+	std::vector<unsigned int> cand;
+	std::vector<unsigned int> tmp;
+	for( unsigned int s = 0; s < segs.size(); s++ ){
+		struct partindex_seg_t* seg = &segs[s];
+
+		/* Every trigram of the query must be in the document */
+		lists.clear();
+		for( auto k : keys ){
+			auto it = seg->post.find( k );
+			if( it == seg->post.end() ){
+				lists.clear();
+				break;
+			}
+			lists.push_back( &it->second );
+		}
+		if( lists.empty() ){
+			continue;
+		}
+
+		/* Intersect starting from the rarest trigram */
+		std::sort( lists.begin(), lists.end(), []( const std::vector<unsigned int>* a, const std::vector<unsigned int>* b ){
+			return a->size() < b->size();
+		});
+		cand = *lists[0];
+		for( unsigned int l = 1; l < lists.size() && !cand.empty(); l++ ){
+			tmp.clear();
+			std::set_intersection( cand.begin(), cand.end(), lists[l]->begin(), lists[l]->end(), std::back_inserter( tmp ) );
+			cand.swap( tmp );
+		}
+
+		/* Trigrams can be in the document without being next to each other */
+		for( auto d : cand ){
+			if( std::string::npos != seg->text[d].find( q ) ){
+				hits->push_back( base[s] + d );
+			}
+		}
+	}
+}
+
+/* Public functions */
+
+Partindex::Partindex(){
+	gen = 0;
+	last_gen = 0;
+	have_last = false;
+}
+
+Partindex::~Partindex(){
+
+}
+
+/* Bring index up to date with part type caches; only caches whose generation
+ * or size changed are indexed again. Returns number of caches indexed */
+int Partindex::update( std::vector<class Partcache*>* caches ){
+	int nbuilt = 0;
+
+	if( nullptr == caches ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return -1;
+	}
+
+	if( segs.size() > caches->size() ){
+		segs.resize( caches->size() );
+		nbuilt++;
+	}
+	for( unsigned int i = 0; i < caches->size(); i++ ){
+		class Partcache* pc = (*caches)[i];
+		if( i >= segs.size() ){
+			struct partindex_seg_t seg = {};
+			segs.push_back( std::move( seg ) );
+		}
+		struct partindex_seg_t* seg = &segs[i];
+		if( nullptr == pc ){
+			if( nullptr != seg->cache || !seg->text.empty() ){
+				*seg = {};
+				nbuilt++;
+			}
+			continue;
+		}
+		if( seg->cache == pc && seg->gen == pc->generation() && seg->items == pc->items() ){
+			continue;
+		}
+		seg->cache = pc;
+		_build( seg );
+		nbuilt++;
+	}
+
+	if( nbuilt > 0 ){
+		base.resize( segs.size() );
+		unsigned int n = 0;
+		for( unsigned int i = 0; i < segs.size(); i++ ){
+			base[i] = n;
+			n += segs[i].text.size();
+		}
+		gen++;
+		y_log_message( Y_LOG_LEVEL_DEBUG, "Part index rebuilt %d of %u part types; %u parts indexed", nbuilt, (unsigned int)segs.size(), n );
+	}
+	return nbuilt;
+}
+
+/* Changes whenever document ids may have changed */
+unsigned int Partindex::generation( void ){
+	return gen;
+}
+
+/* Number of parts indexed */
+unsigned int Partindex::docs( void ){
+	if( segs.empty() ){
+		return 0;
+	}
+	return base.back() + segs.back().text.size();
+}
+
+/* Get cache and cache index of document */
+int Partindex::doc( unsigned int id, struct partindex_doc_t* d ){
+	if( nullptr == d ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return -1;
+	}
+	if( id >= docs() ){
+		return -1;
+	}
+	unsigned int s = std::upper_bound( base.begin(), base.end(), id ) - base.begin() - 1;
+	d->cache = segs[s].cache;
+	d->idx = segs[s].idx[id - base[s]];
+	return 0;
+}
+
+/* Ids of documents containing text, ignoring case, in ascending order. Stays
+ * valid until the next query or update */
+const std::vector<unsigned int>* Partindex::query( const char* text ){
+	std::string q;
+
+	if( nullptr == text ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		last_hits.clear();
+		have_last = false;
+		return &last_hits;
+	}
+	for( const char* c = text; '\0' != *c; c++ ){
+		q.push_back( (char)tolower( (unsigned char)*c ) );
+	}
+
+	if( have_last && last_gen == gen && q == last_query ){
+		return &last_hits;
+	}
+
+	if( have_last && last_gen == gen && std::string::npos != q.find( last_query ) ){
+		/* Anything matching q also matched the last query */
+		unsigned int n = 0;
+		for( auto id : last_hits ){
+			if( std::string::npos != _text( id )->find( q ) ){
+				last_hits[n++] = id;
+			}
+		}
+		last_hits.resize( n );
+	}
+	else {
+		_search( q, &last_hits );
+	}
+
+	last_query = q;
+	last_gen = gen;
+	have_last = true;
+	return &last_hits;
+}
+
+/* Parts with a field in fields equal to key, or starting with it if prefix is
+ * set, ignoring case. Each part is given once, in key order within each part
+ * type. At most max parts are given if max is not 0. Returns number found */
+unsigned int Partindex::lookup( const char* key, int fields, bool prefix, std::vector<struct partindex_doc_t>* hits, unsigned int max ){
+	std::string k;
+	std::unordered_set<unsigned int> seen;
+
+	if( nullptr == key || nullptr == hits ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return 0;
+	}
+	hits->clear();
+	for( const char* c = key; '\0' != *c; c++ ){
+		k.push_back( (char)tolower( (unsigned char)*c ) );
+	}
+	if( k.empty() ){
+		return 0;
+	}
+
+	for( auto& seg : segs ){
+		auto it = std::lower_bound( seg.terms.begin(), seg.terms.end(), k, []( const struct partindex_term_t& t, const std::string& v ){
+			return t.key < v;
+		});
+
+		/* Terms starting with the key follow it in sorted order */
+		seen.clear();
+		for( ; it != seg.terms.end(); ++it ){
+			if( prefix ? ( 0 != it->key.compare( 0, k.size(), k ) ) : ( it->key != k ) ){
+				break;
+			}
+			if( 0 == ( it->field & fields ) ){
+				continue;
+			}
+			if( !seen.insert( it->doc ).second ){
+				continue;
+			}
+			struct partindex_doc_t d = { seg.cache, seg.idx[it->doc] };
+			hits->push_back( d );
+			if( 0 != max && hits->size() >= max ){
+				return hits->size();
+			}
+		}
+	}
+	return hits->size();
+}
+
+/* Loaded part with manufacturer or distributor part number pn. Returns a new
+ * reference, released with free_part_t, or NULL if no part is loaded with it */
+struct part_t* Partindex::find_pn( const char* pn ){
+	std::vector<struct partindex_doc_t> hits;
+
+	if( nullptr == pn ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return nullptr;
+	}
+
+	/* Manufacturer part number wins over a distributor one */
+	if( 0 == lookup( pn, pidx_mpn, false, &hits, 0 ) && 0 == lookup( pn, pidx_dist, false, &hits, 0 ) ){
+		return nullptr;
+	}
+	if( hits.size() > 1 ){
+		y_log_message( Y_LOG_LEVEL_WARNING, "%u loaded parts have part number %s; using the first", (unsigned int)hits.size(), pn );
+	}
+
+	struct part_t* p = hits[0].cache->read( hits[0].idx );
+	if( nullptr == p ){
+		return nullptr;
+	}
+	return ref_part_t( p );
+}
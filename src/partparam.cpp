@@ -0,0 +1,373 @@
+#include <partparam.h>
+#include <cmath>
+#include <cctype>
+#include <cstring>
+#include <limits>
+
+/* Parametric search behind the part filter */
+class Partparam part_param;
+
+/* Comparison operators of a query term, longest first */
+static const struct {
+	const char* sym;
+	char op;
+} param_ops[] = {
+	{ ">=", 'g' },
+	{ "\xE2\x89\xA5", 'g' },
+	{ "<=", 'l' },
+	{ "\xE2\x89\xA4", 'l' },
+	{ ">", '>' },
+	{ "<", '<' },
+	{ "=", '=' },
+};
+
+/* Lower case copy of string */
+static std::string lower( const std::string& s ){
+	std::string out( s );
+	for( auto& c : out ){
+		c = (char)tolower( (unsigned char)c );
+	}
+	return out;
+}
+
+/* String without surrounding space */
+static std::string trim( const std::string& s ){
+	size_t start = 0;
+	size_t end = s.size();
+	while( start < end && isspace( (unsigned char)s[start] ) ){
+		start++;
+	}
+	while( end > start && isspace( (unsigned char)s[end - 1] ) ){
+		end--;
+	}
+	return s.substr( start, end - start );
+}
+
+/* Unit as written after the number of a value, prefix included */
+static std::string unit_text( const std::string& s ){
+	const char* start = s.c_str();
+	char* end = nullptr;
+	strtod( start, &end );
+	return ( nullptr != end ) ? trim( std::string( end ) ) : std::string();
+}
+
+/* Range inclusive of values equal to v */
+static void eq_range( double v, double* lo, double* hi ){
+	double d = fabs( v ) * PARTPARAM_EQ_TOL;
+	*lo = v - d;
+	*hi = v + d;
+}
+
+/* Private functions for operations */
+
+/* Add info value of document to the columns of its key */
+void Partparam::_add( unsigned int doc, const std::string& key, const char* val ){
+	double v = 0.0;
+	char unit[PARTPARAM_UNIT_LEN];
+
+	/* Value as written */
+	auto s = str_by_key.find( key );
+	if( s == str_by_key.end() ){
+		struct partparam_str_t col;
+		col.key = key;
+		col.code.assign( ndocs, 0 );
+		strs.push_back( std::move( col ) );
+		s = str_by_key.emplace( key, strs.size() - 1 ).first;
+	}
+	struct partparam_str_t* str = &strs[s->second];
+	auto c = str->dict.emplace( lower( val ), str->dict.size() + 1 ).first;
+	str->code[doc] = c->second;
+
+	/* Value as a number, in a column per unit */
+	if( parse_si_value( val, &v, unit, sizeof( unit ) ) ){
+		return;
+	}
+	std::string id = key + '\n' + unit;
+	auto n = num_by_id.find( id );
+	if( n == num_by_id.end() ){
+		struct partparam_num_t col;
+		col.key = key;
+		col.unit = unit;
+		col.val.assign( ndocs, std::numeric_limits<double>::quiet_NaN() );
+		nums.push_back( std::move( col ) );
+		n = num_by_id.emplace( id, nums.size() - 1 ).first;
+	}
+	nums[n->second].val[doc] = v;
+}
+
+/* Read single query term, such as "90-110 nF", ">=25V", "0603" or
+ * "Package: 0805". Returns -1 if a comparison has no number to compare to */
+int Partparam::_parse( const std::string& text, struct partparam_term_t* t ){
+	std::string s = trim( text );
+	double v = 0.0;
+	char unit[PARTPARAM_UNIT_LEN];
+
+	t->key.clear();
+	t->numeric = false;
+	t->lo = -std::numeric_limits<double>::infinity();
+	t->hi = std::numeric_limits<double>::infinity();
+	t->unit.clear();
+	t->text.clear();
+
+	/* Limited to a single key */
+	size_t colon = s.find( ':' );
+	if( std::string::npos != colon && colon > 0 ){
+		t->key = lower( trim( s.substr( 0, colon ) ) );
+		s = trim( s.substr( colon + 1 ) );
+	}
+
+	/* Comparison */
+	for( unsigned int i = 0; i < sizeof( param_ops ) / sizeof( param_ops[0] ); i++ ){
+		size_t len = strlen( param_ops[i].sym );
+		if( 0 != s.compare( 0, len, param_ops[i].sym ) ){
+			continue;
+		}
+		if( parse_si_value( s.c_str() + len, &v, unit, sizeof( unit ) ) ){
+			return -1;
+		}
+		t->numeric = true;
+		t->unit = unit;
+		switch( param_ops[i].op ){
+			case 'g':
+				t->lo = v;
+				break;
+			case '>':
+				t->lo = nextafter( v, t->hi );
+				break;
+			case 'l':
+				t->hi = v;
+				break;
+			case '<':
+				t->hi = nextafter( v, t->lo );
+				break;
+			default:
+				eq_range( v, &t->lo, &t->hi );
+				break;
+		}
+		return 0;
+	}
+
+	/* Range; the low end takes the unit of the high end if it has none */
+	size_t sep = s.find( "\xE2\x80\x93" );
+	size_t sep_len = 3;
+	if( std::string::npos == sep ){
+		sep = s.find( ".." );
+		sep_len = 2;
+	}
+	if( std::string::npos == sep ){
+		/* Not the sign of the first number or of an exponent */
+		sep_len = 1;
+		for( sep = s.find( '-', 1 ); std::string::npos != sep; sep = s.find( '-', sep + 1 ) ){
+			if( 'e' != s[sep - 1] && 'E' != s[sep - 1] ){
+				break;
+			}
+		}
+	}
+	if( std::string::npos != sep && sep > 0 ){
+		std::string left = trim( s.substr( 0, sep ) );
+		std::string right = trim( s.substr( sep + sep_len ) );
+		double lo = 0.0;
+		double hi = 0.0;
+		char lo_unit[PARTPARAM_UNIT_LEN];
+		char hi_unit[PARTPARAM_UNIT_LEN];
+		if( !parse_si_value( right.c_str(), &hi, hi_unit, sizeof( hi_unit ) ) && !parse_si_value( left.c_str(), &lo, lo_unit, sizeof( lo_unit ) ) ){
+			if( unit_text( left ).empty() ){
+				left += unit_text( right );
+				parse_si_value( left.c_str(), &lo, lo_unit, sizeof( lo_unit ) );
+			}
+			if( 0 == strcmp( lo_unit, hi_unit ) ){
+				t->numeric = true;
+				t->unit = hi_unit;
+				t->lo = ( lo < hi ) ? lo : hi;
+				t->hi = ( lo < hi ) ? hi : lo;
+				return 0;
+			}
+		}
+	}
+
+	/* Number with a unit is compared as a number, anything else as written */
+	if( !parse_si_value( s.c_str(), &v, unit, sizeof( unit ) ) && '\0' != unit[0] ){
+		t->numeric = true;
+		t->unit = unit;
+		eq_range( v, &t->lo, &t->hi );
+		return 0;
+	}
+	t->text = lower( s );
+	return 0;
+}
+
+/* Clear documents not matching term from the match flags. A document matches
+ * if any column the term applies to holds */
+void Partparam::_scan( const struct partparam_term_t* t ){
+	unsigned char* m = term_match.data();
+	std::fill( term_match.begin(), term_match.end(), 0 );
+
+	if( t->numeric ){
+		for( auto& col : nums ){
+			if( col.unit != t->unit || ( !t->key.empty() && col.key != t->key ) ){
+				continue;
+			}
+			/* NaN compares false, so documents without the value drop out */
+			const double* v = col.val.data();
+			const double lo = t->lo;
+			const double hi = t->hi;
+			for( unsigned int i = 0; i < ndocs; i++ ){
+				m[i] |= (unsigned char)( ( v[i] >= lo ) & ( v[i] <= hi ) );
+			}
+		}
+	}
+	else {
+		for( auto& col : strs ){
+			if( !t->key.empty() && col.key != t->key ){
+				continue;
+			}
+			auto c = col.dict.find( t->text );
+			if( c == col.dict.end() ){
+				continue;
+			}
+			const unsigned int* k = col.code.data();
+			const unsigned int code = c->second;
+			for( unsigned int i = 0; i < ndocs; i++ ){
+				m[i] |= (unsigned char)( k[i] == code );
+			}
+		}
+	}
+
+	unsigned char* all = match.data();
+	for( unsigned int i = 0; i < ndocs; i++ ){
+		all[i] &= m[i];
+	}
+}
+
+/* Public functions */
+
+Partparam::Partparam(){
+	ndocs = 0;
+	index_gen = 0;
+	have_gen = false;
+	last_gen = 0;
+	have_last = false;
+}
+
+Partparam::~Partparam(){
+
+}
+
+/* Build columns from every part in the index; only done again when the index
+ * changed. Returns 1 if columns were built */
+int Partparam::update( class Partindex* index ){
+	if( nullptr == index ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return -1;
+	}
+	if( have_gen && index_gen == index->generation() ){
+		return 0;
+	}
+
+	nums.clear();
+	strs.clear();
+	num_by_id.clear();
+	str_by_key.clear();
+	ndocs = index->docs();
+
+	for( unsigned int id = 0; id < ndocs; id++ ){
+		struct partindex_doc_t d;
+		if( index->doc( id, &d ) ){
+			continue;
+		}
+		struct part_t* p = d.cache->read( d.idx );
+		if( nullptr == p || nullptr == p->info ){
+			continue;
+		}
+		for( unsigned int j = 0; j < p->info_len; j++ ){
+			if( nullptr == p->info[j].key || nullptr == p->info[j].val ){
+				continue;
+			}
+
+			/* Unit can be held in a field of its own, as in "value" and
+			 * "value-unit" */
+			std::string val = p->info[j].val;
+			std::string unit_key = std::string( p->info[j].key ) + "-unit";
+			for( unsigned int k = 0; k < p->info_len; k++ ){
+				if( nullptr != p->info[k].key && nullptr != p->info[k].val && unit_key == p->info[k].key ){
+					val += p->info[k].val;
+					break;
+				}
+			}
+			_add( id, lower( p->info[j].key ), val.c_str() );
+		}
+	}
+
+	index_gen = index->generation();
+	have_gen = true;
+	have_last = false;
+	y_log_message( Y_LOG_LEVEL_DEBUG, "Parametric columns rebuilt; %u numeric and %u value columns over %u parts", (unsigned int)nums.size(), (unsigned int)strs.size(), ndocs );
+	return 1;
+}
+
+/* Number of numeric columns */
+unsigned int Partparam::columns( void ){
+	return nums.size();
+}
+
+/* Ids of documents matching every term of query, in ascending order. err is
+ * set to a description of the first term that could not be read, or NULL.
+ * Stays valid until the next query or update */
+const std::vector<unsigned int>* Partparam::query( const char* text, const std::string** err ){
+	struct partparam_term_t t;
+	unsigned int nterms = 0;
+
+	if( nullptr != err ){
+		*err = nullptr;
+	}
+	if( nullptr == text ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		last_hits.clear();
+		have_last = false;
+		return &last_hits;
+	}
+
+	if( !have_last || last_gen != index_gen || last_query != text ){
+		last_hits.clear();
+		last_err.clear();
+		match.assign( ndocs, 1 );
+		term_match.resize( ndocs );
+
+		std::string q( text );
+		size_t start = 0;
+		while( start <= q.size() ){
+			size_t end = q.find( ',', start );
+			if( std::string::npos == end ){
+				end = q.size();
+			}
+			std::string term = trim( q.substr( start, end - start ) );
+			start = end + 1;
+			if( term.empty() ){
+				continue;
+			}
+			if( _parse( term, &t ) ){
+				last_err = "Could not read value of \"" + term + "\"";
+				nterms = 0;
+				break;
+			}
+			_scan( &t );
+			nterms++;
+		}
+
+		if( nterms > 0 ){
+			for( unsigned int i = 0; i < ndocs; i++ ){
+				if( match[i] ){
+					last_hits.push_back( i );
+				}
+			}
+		}
+		last_query = text;
+		last_gen = index_gen;
+		have_last = true;
+	}
+
+	if( nullptr != err && !last_err.empty() ){
+		*err = &last_err;
+	}
+	return &last_hits;
+}
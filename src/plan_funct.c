@@ -0,0 +1,293 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <part_funct.h>
+#include <proj_funct.h>
+#include <plan_funct.h>
+
+/* Compare exploded line key against plan line */
+static int cmp_plan_line( const void* key, const void* elem ){
+	const struct proj_flat_line_t* k = (const struct proj_flat_line_t*)key;
+	const struct plan_line_t* l = (const struct plan_line_t*)elem;
+	struct proj_flat_line_t tmp;
+	tmp.type = l->type;
+	tmp.ipn = l->ipn;
+	return cmp_proj_flat_line( k, &tmp );
+}
+
+/* Collect unique parts of all builds into plan lines */
+static int plan_collect_lines( struct plan_t* plan ){
+	struct proj_flat_line_t* all = NULL;
+	unsigned int total = 0;
+	unsigned int n = 0;
+
+	for( unsigned int i = 0; i < plan->nbuilds; i++ ){
+		total += plan->builds[i].prj->flat->nlines;
+	}
+	if( 0 == total ){
+		return 0;
+	}
+
+	all = calloc( total, sizeof( struct proj_flat_line_t ) );
+	plan->line = calloc( total, sizeof( struct plan_line_t ) );
+	if( NULL == all || NULL == plan->line ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; could not allocate memory for plan lines", __func__ );
+		free( all );
+		return -1;
+	}
+
+	for( unsigned int i = 0; i < plan->nbuilds; i++ ){
+		struct proj_flat_t* flat = plan->builds[i].prj->flat;
+		memcpy( &all[n], flat->line, flat->nlines * sizeof( struct proj_flat_line_t ) );
+		n += flat->nlines;
+	}
+
+	/* Merge duplicates between projects */
+	qsort( all, total, sizeof( struct proj_flat_line_t ), cmp_proj_flat_line );
+	n = 0;
+	for( unsigned int i = 0; i < total; i++ ){
+		if( n > 0 && !cmp_proj_flat_line( &all[i], &all[i - 1] ) ){
+			if( NULL == plan->line[n - 1].part ){
+				plan->line[n - 1].part = all[i].part;
+			}
+			continue;
+		}
+		plan->line[n].ipn = all[i].ipn;
+		plan->line[n].type = all[i].type;
+		plan->line[n].part = all[i].part;
+		n++;
+	}
+	plan->nlines = n;
+	free( all );
+
+	/* Stock is counted once, however many projects use the part. Price
+	 * curves are compiled here so pricing can run on several threads */
+	for( unsigned int i = 0; i < plan->nlines; i++ ){
+		if( NULL != plan->line[i].part ){
+			plan->line[i].stock = get_part_total_inventory( plan->line[i].part );
+			get_part_price_curve( plan->line[i].part );
+		}
+	}
+	return 0;
+}
+
+/* Record shortage of a part for a build; size is allocated entries */
+static int plan_add_short( struct plan_t* plan, unsigned int* size, unsigned int line, unsigned int build, unsigned int q ){
+	if( plan->nshorts >= *size ){
+		unsigned int new_size = *size ? *size * 2 : 64;
+		struct plan_short_t* tmp = realloc( plan->shorts, new_size * sizeof( struct plan_short_t ) );
+		if( NULL == tmp ){
+			y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; could not allocate memory for plan shortages", __func__ );
+			return -1;
+		}
+		plan->shorts = tmp;
+		*size = new_size;
+	}
+	plan->shorts[plan->nshorts].line = line;
+	plan->shorts[plan->nshorts].build = build;
+	plan->shorts[plan->nshorts].q = q;
+	plan->nshorts++;
+	return 0;
+}
+
+/* Group shortages by part, keeping build order within a part */
+static int cmp_plan_short( const void* a, const void* b ){
+	const struct plan_short_t* sa = (const struct plan_short_t*)a;
+	const struct plan_short_t* sb = (const struct plan_short_t*)b;
+	if( sa->line != sb->line ){
+		return (sa->line > sb->line) - (sa->line < sb->line);
+	}
+	return (sa->build > sb->build) - (sa->build < sb->build);
+}
+
+/* Plan builds against shared stock. Builds are given stock in order, so the
+ * first build has the highest priority. Purchases are priced separately */
+struct plan_t* plan_builds( struct plan_build_t* builds, unsigned int nbuilds ){
+	struct plan_t* plan = NULL;
+	unsigned int* remaining = NULL;
+	unsigned int* idx = NULL;
+	unsigned int max_lines = 0;
+	unsigned int shorts_size = 0;
+
+	if( NULL == builds ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return NULL;
+	}
+
+	/* Make sure every project is exploded */
+	for( unsigned int i = 0; i < nbuilds; i++ ){
+		builds[i].nbuild = 0;
+		builds[i].nshort = 0;
+		if( NULL == get_proj_flat( builds[i].prj ) ){
+			y_log_message( Y_LOG_LEVEL_ERROR, "Could not explode project for build %u of plan", i );
+			return NULL;
+		}
+		if( builds[i].prj->flat->nlines > max_lines ){
+			max_lines = builds[i].prj->flat->nlines;
+		}
+	}
+
+	plan = calloc( 1, sizeof( struct plan_t ) );
+	if( NULL == plan ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; could not allocate memory for plan", __func__ );
+		return NULL;
+	}
+	plan->builds = builds;
+	plan->nbuilds = nbuilds;
+
+	if( plan_collect_lines( plan ) ){
+		free_plan_t( plan );
+		return NULL;
+	}
+
+	remaining = calloc( plan->nlines + 1, sizeof( unsigned int ) );
+	idx = calloc( max_lines + 1, sizeof( unsigned int ) );
+	if( NULL == remaining || NULL == idx ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; could not allocate memory for stock allocation", __func__ );
+		free( remaining );
+		free( idx );
+		free_plan_t( plan );
+		return NULL;
+	}
+	for( unsigned int i = 0; i < plan->nlines; i++ ){
+		remaining[i] = plan->line[i].stock;
+	}
+
+	/* Give stock to builds by priority. Each build claims stock for all its
+	 * wanted units, so lower priority builds only get what is left over */
+	for( unsigned int b = 0; b < nbuilds; b++ ){
+		struct proj_flat_t* flat = builds[b].prj->flat;
+		unsigned int nbuild = builds[b].units;
+
+		/* Units buildable from what is left */
+		for( unsigned int i = 0; i < flat->nlines; i++ ){
+			struct plan_line_t* l = bsearch( &flat->line[i], plan->line, plan->nlines, sizeof( struct plan_line_t ), cmp_plan_line );
+			idx[i] = (unsigned int)( l - plan->line );
+			if( flat->line[i].q > 0 && remaining[idx[i]] / flat->line[i].q < nbuild ){
+				nbuild = remaining[idx[i]] / flat->line[i].q;
+			}
+		}
+		builds[b].nbuild = nbuild;
+
+		/* Claim stock for wanted units */
+		for( unsigned int i = 0; i < flat->nlines; i++ ){
+			struct plan_line_t* l = &plan->line[idx[i]];
+			unsigned int want = flat->line[i].q * builds[b].units;
+			unsigned int use = ( remaining[idx[i]] < want ) ? remaining[idx[i]] : want;
+
+			remaining[idx[i]] -= use;
+			l->demand += want;
+			l->alloc += use;
+			if( use < want ){
+				l->shortage += want - use;
+				builds[b].nshort++;
+				if( plan_add_short( plan, &shorts_size, idx[i], b, want - use ) ){
+					free( remaining );
+					free( idx );
+					free_plan_t( plan );
+					return NULL;
+				}
+			}
+		}
+	}
+
+	/* Group shortages by part for pricing */
+	if( plan->nshorts > 0 ){
+		qsort( plan->shorts, plan->nshorts, sizeof( struct plan_short_t ), cmp_plan_short );
+		for( unsigned int i = 0; i < plan->nshorts; i++ ){
+			struct plan_line_t* l = &plan->line[plan->shorts[i].line];
+			if( 0 == l->short_len ){
+				l->short_start = i;
+			}
+			l->short_len++;
+		}
+	}
+
+	free( remaining );
+	free( idx );
+	y_log_message( Y_LOG_LEVEL_DEBUG, "Planned %u builds over %u parts; %u build shortages", nbuilds, plan->nlines, plan->nshorts );
+	return plan;
+}
+
+/* Price purchase for plan lines [start, end). Each part is bought once for
+ * the combined shortage of all builds, at the cheapest break covering it.
+ * Ranges can be run in parallel; price curves were compiled by the planner */
+int plan_purchase_lines( struct plan_t* plan, unsigned int start, unsigned int end ){
+	if( NULL == plan ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return -1;
+	}
+	if( end > plan->nlines ){
+		end = plan->nlines;
+	}
+
+	for( unsigned int i = start; i < end; i++ ){
+		struct plan_line_t* l = &plan->line[i];
+		l->order_q = 0;
+		l->order_cost = 0.0;
+		l->separate_cost = 0.0;
+		if( 0 == l->shortage || NULL == l->part ){
+			l->order_q = l->shortage;
+			continue;
+		}
+
+		const struct part_price_curve_t* c = l->part->curve;
+
+		/* Combined order */
+		eval_part_price_curve( c, &l->shortage, 1, &l->order_q, &l->order_cost, NULL );
+
+		/* Every build ordering its own shortage, for comparison */
+		for( unsigned int j = l->short_start; j < l->short_start + l->short_len; j++ ){
+			double cost = 0.0;
+			eval_part_price_curve( c, &plan->shorts[j].q, 1, NULL, &cost, NULL );
+			l->separate_cost += cost;
+		}
+	}
+	return 0;
+}
+
+/* Total up purchase once all lines have been priced */
+int plan_purchase_total( struct plan_t* plan ){
+	if( NULL == plan ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return -1;
+	}
+
+	plan->nshort = 0;
+	plan->purchase_cost = 0.0;
+	plan->separate_cost = 0.0;
+	for( unsigned int i = 0; i < plan->nlines; i++ ){
+		if( plan->line[i].shortage > 0 ){
+			plan->nshort++;
+			plan->purchase_cost += plan->line[i].order_cost;
+			plan->separate_cost += plan->line[i].separate_cost;
+		}
+	}
+	return 0;
+}
+
+/* Price and total up purchase for whole plan */
+int plan_purchase( struct plan_t* plan ){
+	if( plan_purchase_lines( plan, 0, ( NULL != plan ) ? plan->nlines : 0 ) ){
+		return -1;
+	}
+	return plan_purchase_total( plan );
+}
+
+/* Free the plan structure; builds and projects are not touched */
+void free_plan_t( struct plan_t* plan ){
+	if( NULL != plan ){
+		if( NULL != plan->line ){
+			free( plan->line );
+			plan->line = NULL;
+			plan->nlines = 0;
+		}
+		if( NULL != plan->shorts ){
+			free( plan->shorts );
+			plan->shorts = NULL;
+			plan->nshorts = 0;
+		}
+		free( plan );
+		plan = NULL;
+	}
+}
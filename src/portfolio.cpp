@@ -0,0 +1,388 @@
+#include <portfolio.h>
+#include <climits>
+#include <cstring>
+#include <unordered_map>
+
+/* Portfolio shown in the portfolio window */
+class Portfolio portfolio;
+
+/* Private functions for operations */
+
+/* Drop part references held by copied lines */
+static void free_job_lines( struct portfolio_job_t* job ){
+	if( nullptr == job->flat.line ){
+		return;
+	}
+	for( unsigned int i = 0; i < job->flat.nlines; i++ ){
+		free_part_t( job->flat.line[i].part );
+	}
+	free( job->flat.line );
+	job->flat.line = nullptr;
+	job->flat.nlines = 0;
+}
+
+/* Copy what is needed to compute project on the task pool. Price curves are
+ * compiled here, so the task only reads them. Runs on the UI thread with the
+ * cache locked */
+int Portfolio::_copy( struct portfolio_job_t* job, struct proj_t* p, struct proj_flat_t* flat, struct proj_build_t* build ){
+	job->prj = p;
+	job->ipn = p->ipn;
+	job->stamp = flat->stamp;
+	job->gen = build->gen;
+	job->units = target;
+	job->flat.stamp = flat->stamp;
+	job->flat.total = flat->total;
+	job->flat.nlines = 0;
+	job->flat.line = nullptr;
+	job->optimal_cost = 0.0;
+	job->exact_cost = 0.0;
+	job->nbuild = 0;
+	job->nshort = 0;
+
+	if( flat->nlines > 0 ){
+		job->flat.line = (struct proj_flat_line_t*)calloc( flat->nlines, sizeof( struct proj_flat_line_t ) );
+		if( nullptr == job->flat.line ){
+			y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; could not allocate memory for project lines", __func__ );
+			return -1;
+		}
+	}
+	for( unsigned int i = 0; i < flat->nlines; i++ ){
+		struct proj_flat_line_t* l = &job->flat.line[i];
+		l->ipn = flat->line[i].ipn;
+		l->q = flat->line[i].q;
+		l->type = nullptr;
+		if( nullptr != flat->line[i].part ){
+			get_part_price_curve( flat->line[i].part );
+			l->part = ref_part_t( flat->line[i].part );
+		}
+	}
+	job->flat.nlines = flat->nlines;
+	job->stock.assign( build->stock, build->stock + build->nlines );
+
+	/* Status mix, counted once per project */
+	if( nullptr != p->stats && p->stats->stamp == flat->stamp ){
+		memcpy( job->status, p->stats->status, sizeof( job->status ) );
+	}
+	else {
+		memset( job->status, 0, sizeof( job->status ) );
+	}
+	return 0;
+}
+
+/* Compute analytics of a copied project. Only touches the copy, so it runs on
+ * the task pool */
+void Portfolio::_compute( struct portfolio_job_t* job ){
+	unsigned int nunit = UINT_MAX;
+
+	sum_proj_flat_cost( &job->flat, 0, job->flat.nlines, &job->units, 1, &job->optimal_cost, &job->exact_cost );
+
+	/* Same as the build solver: lines without a quantity never limit it */
+	for( unsigned int i = 0; i < job->flat.nlines; i++ ){
+		if( job->flat.line[i].q > 0 && job->stock[i] / job->flat.line[i].q < nunit ){
+			nunit = job->stock[i] / job->flat.line[i].q;
+		}
+	}
+	job->nbuild = ( UINT_MAX == nunit ) ? 0 : nunit;
+	job->nshort = 0;
+	if( nunit < job->units ){
+		for( unsigned int i = 0; i < job->flat.nlines; i++ ){
+			if( job->flat.line[i].q > 0 && job->stock[i] / job->flat.line[i].q < job->units ){
+				job->nshort++;
+			}
+		}
+	}
+	free_job_lines( job );
+}
+
+/* Swap in results of a finished rollup task; runs on the UI thread */
+void Portfolio::_done( std::vector<struct portfolio_job_t>* jobs ){
+	std::unordered_map<struct proj_t*, unsigned int> by_prj;
+
+	if( nrunning > 0 ){
+		nrunning--;
+	}
+	for( unsigned int i = 0; i < rows.size(); i++ ){
+		if( nullptr != rows[i].prj ){
+			by_prj[rows[i].prj] = i;
+		}
+	}
+
+	for( auto& job : *jobs ){
+		auto it = by_prj.find( job.prj );
+		/* Project went away, or units changed while computing */
+		if( it == by_prj.end() || rows[it->second].ipn != job.ipn || job.units != target ){
+			continue;
+		}
+		struct portfolio_row_t* r = &rows[it->second];
+		r->optimal_cost = job.optimal_cost;
+		r->exact_cost = job.exact_cost;
+		r->nbuild = job.nbuild;
+		r->nshort = job.nshort;
+		memcpy( r->status, job.status, sizeof( r->status ) );
+		r->nlines = (unsigned int)job.stock.size();
+		r->stamp = job.stamp;
+		r->gen = job.gen;
+		r->valid = true;
+		r->busy = false;
+	}
+	delete jobs;
+
+	_totals();
+
+	/* Projects may have changed while computing; checked on the next update */
+	have_gen = false;
+}
+
+/* Totals over the portfolio */
+void Portfolio::_totals( void ){
+	optimal_total = 0.0;
+	nshort_prj = 0;
+	memset( status_total, 0, sizeof( status_total ) );
+	for( auto& r : rows ){
+		if( !r.valid ){
+			continue;
+		}
+		optimal_total += r.optimal_cost;
+		if( r.nshort > 0 ){
+			nshort_prj++;
+		}
+		for( unsigned int i = 0; i < (unsigned int)pstat_total; i++ ){
+			status_total[i] += r.status[i];
+		}
+	}
+}
+
+/* Line rows up with the projects currently in the cache, keeping results of
+ * projects that are still there. Cache must be locked */
+void Portfolio::_match( class Prjcache* cache ){
+	std::vector<struct portfolio_row_t> old;
+	std::unordered_map<struct proj_t*, unsigned int> by_prj;
+
+	old.swap( rows );
+	for( unsigned int i = 0; i < old.size(); i++ ){
+		if( nullptr != old[i].prj ){
+			by_prj[old[i].prj] = i;
+		}
+	}
+
+	rows.reserve( cache->items() );
+	for( unsigned int i = 0; i < cache->items(); i++ ){
+		struct proj_t* p = cache->read( i );
+		struct portfolio_row_t r = {};
+		if( nullptr == p ){
+			rows.push_back( r );
+			continue;
+		}
+
+		auto it = by_prj.find( p );
+		if( it != by_prj.end() && old[it->second].ipn == p->ipn && nullptr != p->ver && old[it->second].ver == p->ver ){
+			rows.push_back( std::move( old[it->second] ) );
+			continue;
+		}
+
+		/* New project, or pointer reused by a different one */
+		r.prj = p;
+		r.ipn = p->ipn;
+		r.pn = ( nullptr != p->pn ) ? p->pn : "";
+		r.name = ( nullptr != p->name ) ? p->name : "";
+		r.ver = ( nullptr != p->ver ) ? p->ver : "";
+		r.valid = false;
+		rows.push_back( r );
+	}
+}
+
+/* Public functions */
+
+Portfolio::Portfolio(){
+	cache_gen = 0;
+	target = 1;
+	have_gen = false;
+	nrunning = 0;
+	nwaiting = 0;
+	optimal_total = 0.0;
+	nshort_prj = 0;
+	memset( status_total, 0, sizeof( status_total ) );
+}
+
+Portfolio::~Portfolio(){
+
+}
+
+/* Bring results up to date with the cache. Projects are hydrated and computed
+ * on the task pool, and only computed again if their exploded BOM or build
+ * solver changed. Results show up once cache_changes is drained. Cache must be
+ * locked. Returns number of projects sent to be computed */
+int Portfolio::update( class Prjcache* cache, unsigned int units, bool force ){
+	std::vector<struct portfolio_stock_t> changes;
+	std::vector<struct portfolio_job_t>* jobs = nullptr;
+
+	if( nullptr == cache ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return -1;
+	}
+	if( 0 == units ){
+		units = 1;
+	}
+
+	pending_mtx.lock();
+	changes.swap( pending );
+	pending_mtx.unlock();
+
+	/* Nothing changed */
+	if( !force && changes.empty() && have_gen && 0 == nwaiting && cache_gen == cache->generation() && target == units ){
+		return 0;
+	}
+
+	_match( cache );
+	if( force || target != units ){
+		for( auto& r : rows ){
+			r.valid = false;
+		}
+	}
+	target = units;
+
+	/* Only projects already solved need the change; new solves read current
+	 * inventory anyway */
+	for( auto& r : rows ){
+		if( nullptr != r.prj && nullptr != r.prj->build ){
+			for( auto& c : changes ){
+				update_proj_build_stock( r.prj, c.type.c_str(), c.ipn, c.stock );
+			}
+		}
+	}
+	_totals();
+	cache_gen = cache->generation();
+
+	/* One rollup at a time; anything it missed is picked up once it is in */
+	if( nrunning > 0 ){
+		have_gen = false;
+		return 0;
+	}
+	have_gen = true;
+
+	nwaiting = 0;
+	jobs = new std::vector<struct portfolio_job_t>;
+	for( auto& r : rows ){
+		if( nullptr == r.prj ){
+			continue;
+		}
+
+		/* Exploding and solving is left to the cache */
+		int retval = cache->hydrate( r.prj );
+		if( retval > 0 ){
+			r.busy = true;
+			nwaiting++;
+			continue;
+		}
+		struct proj_flat_t* flat = r.prj->flat;
+		struct proj_build_t* build = r.prj->build;
+		if( retval < 0 || nullptr == flat || nullptr == build || build->stamp != flat->stamp || build->nlines != flat->nlines ){
+			r.valid = false;
+			r.busy = false;
+			continue;
+		}
+		if( r.valid && r.stamp == flat->stamp && r.gen == build->gen ){
+			r.busy = false;
+			continue;
+		}
+
+		jobs->emplace_back();
+		if( _copy( &jobs->back(), r.prj, flat, build ) ){
+			free_job_lines( &jobs->back() );
+			jobs->pop_back();
+			r.valid = false;
+			r.busy = false;
+			continue;
+		}
+		r.busy = true;
+	}
+
+	unsigned int njobs = jobs->size();
+	if( 0 == njobs ){
+		delete jobs;
+		return 0;
+	}
+
+	/* Split over the task pool; each task swaps in its own results */
+	for( unsigned int start = 0; start < njobs; start += PORTFOLIO_PROJECTS_PER_TASK ){
+		unsigned int end = ( start + PORTFOLIO_PROJECTS_PER_TASK < njobs ) ? start + PORTFOLIO_PROJECTS_PER_TASK : njobs;
+		std::vector<struct portfolio_job_t>* part = new std::vector<struct portfolio_job_t>;
+		for( unsigned int i = start; i < end; i++ ){
+			part->push_back( std::move( (*jobs)[i] ) );
+		}
+
+		nrunning++;
+		int retval = task_pool.submit( [this, part](){
+			for( auto& job : *part ){
+				_compute( &job );
+			}
+			cache_changes.push( this,
+				[this, part](){
+					_done( part );
+				},
+				[part](){
+					delete part;
+				} );
+		});
+		if( retval ){
+			y_log_message( Y_LOG_LEVEL_ERROR, "Could not compute %u portfolio projects", end - start );
+			for( auto& job : *part ){
+				free_job_lines( &job );
+			}
+			delete part;
+			nrunning--;
+			have_gen = false;
+		}
+	}
+	delete jobs;
+
+	y_log_message( Y_LOG_LEVEL_DEBUG, "Portfolio computing %u of %u projects", njobs, (unsigned int)rows.size() );
+	return (int)njobs;
+}
+
+/* Stock of part changed; applied to every project on the next update */
+void Portfolio::stock_changed( const char* type, unsigned int ipn, unsigned int stock ){
+	if( nullptr == type ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return;
+	}
+	pending_mtx.lock();
+	for( auto& c : pending ){
+		if( c.ipn == ipn && c.type == type ){
+			c.stock = stock;
+			pending_mtx.unlock();
+			return;
+		}
+	}
+	struct portfolio_stock_t c = { type, ipn, stock };
+	pending.push_back( c );
+	pending_mtx.unlock();
+}
+
+unsigned int Portfolio::size( void ){
+	return rows.size();
+}
+
+/* Results of project at index; NULL if index is out of range */
+const struct portfolio_row_t* Portfolio::row( unsigned int index ){
+	if( index >= rows.size() ){
+		return nullptr;
+	}
+	return &rows[index];
+}
+
+unsigned int Portfolio::get_units( void ){
+	return target;
+}
+
+double Portfolio::get_optimal_total( void ){
+	return optimal_total;
+}
+
+unsigned int Portfolio::get_nshort_projects( void ){
+	return nshort_prj;
+}
+
+const unsigned int* Portfolio::get_status_mix( void ){
+	return status_total;
+}
@@ -1,6 +1,8 @@
 #include <prjcache.h>
 #include <imgui.h>
 #include <cstring>
+#include <algorithm>
+#include <thread>
 /* Private functions for operations; NOT THREAD SAVE. USE MUTEX IN CALLED
  * FUNCTION */
 
@@ -15,7 +17,7 @@ int Prjcache::_write( struct proj_t * p, unsigned int index ){
 		/* Check if overwritting data vs new allocation */
 		if( nullptr != cache[index] ){
 			/* Data exists, should free */
-			free_proj_t( cache[index] );
+			_release( cache[index] );
 			cache[index] = nullptr;
 		}
 		cache[index] = p;
@@ -52,6 +54,12 @@ int Prjcache::_clean( void ){
 	/* Empty the vector, close it out to 0 elements */
 	cache.clear();
 
+	/* Nothing is hydrating anymore by the time the cache is cleaned */
+	for( auto r : retired ){
+		free_proj_t( r );
+	}
+	retired.clear();
+
 
 	return 0;
 }
@@ -101,9 +109,283 @@ int Prjcache::_append_ipn( unsigned int ipn ){
 	}
 }
 
+/* Check if project is, or is a subproject of, node */
+static bool contains_proj( struct proj_t* node, struct proj_t* p ){
+	if( nullptr == node ){
+		return false;
+	}
+	if( node == p ){
+		return true;
+	}
+	for( int i = 0; i < node->nsub; i++ ){
+		if( contains_proj( node->sub[i].prj, p ) ){
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Find project or subproject with ipn under node */
+static struct proj_t* find_proj( struct proj_t* node, unsigned int ipn ){
+	if( nullptr == node ){
+		return nullptr;
+	}
+	if( node->ipn == ipn ){
+		return node;
+	}
+	for( int i = 0; i < node->nsub; i++ ){
+		struct proj_t* p = find_proj( node->sub[i].prj, ipn );
+		if( nullptr != p ){
+			return p;
+		}
+	}
+	return nullptr;
+}
+
+/* Free project taken out of the cache. If a hydration is still reading its
+ * tree, it is retired instead and freed once the hydration is done */
+void Prjcache::_release( struct proj_t* p ){
+	if( nullptr == p ){
+		return;
+	}
+	for( auto job : hydrating ){
+		if( contains_proj( p, job->prj ) ){
+			retired.push_back( p );
+			return;
+		}
+	}
+	free_proj_t( p );
+}
+
+/* Free retired projects that no hydration is reading anymore */
+void Prjcache::_reap( void ){
+	for( unsigned int i = 0; i < retired.size(); ){
+		bool busy = false;
+		for( auto job : hydrating ){
+			if( contains_proj( retired[i], job->prj ) ){
+				busy = true;
+				break;
+			}
+		}
+		if( busy ){
+			i++;
+			continue;
+		}
+		free_proj_t( retired[i] );
+		retired.erase( retired.begin() + i );
+	}
+}
+
+/* Project has everything the data panel needs without exploding it on the UI
+ * thread */
+bool Prjcache::_ready( struct proj_t* p ){
+	return ( p->flags & PROJ_FLAG_HYDRATED ) || ( nullptr != p->flat && nullptr != p->build );
+}
+
+/* Hydration running for project; NULL if none */
+struct prjcache_hydrate_t* Prjcache::_find_hydrate( struct proj_t* p ){
+	for( auto job : hydrating ){
+		if( job->prj == p ){
+			return job;
+		}
+	}
+	return nullptr;
+}
+
+/* Start hydrating project on the task pool. The tree is only read there; the
+ * results are swapped in on the UI thread between frames through
+ * cache_changes. Returns 0 if project is ready, 1 if it is still hydrating */
+int Prjcache::_hydrate( struct proj_t* p, bool prefetch ){
+	if( _ready( p ) ){
+		return 0;
+	}
+
+	struct prjcache_hydrate_t* job = _find_hydrate( p );
+	if( nullptr != job ){
+		/* Selected while prefetching */
+		if( !prefetch ){
+			job->prefetch = false;
+		}
+		return 1;
+	}
+
+	/* Don't let hovering flood the task pool */
+	if( prefetch ){
+		unsigned int n = 0;
+		for( auto j : hydrating ){
+			if( j->prefetch ){
+				n++;
+			}
+		}
+		if( n >= PRJCACHE_PREFETCH_MAX ){
+			return 1;
+		}
+	}
+
+	job = new struct prjcache_hydrate_t;
+	job->prj = p;
+	job->step = 0;
+	job->prefetch = prefetch;
+	hydrating.push_back( job );
+	nrunning++;
+
+	int retval = task_pool.submit( [this, job](){
+		struct proj_hydrate_t* h = hydrate_proj_flat( job->prj );
+		job->step = 1;
+		if( nullptr != h ){
+			hydrate_proj_build( h );
+			job->step = 2;
+			hydrate_proj_stats( h );
+		}
+		job->step = PRJCACHE_HYDRATE_STEPS;
+
+		cache_changes.push( &hydrating,
+			[this, job, h](){
+				cmtx.lock();
+				_hydrate_done( job, h );
+				cmtx.unlock();
+			},
+			[h](){
+				free_proj_hydrate_t( h );
+			} );
+		nrunning--;
+	});
+	if( retval ){
+		hydrating.pop_back();
+		delete job;
+		nrunning--;
+		return -1;
+	}
+
+	y_log_message( Y_LOG_LEVEL_DEBUG, "Hydrating project %u%s", p->ipn, prefetch ? " ahead of selection" : "" );
+	return 1;
+}
+
+/* Swap in results of a finished hydration; runs on the UI thread */
+void Prjcache::_hydrate_done( struct prjcache_hydrate_t* job, struct proj_hydrate_t* h ){
+	auto it = std::find( hydrating.begin(), hydrating.end(), job );
+	if( it != hydrating.end() ){
+		hydrating.erase( it );
+	}
+
+	/* Project may have been replaced by a refresh while hydrating */
+	bool live = true;
+	for( auto r : retired ){
+		if( contains_proj( r, job->prj ) ){
+			live = false;
+			break;
+		}
+	}
+
+	if( live ){
+		if( nullptr == h || attach_proj_hydrate( h ) ){
+			y_log_message( Y_LOG_LEVEL_WARNING, "Could not hydrate project %u", job->prj->ipn );
+		}
+		else {
+			keep_mtx.lock();
+			keep_ipn.insert( job->prj->ipn );
+			keep_mtx.unlock();
+		}
+		/* Not tried again on failure; views compute what they can */
+		job->prj->flags |= PROJ_FLAG_HYDRATED;
+	}
+
+	free_proj_hydrate_t( h );
+	delete job;
+	_reap();
+}
+
+/* Hydrate projects shown before in a project just loaded by a refresh. The
+ * project is not in the cache yet, so it is done in place */
+void Prjcache::_hydrate_kept( struct proj_t* p ){
+	std::vector<unsigned int> ipns;
+	keep_mtx.lock();
+	ipns.assign( keep_ipn.begin(), keep_ipn.end() );
+	keep_mtx.unlock();
+
+	for( auto ipn : ipns ){
+		struct proj_t* t = find_proj( p, ipn );
+		if( nullptr == t || ( t->flags & PROJ_FLAG_HYDRATED ) ){
+			continue;
+		}
+		struct proj_hydrate_t* h = hydrate_proj_flat( t );
+		if( nullptr != h ){
+			hydrate_proj_build( h );
+			hydrate_proj_stats( h );
+			attach_proj_hydrate( h );
+			free_proj_hydrate_t( h );
+		}
+		t->flags |= PROJ_FLAG_HYDRATED;
+	}
+}
+
+/* Replace cache entries from start with projects loaded by a refresh. The
+ * selected project is remembered by ipn while its entry is replaced */
+void Prjcache::_apply( unsigned int start, std::vector<struct proj_t*>* batch ){
+	for( unsigned int i = 0; i < batch->size(); i++ ){
+		unsigned int index = start + i;
+		struct proj_t* p = (*batch)[i];
+		if( index < cache.size() ){
+			if( nullptr != selected && contains_proj( cache[index], selected ) ){
+				pending_sel_ipn = selected->ipn;
+				selected = nullptr;
+			}
+			_release( cache[index] );
+			cache[index] = p;
+		}
+		else {
+			cache.push_back( p );
+		}
+
+		if( index == pending_sel_idx ){
+			selected = p;
+			selected->selected = true;
+			pending_sel_idx = (unsigned int)-1;
+		}
+
+		/* Restore selection as soon as its replacement is in the cache */
+		if( (unsigned int)-1 != pending_sel_ipn ){
+			struct proj_t* sel = find_proj( p, pending_sel_ipn );
+			if( nullptr != sel ){
+				selected = sel;
+				selected->selected = true;
+				pending_sel_ipn = (unsigned int)-1;
+			}
+		}
+	}
+}
+
+/* Finish a refresh; drop entries past the new size and make sure that the
+ * selection points into the new cache */
+void Prjcache::_commit( unsigned int size ){
+	while( cache.size() > size ){
+		if( nullptr != selected && contains_proj( cache.back(), selected ) ){
+			pending_sel_ipn = selected->ipn;
+			selected = nullptr;
+		}
+		_remove( cache.size() - 1 );
+	}
+
+	if( (unsigned int)-1 != pending_sel_ipn ){
+		for( unsigned int i = 0; i < cache.size() && nullptr == selected; i++ ){
+			selected = find_proj( cache[i], pending_sel_ipn );
+		}
+		if( nullptr != selected ){
+			selected->selected = true;
+		}
+		else {
+			y_log_message( Y_LOG_LEVEL_WARNING, "Selected project %u no longer exists after refresh", pending_sel_ipn );
+		}
+		pending_sel_ipn = (unsigned int)-1;
+	}
+
+	gen++;
+	y_log_message( Y_LOG_LEVEL_DEBUG, "Project cache refresh applied; generation %u", gen );
+}
+
 int Prjcache::_remove( unsigned int index ){
 	if( nullptr != cache[index] ){
-		free_proj_t( cache[index] );
+		_release( cache[index] );
 		cache[index] = nullptr;
 	}
 	cache.erase( cache.begin() + index);
@@ -117,13 +399,30 @@ Prjcache::Prjcache( unsigned int size ){
 	cmtx.lock();
 	cache.assign(size, nullptr);
 	selected = nullptr;
+	pending_sel_ipn = (unsigned int)-1;
+	pending_sel_idx = (unsigned int)-1;
+	gen = 0;
+	nrunning = 0;
 	cmtx.unlock();
 	y_log_message(Y_LOG_LEVEL_DEBUG, "Created project cache");
 }
 
 /* Destructor; check for non null pointers, and clear them out */
 Prjcache::~Prjcache(){
+	/* Refresh data that was never applied */
+	cache_changes.purge( this );
+
+	/* Hydrations still reading projects, then their results */
+	while( nrunning > 0 ){
+		std::this_thread::yield();
+	}
+	cache_changes.purge( &hydrating );
+
 	cmtx.lock();
+	for( auto job : hydrating ){
+		delete job;
+	}
+	hydrating.clear();
 	_clean();
 	cmtx.unlock();
 	y_log_message(Y_LOG_LEVEL_DEBUG, "Freed memory for project cache");
@@ -138,58 +437,94 @@ unsigned int Prjcache::items(void){
 	return len;
 }
 
-/* Update project cache from database */
-int Prjcache::update( struct dbinfo_t** info ){
-	y_log_message(Y_LOG_LEVEL_DEBUG, "Updating project cache");
+/* Return refresh generation; changes whenever cache contents have changed */
+unsigned int Prjcache::generation(void){
+	unsigned int g = 0;
 	cmtx.lock();
-	/* Save current selected project index to use later */
-	unsigned int selected_idx = (unsigned int)-1;
-	/* Look through cache to find where pointer matches in vector */
-	if( nullptr != selected ){
-		for( unsigned int i = 0; i < cache.size(); i++ ){
-			if( selected == cache[i] ){
-				y_log_message( Y_LOG_LEVEL_DEBUG, "Found selected project index in cache at %d", i );
-				selected_idx = i;
-				break;
+	g = gen;
+	cmtx.unlock();
+	return g;
+}
+
+/* Queue a change batch for the UI thread; projects are owned by the batch
+ * until it is applied */
+static void push_batch( class Prjcache* pc, std::function<void(unsigned int, std::vector<struct proj_t*>*)> apply, unsigned int start, std::vector<struct proj_t*>* batch ){
+	cache_changes.push( pc,
+		[apply, start, batch](){
+			apply( start, batch );
+			delete batch;
+		},
+		[batch](){
+			for( auto p : *batch ){
+				free_proj_t( p );
 			}
-		}
-		if( selected_idx == (unsigned int)-1){
-			y_log_message( Y_LOG_LEVEL_WARNING, "Could not find selected index from project pointer during update. Could mean that selected project is a subproject." );
-			cmtx.unlock();
-			return -1;
-		}
-	}
-	/* At this point, the selected project can be updated to be the correct one
-	 * based off of what was previously selected before */
+			delete batch;
+		} );
+}
+
+/* Update project cache from database. Projects are loaded here without
+ * holding the cache, then handed to the UI thread in batches through
+ * cache_changes. The last batch commits the refresh */
+int Prjcache::update( struct dbinfo_t** info ){
+	y_log_message(Y_LOG_LEVEL_DEBUG, "Updating project cache");
 
 	unsigned int nprj = 0;
 
-	if( nullptr != (*info) ){
+	if( nullptr == info || nullptr == (*info) ){
+		y_log_message(Y_LOG_LEVEL_DEBUG, "Problems updating project cache");
+		return -1;
+	}
 
-		nprj = (*info)->nprj;
-		y_log_message(Y_LOG_LEVEL_INFO, "%u Projects found in database", nprj);
+	nprj = (*info)->nprj;
+	y_log_message(Y_LOG_LEVEL_INFO, "%u Projects found in database", nprj);
 
-		/* Clear out cache since can't guarantee movement of projects, changing
-		 * ipns, which projects were removed, etc. */
-		_clean();
-		/* Insert new elements to cache; start from index of 1 */
-		for( unsigned int i = 1; i <= nprj; i++ ){
-			/* Internal part numbers should be contiguous... but not sure if
-			 * there is a better way. */
-			_append_ipn( i );
-		}
+	/* A newer refresh replaces anything not applied yet */
+	cache_changes.purge( this );
 
-		/* Recreate selected project */
-		if( (unsigned int)-1 != selected_idx ){
-			selected = cache[selected_idx];
-			selected->selected = true;
+	auto apply = [this]( unsigned int start, std::vector<struct proj_t*>* batch ){
+		cmtx.lock();
+		_apply( start, batch );
+		cmtx.unlock();
+	};
+
+	/* Load projects; start from ipn of 1 */
+	std::vector<struct proj_t*>* batch = nullptr;
+	unsigned int size = 0;
+	for( unsigned int i = 1; i <= nprj; i++ ){
+		/* Internal part numbers should be contiguous... but not sure if
+		 * there is a better way. */
+		struct proj_t* p = get_latest_proj_from_ipn( i );
+		if( nullptr == p ){
+			y_log_message( Y_LOG_LEVEL_ERROR, "Could not add project:%d to cache; database error", i);
+			continue;
+		}
+		_hydrate_kept( p );
+		if( nullptr == batch ){
+			batch = new std::vector<struct proj_t*>();
+			batch->reserve( PRJCACHE_BATCH_SIZE );
+		}
+		batch->push_back( p );
+		if( batch->size() >= PRJCACHE_BATCH_SIZE ){
+			/* Batch belongs to the UI thread once pushed */
+			unsigned int n = batch->size();
+			push_batch( this, apply, size, batch );
+			size += n;
+			batch = nullptr;
 		}
 	}
-	else {
-		y_log_message(Y_LOG_LEVEL_DEBUG, "Problems updating project cache");
+	if( nullptr != batch ){
+		unsigned int n = batch->size();
+		push_batch( this, apply, size, batch );
+		size += n;
 	}
 
-	cmtx.unlock();
+	/* Commit record */
+	cache_changes.push( this, [this, size](){
+			cmtx.lock();
+			_commit( size );
+			cmtx.unlock();
+		}, nullptr );
+
 	return 0;
 }
 
@@ -205,8 +540,12 @@ int Prjcache::write( struct proj_t * p, unsigned int index ){
 /* Get pointer from cache; should be careful as this could have unintended
  * sideeffects if data is not copied. Will attempt without copying data first */
 struct proj_t* Prjcache::read( unsigned int index ){
+	PROF_SCOPE( prof_cache_read );
 	struct proj_t * p = nullptr;
-	cmtx.lock();
+	{
+		PROF_SCOPE( prof_lock_wait );
+		cmtx.lock();
+	}
 	p = _read( index );
 	cmtx.unlock();
 	return p;
@@ -259,12 +598,8 @@ int Prjcache::remove( unsigned int index ){
 int Prjcache::select( unsigned int index ){
 	cmtx.lock();
 
-	/* Clear out selected poitner */
-	if( nullptr != selected ){
-		free_proj_t( selected );
-	}	
-
-	if( index > cache.size() ){
+	/* Selected project points into the cache; nothing to free */
+	if( index >= cache.size() ){
 		y_log_message( Y_LOG_LEVEL_ERROR, "Project selection index %d is outside of bounds of cache", index );
 		selected = nullptr;
 		cmtx.unlock();
@@ -285,6 +620,8 @@ int Prjcache::select( unsigned int index ){
 #else 
 		selected = cache[index];
 #endif
+		/* Not loaded yet; select once the refresh reaches it */
+		pending_sel_idx = ( nullptr == selected ) ? index : (unsigned int)-1;
 		cmtx.unlock();
 		return 0;
 	}
@@ -303,8 +640,8 @@ int Prjcache::select_ptr( struct proj_t* p ){
 	}
 	if( selected_idx == (unsigned int)-1){
 		y_log_message( Y_LOG_LEVEL_ERROR, "Could not find selected index from project pointer" );
-		return -1;
 		cmtx.unlock();
+		return -1;
 	}
 
 #if 0
@@ -325,6 +662,40 @@ int Prjcache::select_ptr( struct proj_t* p ){
 	return 0;
 }
 
+/* Make sure project is hydrated. Returns 0 if it is ready to show, 1 if it is
+ * still hydrating on the task pool, -1 on error */
+int Prjcache::hydrate( struct proj_t* p ){
+	int retval = -1;
+	if( nullptr == p ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return -1;
+	}
+	cmtx.lock();
+	retval = _hydrate( p, false );
+	cmtx.unlock();
+	return retval;
+}
+
+/* Fraction of hydration of project done */
+float Prjcache::hydrate_progress( struct proj_t* p ){
+	float progress = 0.0f;
+	if( nullptr == p ){
+		return 0.0f;
+	}
+	cmtx.lock();
+	if( _ready( p ) ){
+		progress = 1.0f;
+	}
+	else {
+		struct prjcache_hydrate_t* job = _find_hydrate( p );
+		if( nullptr != job ){
+			progress = (float)job->step.load() / PRJCACHE_HYDRATE_STEPS;
+		}
+	}
+	cmtx.unlock();
+	return progress;
+}
+
 struct proj_t* Prjcache::get_selected( void ){
 	struct proj_t* p;
 	cmtx.lock();
@@ -337,10 +708,9 @@ void Prjcache::display_projects( bool all_prj ){
 	cmtx.lock();
 	for( unsigned int i = 0; i < cache.size(); i++ ){
 //		y_log_message(Y_LOG_LEVEL_DEBUG, "Displaying top project %d", i);
-		if( all_prj || cache[i]->nsub > 0 ){
-			if(nullptr != cache[i] ){
-				_DisplayNode( cache[i]  );
-			}
+		/* Entries may be empty until the first refresh is applied */
+		if( nullptr != cache[i] && (all_prj || cache[i]->nsub > 0) ){
+			_DisplayNode( cache[i]  );
 		}
 	}
 
@@ -373,12 +743,18 @@ void Prjcache::_DisplayNode( struct proj_t* node ){
 		}
 
 		bool open = ImGui::TreeNodeEx(node->name, node_flags);
+
+		/* Start hydrating before it is clicked */
+		if( ImGui::IsItemHovered() ){
+			_hydrate( node, true );
+		}
 		
 		/* Check if item has been clicked */
 		if( ImGui::IsItemClicked() && !ImGui::IsItemToggledOpen() ){
 			y_log_message(Y_LOG_LEVEL_DEBUG, "In display: Node %s clicked", node->name);
 			selected = node;
 			node->selected = true;
+			pending_sel_idx = (unsigned int)-1;
 		}
 
 
@@ -411,11 +787,17 @@ void Prjcache::_DisplayNode( struct proj_t* node ){
 
 		ImGui::TreeNodeEx(node->name, node_flags );
 
+		/* Start hydrating before it is clicked */
+		if( ImGui::IsItemHovered() ){
+			_hydrate( node, true );
+		}
+
 		/* Check if item has been clicked */
 		if( ImGui::IsItemClicked() && !ImGui::IsItemToggledOpen() ){
 			y_log_message(Y_LOG_LEVEL_DEBUG, "In display: Node %s clicked", node->name);
 			selected = node;
 			node->selected = true;
+			pending_sel_idx = (unsigned int)-1;
 		}
 
 		ImGui::TableNextColumn();
@@ -434,6 +816,7 @@ bool Prjcache::getmutex( bool blocking ) {
 		return cmtx.try_lock();
 	}
 	else {
+		PROF_SCOPE( prof_lock_wait );
 		cmtx.lock();
 	}
 	return true;
@@ -0,0 +1,145 @@
+#include <profiler.h>
+
+#ifdef PROFILER_ENABLE
+
+#include <imgui.h>
+#include <implot.h>
+
+/* Profiler for the whole program */
+class Profiler profiler;
+
+/* Names of scopes, in the order of prof_scope_t */
+static const char* prof_scope_str[prof_total] = {
+	"Frame",
+	"Cache changes",
+	"Menu bar",
+	"Project view",
+	"Part view",
+	"Windows",
+	"Rollups",
+	"Cache reads",
+	"Lock wait",
+	"Database",
+	"Render"
+};
+
+Profiler::Profiler(){
+	for( unsigned int i = 0; i < (unsigned int)prof_total; i++ ){
+		acc[i] = 0;
+		calls[i] = 0;
+		hist[i].assign( PROFILER_FRAMES, 0.0 );
+		hist_calls[i].assign( PROFILER_FRAMES, 0 );
+	}
+	head = 0;
+	nframes = 0;
+	paused = false;
+	frame_start = std::chrono::steady_clock::now();
+}
+
+Profiler::~Profiler(){
+
+}
+
+/* Add time spent in scope; can be called from any thread */
+void Profiler::add( enum prof_scope_t scope, unsigned long long ns ){
+	acc[scope].fetch_add( ns, std::memory_order_relaxed );
+	calls[scope].fetch_add( 1, std::memory_order_relaxed );
+}
+
+/* Start of frame, after events have been waited for */
+void Profiler::frame_begin( void ){
+	frame_start = std::chrono::steady_clock::now();
+}
+
+/* Move this frame's totals into history */
+void Profiler::frame_end( void ){
+	unsigned long long frame_ns = std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - frame_start ).count();
+	add( prof_frame, frame_ns );
+
+	for( unsigned int i = 0; i < (unsigned int)prof_total; i++ ){
+		unsigned long long ns = acc[i].exchange( 0, std::memory_order_relaxed );
+		unsigned int n = calls[i].exchange( 0, std::memory_order_relaxed );
+		if( !paused ){
+			hist[i][head] = (double)ns / 1e6;
+			hist_calls[i][head] = n;
+		}
+	}
+	if( !paused ){
+		head = ( head + 1 ) % PROFILER_FRAMES;
+		if( nframes < PROFILER_FRAMES ){
+			nframes++;
+		}
+	}
+}
+
+/* Plot frame time and each scope over the last frames */
+void Profiler::window( bool* show ){
+	ImGui::SetNextWindowSize( ImVec2( 700, 600 ), ImGuiCond_FirstUseEver );
+	if( ImGui::Begin("Profiler", show ) ){
+		ImGui::Checkbox("Pause", &paused );
+
+		/* Oldest frame is at head once the buffer has wrapped */
+		int offset = ( nframes < PROFILER_FRAMES ) ? 0 : (int)head;
+		int count = (int)nframes;
+
+		if( ImPlot::BeginPlot("Frame time##prof_frame", ImVec2(-1, 200), ImPlotFlags_NoMouseText ) ){
+			ImPlot::SetupAxes("Frame", "ms", ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit );
+			for( unsigned int i = 0; i < (unsigned int)prof_cache_read; i++ ){
+				ImPlot::PlotLine( prof_scope_str[i], hist[i].data(), count, 1.0, 0.0, 0, offset );
+			}
+			ImPlot::EndPlot();
+		}
+
+		if( ImPlot::BeginPlot("Data and locks##prof_data", ImVec2(-1, 200), ImPlotFlags_NoMouseText ) ){
+			ImPlot::SetupAxes("Frame", "ms", ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit );
+			for( unsigned int i = (unsigned int)prof_cache_read; i < (unsigned int)prof_total; i++ ){
+				ImPlot::PlotLine( prof_scope_str[i], hist[i].data(), count, 1.0, 0.0, 0, offset );
+			}
+			ImPlot::EndPlot();
+		}
+
+		/* Averages and worst case over the history */
+		static ImGuiTableFlags flags = ImGuiTableFlags_BordersOuter | ImGuiTableFlags_BordersV | ImGuiTableFlags_RowBg;
+		if( nframes > 0 && ImGui::BeginTable("prof_scopes", 4, flags ) ){
+			ImGui::TableSetupColumn("Scope");
+			ImGui::TableSetupColumn("Avg ms");
+			ImGui::TableSetupColumn("Max ms");
+			ImGui::TableSetupColumn("Calls/frame");
+			ImGui::TableHeadersRow();
+			for( unsigned int i = 0; i < (unsigned int)prof_total; i++ ){
+				double sum = 0.0;
+				double max = 0.0;
+				unsigned long ncalls = 0;
+				for( unsigned int f = 0; f < nframes; f++ ){
+					sum += hist[i][f];
+					ncalls += hist_calls[i][f];
+					if( hist[i][f] > max ){
+						max = hist[i][f];
+					}
+				}
+				ImGui::TableNextRow();
+				ImGui::TableSetColumnIndex(0);
+				ImGui::TextUnformatted( prof_scope_str[i] );
+				ImGui::TableSetColumnIndex(1);
+				ImGui::Text("%.3lf", sum / (double)nframes );
+				ImGui::TableSetColumnIndex(2);
+				ImGui::Text("%.3lf", max );
+				ImGui::TableSetColumnIndex(3);
+				ImGui::Text("%.1lf", (double)ncalls / (double)nframes );
+			}
+			ImGui::EndTable();
+		}
+	}
+	ImGui::End();
+}
+
+Profscope::Profscope( enum prof_scope_t s ){
+	scope = s;
+	start = std::chrono::steady_clock::now();
+}
+
+Profscope::~Profscope(){
+	profiler.add( scope, std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - start ).count() );
+}
+
+#endif /* PROFILER_ENABLE */
@@ -1,124 +1,313 @@
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <part_funct.h>
 #include <proj_funct.h>
 
-/* Get number of all items in project BOM and subprojects */
-unsigned int get_num_all_uniq_proj_items( struct proj_t * p ){
-	unsigned int nitems = 0;
+/* Growable array of lines collected while exploding a project */
+struct flat_collect_t {
+	unsigned int n;
+	unsigned int size;
+	struct proj_flat_line_t* line;
+};
+
+/* Type of a bom line, fall back to cached part if line doesn't have it */
+static char* bom_line_type( struct bom_t* bom, unsigned int idx ){
+	if( NULL != bom->line[idx].type ){
+		return bom->line[idx].type;
+	}
+	if( NULL != bom->parts && NULL != bom->parts[idx] ){
+		return bom->parts[idx]->type;
+	}
+	return NULL;
+}
 
-	/* Check if project is valid */
-	if( NULL == p ){
-		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
-		return 0;
+/* Compare part types, where missing types sort first */
+static int cmp_type( const char* a, const char* b ){
+	if( NULL == a || NULL == b ){
+		return (NULL != a) - (NULL != b);
 	}
+	return strcmp( a, b );
+}
 
-	/* First get items from all boms in topmost level */
-	for( unsigned int i = 0; i < p->nboms; i++ ){
-		if( NULL == p->boms || NULL == p->boms[i].bom ){
-			y_log_message( Y_LOG_LEVEL_ERROR, "Could not access project bom for project %d. NULL pointer found", p->ipn );
-			return 0;		
+/* Sort lines by type, then ipn, so duplicates end up next to each other */
+int cmp_proj_flat_line( const void* a, const void* b ){
+	const struct proj_flat_line_t* la = (const struct proj_flat_line_t*)a;
+	const struct proj_flat_line_t* lb = (const struct proj_flat_line_t*)b;
+	int c = cmp_type( la->type, lb->type );
+	if( c ){
+		return c;
+	}
+	return (la->ipn > lb->ipn) - (la->ipn < lb->ipn);
+}
+
+/* Maximum depth of subprojects before giving up on explosion */
+#define PROJ_FLAT_DEPTH_MAX		32
+
+/* Subproject already exploded during the current computation */
+struct flat_memo_ent_t {
+	unsigned int ipn;
+	const char* ver;
+	struct proj_t* prj;				/* Subproject that was exploded */
+	struct proj_flat_t* flat;
+};
+
+/* State shared through a single explosion of a project tree. Shared
+ * subprojects are only walked once, and the stack catches cycles */
+struct flat_memo_t {
+	unsigned int n;
+	unsigned int size;
+	struct flat_memo_ent_t* ent;
+	unsigned int depth;
+	struct proj_t* stack[PROJ_FLAT_DEPTH_MAX];
+	int detached;					/* Leave projects untouched; explosions belong to memo */
+};
+
+/* Find exploded subproject by ipn and version */
+static struct proj_flat_t* memo_find( struct flat_memo_t* m, unsigned int ipn, const char* ver ){
+	for( unsigned int i = 0; i < m->n; i++ ){
+		if( m->ent[i].ipn == ipn && !cmp_type( m->ent[i].ver, ver ) ){
+			return m->ent[i].flat;
 		}
-		nitems += p->boms[i].bom->nitems;
 	}
+	return NULL;
+}
 
-	/* Next loop through all other subprojects in project */
-	for( unsigned int i = 0; i < p->nsub; i++ ){
-		if( NULL == p->sub || NULL == p->sub[i].prj ){
-			y_log_message( Y_LOG_LEVEL_ERROR, "Could not access project bom for project %d. NULL pointer found", p->ipn );
-			return 0;		
+/* Remember exploded subproject */
+static int memo_add( struct flat_memo_t* m, struct proj_t* prj, struct proj_flat_t* flat ){
+	if( m->n >= m->size ){
+		unsigned int size = m->size ? m->size * 2 : 16;
+		struct flat_memo_ent_t* tmp = realloc( m->ent, size * sizeof( struct flat_memo_ent_t ) );
+		if( NULL == tmp ){
+			y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; could not allocate memory for subproject memo", __func__ );
+			return -1;
 		}
-		/* Check if parts are unique */
+		m->ent = tmp;
+		m->size = size;
+	}
+	m->ent[m->n].ipn = prj->ipn;
+	m->ent[m->n].ver = prj->ver;
+	m->ent[m->n].prj = prj;
+	m->ent[m->n].flat = flat;
+	m->n++;
+	return 0;
+}
 
-		/* Recursively go through subprojects */
-		int sub_nitems = get_num_all_uniq_proj_items( p->sub[i].prj ); 
-		nitems += sub_nitems;
+/* Make sure n more lines fit in collection */
+static int flat_reserve( struct flat_collect_t* c, unsigned int n ){
+	if( c->n + n > c->size ){
+		unsigned int size = c->size ? c->size : 64;
+		while( size < c->n + n ){
+			size *= 2;
+		}
+		struct proj_flat_line_t* tmp = realloc( c->line, size * sizeof( struct proj_flat_line_t ) );
+		if( NULL == tmp ){
+			y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; could not allocate memory for exploded bom", __func__ );
+			return -1;
+		}
+		c->line = tmp;
+		c->size = size;
 	}
-	y_log_message( Y_LOG_LEVEL_DEBUG, "Total unique items in project: %u", nitems );
-	return nitems;
+	return 0;
 }
 
-/* Retrieve total number of single part type used */
-unsigned int get_num_all_proj_type_items( struct proj_t * p, char * ptype ){
-	unsigned int nitems = 0;
+/* Free exploded project; lines point into the boms, so nothing else to free */
+static void free_flat( struct proj_flat_t* flat ){
+	if( NULL != flat ){
+		free( flat->line );
+		free( flat );
+	}
+}
 
-	/* Check if project is valid */
-	if( NULL == p ){
-		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
-		return 0;
+/* Free build solver */
+static void free_build( struct proj_build_t* b ){
+	if( NULL != b ){
+		free( b->stock );
+		free( b->units );
+		free( b );
+	}
+}
+
+/* Sort collected lines and merge duplicates into new exploded project */
+static struct proj_flat_t* flat_merge( struct flat_collect_t* c, unsigned long stamp ){
+	unsigned int n = 0;
+	struct proj_flat_t* flat = calloc( 1, sizeof( struct proj_flat_t ) );
+	if( NULL == flat ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; could not allocate memory for exploded bom", __func__ );
+		return NULL;
+	}
+
+	if( c->n > 0 ){
+		qsort( c->line, c->n, sizeof( struct proj_flat_line_t ), cmp_proj_flat_line );
+		for( unsigned int i = 0; i < c->n; i++ ){
+			if( n > 0 && !cmp_proj_flat_line( &c->line[n - 1], &c->line[i] ) ){
+				c->line[n - 1].q += c->line[i].q;
+				/* Keep whichever occurrence has the part loaded */
+				if( NULL == c->line[n - 1].part ){
+					c->line[n - 1].part = c->line[i].part;
+				}
+			}
+			else {
+				c->line[n++] = c->line[i];
+			}
+			flat->total += c->line[i].q;
+		}
 	}
 
-	/* First get items from all boms in topmost level */
+	flat->stamp = stamp;
+	flat->nlines = n;
+	flat->line = c->line;
+	c->line = NULL;
+	return flat;
+}
+
+/* FNV-1a offset basis and prime for combining revisions into a stamp */
+#define STAMP_BASIS		(14695981039346656037ULL)
+#define STAMP_PRIME		(1099511628211ULL)
+
+/* Fold value into stamp. Unlike a sum, different sets of revisions are
+ * unlikely to give the same stamp */
+static unsigned long stamp_fold( unsigned long stamp, unsigned long v ){
+	for( unsigned int i = 0; i < sizeof( v ); i++ ){
+		stamp ^= ( v >> ( 8 * i ) ) & 0xff;
+		stamp *= (unsigned long)STAMP_PRIME;
+	}
+	return stamp;
+}
+
+/* Combined revision of every part in bom, so that anything kept for the same
+ * stamp is redone when prices, status or stock of a part change */
+static unsigned long bom_part_stamp( struct bom_t* bom ){
+	unsigned long stamp = (unsigned long)STAMP_BASIS;
+	if( NULL == bom->parts ){
+		return stamp;
+	}
+	for( unsigned int i = 0; i < bom->nitems; i++ ){
+		/* Missing parts are folded in too, so parts moving between lines
+		 * change the stamp */
+		stamp = stamp_fold( stamp, ( NULL != bom->parts[i] ) ? bom->parts[i]->rev + 1 : 0 );
+	}
+	return stamp;
+}
+
+/* Explode project, reusing subprojects already exploded in this computation.
+ * Subprojects are merged from their own explosion instead of walked again */
+static struct proj_flat_t* explode_proj( struct proj_t* p, struct flat_memo_t* m ){
+	struct flat_collect_t c = { 0, 0, NULL };
+	struct proj_flat_t** subflat = NULL;
+	struct proj_flat_t* flat = NULL;
+	unsigned long stamp = stamp_fold( (unsigned long)STAMP_BASIS, p->rev );
+
+	/* Stop a subproject that points back to a parent */
+	for( unsigned int i = 0; i < m->depth; i++ ){
+		if( m->stack[i] == p || ( m->stack[i]->ipn == p->ipn && !cmp_type( m->stack[i]->ver, p->ver ) ) ){
+			y_log_message( Y_LOG_LEVEL_ERROR, "Project %u:%s references itself through its subprojects", p->ipn, p->ver );
+			return NULL;
+		}
+	}
+	if( m->depth >= PROJ_FLAT_DEPTH_MAX ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "Subprojects of project %u nested deeper than %d", p->ipn, PROJ_FLAT_DEPTH_MAX );
+		return NULL;
+	}
+	m->stack[m->depth++] = p;
+
+	/* Boms in this level of the project */
 	for( unsigned int i = 0; i < p->nboms; i++ ){
 		if( NULL == p->boms || NULL == p->boms[i].bom ){
 			y_log_message( Y_LOG_LEVEL_ERROR, "Could not access project bom for project %d. NULL pointer found", p->ipn );
-			return 0;		
-		}
-		
-		/* Loop through the BOM for each part */
-		for( unsigned int j = 0; j < p->boms[i].bom->nitems; j++ ){
-			/* Check if type matches */
-			if( !strcmp( ptype, p->boms[i].bom->line[j].type ) ){
-				/* Add number used to count */
-				nitems += p->boms[i].bom->line[j].q;
-			}
+			goto done;
 		}
+		stamp = stamp_fold( stamp, p->boms[i].bom->rev );
+		stamp = stamp_fold( stamp, p->boms[i].q );
+		stamp = stamp_fold( stamp, bom_part_stamp( p->boms[i].bom ) );
 	}
 
-	/* Next loop through all other subprojects in project */
+	/* Explode each distinct subproject once */
+	if( p->nsub > 0 ){
+		subflat = calloc( p->nsub, sizeof( struct proj_flat_t* ) );
+		if( NULL == subflat ){
+			y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; could not allocate memory for subproject array", __func__ );
+			goto done;
+		}
+	}
 	for( unsigned int i = 0; i < p->nsub; i++ ){
 		if( NULL == p->sub || NULL == p->sub[i].prj ){
-			y_log_message( Y_LOG_LEVEL_ERROR, "Could not access project bom for project %d. NULL pointer found", p->ipn );
-			return 0;		
+			y_log_message( Y_LOG_LEVEL_ERROR, "Could not access subproject for project %d. NULL pointer found", p->ipn );
+			goto done;
+		}
+		struct proj_t* sub = p->sub[i].prj;
+		subflat[i] = memo_find( m, sub->ipn, sub->ver );
+		if( NULL == subflat[i] ){
+			subflat[i] = explode_proj( sub, m );
+			if( NULL == subflat[i] ){
+				goto done;
+			}
+			if( memo_add( m, sub, subflat[i] ) ){
+				if( m->detached ){
+					free_flat( subflat[i] );
+				}
+				goto done;
+			}
 		}
-		/* Recursively go through subprojects */
-		nitems += get_num_all_proj_items( p->sub[i].prj );
+		stamp = stamp_fold( stamp, subflat[i]->stamp );
+		stamp = stamp_fold( stamp, p->sub[i].q );
 	}
-	return nitems;
-}
 
-/* Retrieve total number of parts used */
-unsigned int get_num_all_proj_items( struct proj_t * p ){
-	unsigned int nitems = 0;
-
-	/* Check if project is valid */
-	if( NULL == p ){
-		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
-		return 0;
+	/* Nothing in the tree changed since last explosion */
+	if( !m->detached && NULL != p->flat && p->flat->stamp == stamp ){
+		flat = p->flat;
+		goto done;
 	}
 
-	/* First get items from all boms in topmost level */
+	/* Lines from boms directly in project */
 	for( unsigned int i = 0; i < p->nboms; i++ ){
-		if( NULL == p->boms || NULL == p->boms[i].bom ){
-			y_log_message( Y_LOG_LEVEL_ERROR, "Could not access project bom for project %d. NULL pointer found", p->ipn );
-			return 0;		
+		struct bom_t* bom = p->boms[i].bom;
+		unsigned int mult = p->boms[i].q ? p->boms[i].q : 1;
+		if( flat_reserve( &c, bom->nitems ) ){
+			goto done;
 		}
-		
-		/* Loop through the BOM for each part */
-		for( unsigned int j = 0; j < p->boms[i].bom->nitems; j++ ){
-			/* Add number used to count */
-			nitems += p->boms[i].bom->line[j].q;
+		for( unsigned int j = 0; j < bom->nitems; j++ ){
+			struct proj_flat_line_t* l = &c.line[c.n++];
+			l->ipn = bom->line[j].ipn;
+			l->q = bom->line[j].q * mult;
+			l->type = bom_line_type( bom, j );
+			l->part = ( NULL != bom->parts ) ? bom->parts[j] : NULL;
 		}
 	}
 
-	/* Next loop through all other subprojects in project */
+	/* Already merged lines from subprojects, scaled by number used per unit */
 	for( unsigned int i = 0; i < p->nsub; i++ ){
-		if( NULL == p->sub || NULL == p->sub[i].prj ){
-			y_log_message( Y_LOG_LEVEL_ERROR, "Could not access project bom for project %d. NULL pointer found", p->ipn );
-			return 0;		
+		unsigned int mult = p->sub[i].q ? p->sub[i].q : 1;
+		if( flat_reserve( &c, subflat[i]->nlines ) ){
+			goto done;
+		}
+		for( unsigned int j = 0; j < subflat[i]->nlines; j++ ){
+			c.line[c.n] = subflat[i]->line[j];
+			c.line[c.n].q *= mult;
+			c.n++;
 		}
-		/* Recursively go through subprojects */
-		nitems += get_num_all_proj_items( p->sub[i].prj );
 	}
-	return nitems;
+
+	flat = flat_merge( &c, stamp );
+	if( NULL != flat && !m->detached ){
+		/* Replace old explosion */
+		free_flat( p->flat );
+		p->flat = flat;
+		y_log_message( Y_LOG_LEVEL_DEBUG, "Exploded project %u into %u unique parts", p->ipn, flat->nlines );
+	}
+
+done:
+	free( c.line );
+	free( subflat );
+	m->depth--;
+	return flat;
 }
 
-/* Return the first part that is the limiting factor for production */
-struct part_t ** get_proj_prod_lim_factor( struct proj_t* p ){
-	unsigned int tmp_total_part = 0;	
-	unsigned int uparts = 0;
-	unsigned int pidx = 0; /* Index for return array */
-	struct part_t** parts = NULL;
+/* Explode project into deduplicated part lines per unit. Result is cached in
+ * the project and rebuilt when any revision in the tree changes */
+struct proj_flat_t* get_proj_flat( struct proj_t * p ){
+	struct flat_memo_t memo = { 0 };
+	struct proj_flat_t* flat = NULL;
 
 	/* Check if project is valid */
 	if( NULL == p ){
@@ -126,70 +315,261 @@ struct part_t ** get_proj_prod_lim_factor( struct proj_t* p ){
 		return NULL;
 	}
 
-	uparts = get_num_all_uniq_proj_items( p );
-	/* Size array to be as large as the number of total parts */
-	parts = calloc( uparts, sizeof( struct part_t *));
+	flat = explode_proj( p, &memo );
+	free( memo.ent );
+	return flat;
+}
 
-	if( NULL == parts ){
-		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; could not allocate memory for part return array", __func__ );
+/* Flatten a single BOM into deduplicated part lines per BOM set, merged the
+ * same way as the BOMs of an exploded project */
+struct proj_flat_t* get_bom_flat( struct bom_t* bom ){
+	struct flat_collect_t c = { 0, 0, NULL };
+	struct proj_flat_t* flat = NULL;
+
+	if( NULL == bom ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
 		return NULL;
 	}
 
+	if( flat_reserve( &c, bom->nitems ) ){
+		return NULL;
+	}
+	for( unsigned int j = 0; j < bom->nitems; j++ ){
+		struct proj_flat_line_t* l = &c.line[c.n++];
+		l->ipn = bom->line[j].ipn;
+		l->q = bom->line[j].q;
+		l->type = bom_line_type( bom, j );
+		l->part = ( NULL != bom->parts ) ? bom->parts[j] : NULL;
+	}
 
-	/* First get items from all boms in topmost level */
-	for( unsigned int i = 0; i < p->nboms; i++ ){
-		if( NULL == p->boms || NULL == p->boms[i].bom ){
-			y_log_message( Y_LOG_LEVEL_ERROR, "Could not access project bom for project %d. NULL pointer found", p->ipn );
-			return 0;		
-		}
-		
-		/* Loop through the BOM for each part */
-		for( unsigned int j = 0; j < p->boms[i].bom->nitems; j++ ){
-			/* Determine if total quantity for part is enough */
-			tmp_total_part = get_part_total_inventory( p->boms[i].bom->parts[j] );
-			if( p->boms[i].bom->line[j].q > tmp_total_part  ){
-				/* Not enough parts, increment index of bad parts and add to
-				 * return array  */
-				parts[pidx] = p->boms[i].bom->parts[j];
-				pidx++;
+	flat = flat_merge( &c, bom->rev );
+	free( c.line );
+	return flat;
+}
 
-			}
-		}
+/* Free flattened BOM from get_bom_flat */
+void free_proj_flat_t( struct proj_flat_t* flat ){
+	free_flat( flat );
+}
+
+/* Get number of all items in project BOM and subprojects */
+unsigned int get_num_all_uniq_proj_items( struct proj_t * p ){
+	struct proj_flat_t* flat = get_proj_flat( p );
+	if( NULL == flat ){
+		return 0;
 	}
+	y_log_message( Y_LOG_LEVEL_DEBUG, "Total unique items in project: %u", flat->nlines );
+	return flat->nlines;
+}
 
-	/* Next loop through all other subprojects in project */
-	for( unsigned int i = 0; i < p->nsub; i++ ){
-		if( NULL == p->sub || NULL == p->sub[i].prj ){
-			y_log_message( Y_LOG_LEVEL_ERROR, "Could not access project bom for project %d. NULL pointer found", p->ipn );
-			return NULL;		
+/* Retrieve total number of single part type used */
+unsigned int get_num_all_proj_type_items( struct proj_t * p, char * ptype ){
+	unsigned int nitems = 0;
+	struct proj_flat_t* flat = get_proj_flat( p );
+	if( NULL == flat || NULL == ptype ){
+		return 0;
+	}
+
+	for( unsigned int i = 0; i < flat->nlines; i++ ){
+		if( !cmp_type( ptype, flat->line[i].type ) ){
+			nitems += flat->line[i].q;
 		}
-		/* Recursively go through subprojects */
-		struct part_t** tmp = get_proj_prod_lim_factor( p->sub[i].prj );
-		/* Append array with array from sub */
-		pidx += ( (sizeof( tmp )) / (sizeof( struct part_t *)) );
-		if( pidx > (sizeof( parts )/sizeof( struct part_t * )) ){
-			y_log_message( Y_LOG_LEVEL_ERROR, "%s: Part index(%d) is larger than array size ", __func__, pidx );
-			return parts;
+	}
+	return nitems;
+}
+
+/* Retrieve total number of parts used */
+unsigned int get_num_all_proj_items( struct proj_t * p ){
+	struct proj_flat_t* flat = get_proj_flat( p );
+	if( NULL == flat ){
+		return 0;
+	}
+	return flat->total;
+}
+
+/* Units that can be built from a single line's stock */
+static unsigned int line_units( unsigned int stock, unsigned int q ){
+	return q ? stock / q : UINT_MAX;
+}
+
+/* Set units of a line and fix up its parents in the min tree */
+static void build_set_units( struct proj_build_t* b, unsigned int idx, unsigned int units ){
+	unsigned int i = idx + b->nlines;
+	b->units[i] = units;
+	for( i >>= 1; i >= 1; i >>= 1 ){
+		b->units[i] = ( b->units[2*i] < b->units[2*i + 1] ) ? b->units[2*i] : b->units[2*i + 1];
+	}
+}
+
+/* Solve buildable units from exploded project and the stock of every part
+ * over all inventory locations into a new solver. Only reads the parts */
+static struct proj_build_t* solve_build( struct proj_flat_t* flat ){
+	struct proj_build_t* b = calloc( 1, sizeof( struct proj_build_t ) );
+	if( NULL == b ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; could not allocate memory for build solver", __func__ );
+		return NULL;
+	}
+	b->stamp = flat->stamp;
+	b->nlines = flat->nlines;
+	b->stock = calloc( b->nlines + 1, sizeof( unsigned int ) );
+	b->units = calloc( 2 * b->nlines + 1, sizeof( unsigned int ) );
+	if( NULL == b->stock || NULL == b->units ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; could not allocate memory for build solver", __func__ );
+		free_build( b );
+		return NULL;
+	}
+
+	/* Leaves, then every parent from the bottom up */
+	for( unsigned int i = 0; i < b->nlines; i++ ){
+		if( NULL != flat->line[i].part ){
+			b->stock[i] = get_part_total_inventory( flat->line[i].part );
 		}
-		y_log_message( Y_LOG_LEVEL_DEBUG, "Subproject size: %d", ( (sizeof( tmp )) / (sizeof( struct part_t *)) ));
-		y_log_message( Y_LOG_LEVEL_DEBUG, "New index: %d", pidx );
-		for( unsigned int i = 0; i < ( (sizeof( tmp )) / (sizeof( struct part_t *)) ); i++ ){
-			parts[pidx] = tmp[i];	
+		b->units[b->nlines + i] = line_units( b->stock[i], flat->line[i].q );
+	}
+	for( unsigned int i = b->nlines; i-- > 1; ){
+		b->units[i] = ( b->units[2*i] < b->units[2*i + 1] ) ? b->units[2*i] : b->units[2*i + 1];
+	}
+	return b;
+}
+
+/* Solve buildable units of project from its exploded BOM and the stock of
+ * every part over all inventory locations. Cached in the project and solved
+ * again only when the exploded project changes */
+struct proj_build_t* get_proj_build( struct proj_t* p ){
+	struct proj_build_t* b = NULL;
+	struct proj_flat_t* flat = get_proj_flat( p );
+	if( NULL == flat ){
+		return NULL;
+	}
+
+	if( NULL != p->build && p->build->stamp == flat->stamp ){
+		return p->build;
+	}
+
+	b = solve_build( flat );
+	if( NULL == b ){
+		return NULL;
+	}
+	b->gen = ( NULL != p->build ) ? p->build->gen + 1 : 0;
+
+	free_build( p->build );
+	p->build = b;
+	return b;
+}
+
+/* Update stock of a single part in the build solver, without solving the
+ * whole project again. Returns 1 if part is not used in project */
+int update_proj_build_stock( struct proj_t* p, const char* type, unsigned int ipn, unsigned int stock ){
+	struct proj_flat_line_t key;
+	struct proj_flat_line_t* line = NULL;
+	struct proj_build_t* b = NULL;
+
+	if( NULL == p || NULL == type ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return -1;
+	}
+
+	b = get_proj_build( p );
+	if( NULL == b ){
+		return -1;
+	}
+
+	/* Exploded lines are sorted by type then ipn */
+	key.type = (char*)type;
+	key.ipn = ipn;
+	line = bsearch( &key, p->flat->line, p->flat->nlines, sizeof( struct proj_flat_line_t ), cmp_proj_flat_line );
+	if( NULL == line ){
+		return 1;
+	}
+
+	unsigned int idx = (unsigned int)( line - p->flat->line );
+	if( b->stock[idx] != stock ){
+		b->stock[idx] = stock;
+		build_set_units( b, idx, line_units( stock, line->q ) );
+		b->gen++;
+	}
+	return 0;
+}
+
+/* Return parts that bind the number of buildable units. Array is terminated
+ * with NULL and must be freed by caller */
+struct part_t ** get_proj_prod_lim_factor( struct proj_t* p ){
+	unsigned int pidx = 0; /* Index for return array */
+	struct part_t** parts = NULL;
+	struct proj_build_t* b = get_proj_build( p );
+	if( NULL == b ){
+		return NULL;
+	}
+
+	/* Size array to be as large as the number of unique parts */
+	parts = calloc( b->nlines + 1, sizeof( struct part_t *) );
+	if( NULL == parts ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; could not allocate memory for part return array", __func__ );
+		return NULL;
+	}
+
+	if( b->nlines > 0 && UINT_MAX != b->units[1] ){
+		for( unsigned int i = 0; i < b->nlines; i++ ){
+			if( b->units[b->nlines + i] == b->units[1] && NULL != p->flat->line[i].part ){
+				parts[pidx++] = p->flat->line[i].part;
+			}
 		}
-		/* Free memory from recursed call */
-		free( tmp );
 	}
-	
-	/* Reallocate to trim allocated size */
-	parts = realloc( parts, sizeof(struct part_t *) * (pidx) );
 
 	return parts;
 }
 
 /* Determine number of units that can be manufacturered with current inventory */
 unsigned int get_proj_prod_nunit( struct proj_t* p ){
+	struct proj_build_t* b = get_proj_build( p );
+	if( NULL == b || 0 == b->nlines || UINT_MAX == b->units[1] ){
+		return 0;
+	}
+	return b->units[1];
+}
+
+/* Get parts with too little stock to build target units. Returns number of
+ * parts short; array is put in short_parts and must be freed by caller */
+unsigned int get_proj_prod_shortfall( struct proj_t* p, unsigned int target, struct proj_shortfall_t** short_parts ){
 	unsigned int n = 0;
+	struct proj_shortfall_t* s = NULL;
+	struct proj_build_t* b = NULL;
+
+	if( NULL == short_parts ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return 0;
+	}
+	*short_parts = NULL;
+
+	b = get_proj_build( p );
+	if( NULL == b || 0 == b->nlines ){
+		return 0;
+	}
+
+	/* Nothing is short */
+	if( b->units[1] >= target ){
+		return 0;
+	}
+
+	s = calloc( b->nlines, sizeof( struct proj_shortfall_t ) );
+	if( NULL == s ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; could not allocate memory for shortfall array", __func__ );
+		return 0;
+	}
+
+	for( unsigned int i = 0; i < b->nlines; i++ ){
+		if( b->units[b->nlines + i] < target ){
+			s[n].part = p->flat->line[i].part;
+			s[n].type = p->flat->line[i].type;
+			s[n].ipn = p->flat->line[i].ipn;
+			s[n].need = p->flat->line[i].q * target;
+			s[n].have = b->stock[i];
+			n++;
+		}
+	}
 
+	*short_parts = s;
+	return n;
 }
 
 /* Get optimal project cost with number of units passed */
@@ -198,38 +578,20 @@ double get_optimal_project_cost( struct proj_t * p, unsigned int units ){
 
 	/* scaled quantity for number of units */
 	unsigned int scaled_q = 0;
+	double line_cost = 0.0;
 
-	/* Check if project is valid */
-	if( NULL == p ){
-		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+	struct proj_flat_t* flat = get_proj_flat( p );
+	if( NULL == flat ){
 		return 0;
 	}
 
-	/* First get items from all boms in topmost level */
-	for( unsigned int i = 0; i < p->nboms; i++ ){
-		if( NULL == p->boms || NULL == p->boms[i].bom ){
-			y_log_message( Y_LOG_LEVEL_ERROR, "Could not access project bom for project %d. NULL pointer found", p->ipn );
-			return 0;		
-		}
-		
-		/* Loop through the BOM for each part */
-		for( unsigned int j = 0; j < p->boms[i].bom->nitems; j++ ){
-			scaled_q = p->boms[i].bom->line[j].q * units;
-			/* Fix the quantity for optimal amount */
-			scaled_q = get_optimal_part_amount( p->boms[i].bom->parts[j], scaled_q );
-			y_log_message( Y_LOG_LEVEL_DEBUG, "Optimal Scaled q: %u", scaled_q );
-			cost += get_optimal_part_cost( p->boms[i].bom->parts[j], scaled_q );
+	for( unsigned int i = 0; i < flat->nlines; i++ ){
+		if( NULL == flat->line[i].part ){
+			continue;
 		}
-	}
-
-	/* Next loop through all other subprojects in project */
-	for( unsigned int i = 0; i < p->nsub; i++ ){
-		if( NULL == p->sub || NULL == p->sub[i].prj ){
-			y_log_message( Y_LOG_LEVEL_ERROR, "Could not access project bom for project %d. NULL pointer found", p->ipn );
-			return 0;		
-		}
-		/* Recursively go through subprojects */
-		cost += get_optimal_project_cost( p->sub[i].prj, units );
+		scaled_q = flat->line[i].q * units;
+		eval_part_price_curve( get_part_price_curve( flat->line[i].part ), &scaled_q, 1, NULL, &line_cost, NULL );
+		cost += line_cost;
 	}
 	return cost;
 }
@@ -240,76 +602,296 @@ double get_exact_project_cost( struct proj_t * p, unsigned int units ){
 
 	/* scaled quantity for number of units */
 	unsigned int scaled_q = 0;
+	double line_cost = 0.0;
 
-	/* Check if project is valid */
-	if( NULL == p ){
+	struct proj_flat_t* flat = get_proj_flat( p );
+	if( NULL == flat ){
+		return 0;
+	}
+
+	for( unsigned int i = 0; i < flat->nlines; i++ ){
+		if( NULL == flat->line[i].part ){
+			continue;
+		}
+		scaled_q = flat->line[i].q * units;
+		eval_part_price_curve( get_part_price_curve( flat->line[i].part ), &scaled_q, 1, NULL, NULL, &line_cost );
+		cost += line_cost;
+	}
+	return cost;
+}
+
+/* Add exact and optimal cost of exploded lines [start, end) at each of n unit
+ * counts to optimal and exact. Part price curves must already be compiled
+ * when called from more than one thread */
+int sum_proj_flat_cost( struct proj_flat_t* flat, unsigned int start, unsigned int end, const unsigned int* units, unsigned int n, double* optimal, double* exact ){
+	unsigned int* scaled_q = NULL;
+	double* line_opt = NULL;
+	double* line_exact = NULL;
+
+	if( NULL == flat || NULL == units || NULL == optimal || NULL == exact ){
 		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return -1;
+	}
+	if( end > flat->nlines ){
+		end = flat->nlines;
+	}
+	if( 0 == n || start >= end ){
 		return 0;
 	}
 
-	/* First get items from all boms in topmost level */
-	for( unsigned int i = 0; i < p->nboms; i++ ){
-		if( NULL == p->boms || NULL == p->boms[i].bom ){
-			y_log_message( Y_LOG_LEVEL_ERROR, "Could not access project bom for project %d. NULL pointer found", p->ipn );
-			return 0;		
+	/* Scratch space reused for every line */
+	scaled_q = calloc( n, sizeof( unsigned int ) );
+	line_opt = calloc( n, sizeof( double ) );
+	line_exact = calloc( n, sizeof( double ) );
+	if( NULL == scaled_q || NULL == line_opt || NULL == line_exact ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; could not allocate memory for cost sweep", __func__ );
+		free( scaled_q );
+		free( line_opt );
+		free( line_exact );
+		return -1;
+	}
+
+	for( unsigned int i = start; i < end; i++ ){
+		if( NULL == flat->line[i].part ){
+			continue;
+		}
+		for( unsigned int j = 0; j < n; j++ ){
+			scaled_q[j] = flat->line[i].q * units[j];
 		}
-		
-		/* Loop through the BOM for each part */
-		for( unsigned int j = 0; j < p->boms[i].bom->nitems; j++ ){
-			scaled_q = p->boms[i].bom->line[j].q * units;
-			y_log_message( Y_LOG_LEVEL_DEBUG, "Exact scaled q: %u", scaled_q );
-			cost += get_exact_part_cost( p->boms[i].bom->parts[j], scaled_q );
+		eval_part_price_curve( get_part_price_curve( flat->line[i].part ), scaled_q, n, NULL, line_opt, line_exact );
+		for( unsigned int j = 0; j < n; j++ ){
+			optimal[j] += line_opt[j];
+			exact[j] += line_exact[j];
 		}
 	}
 
-	/* Next loop through all other subprojects in project */
-	for( unsigned int i = 0; i < p->nsub; i++ ){
-		if( NULL == p->sub || NULL == p->sub[i].prj ){
-			y_log_message( Y_LOG_LEVEL_ERROR, "Could not access project bom for project %d. NULL pointer found", p->ipn );
-			return 0;		
+	free( scaled_q );
+	free( line_opt );
+	free( line_exact );
+	return 0;
+}
+
+/* Get optimal and exact project cost for each of n unit counts in a single
+ * pass over the exploded project */
+int get_project_cost_sweep( struct proj_t * p, const unsigned int* units, unsigned int n, double* optimal, double* exact ){
+	struct proj_flat_t* flat = get_proj_flat( p );
+	if( NULL == flat || NULL == optimal || NULL == exact ){
+		return -1;
+	}
+
+	for( unsigned int j = 0; j < n; j++ ){
+		optimal[j] = 0.0;
+		exact[j] = 0.0;
+	}
+	return sum_proj_flat_cost( flat, 0, flat->nlines, units, n, optimal, exact );
+}
+
+/* Combined revision of every part in exploded project */
+static unsigned long flat_part_stamp( struct proj_flat_t* flat ){
+	unsigned long stamp = (unsigned long)STAMP_BASIS;
+	for( unsigned int i = 0; i < flat->nlines; i++ ){
+		if( NULL != flat->line[i].part ){
+			stamp = stamp_fold( stamp, flat->line[i].part->rev + 1 );
 		}
-		/* Recursively go through subprojects */
-		cost += get_exact_project_cost( p->sub[i].prj, units );
 	}
-	return cost;
+	return stamp;
+}
+
+/* Count parts of exploded project by status into s. Only reads the parts */
+static void count_stats( struct proj_flat_t* flat, unsigned long part_stamp, struct proj_stats_t* s ){
+	memset( s, 0, sizeof( struct proj_stats_t ) );
+
+	s->stamp = flat->stamp;
+	s->part_stamp = part_stamp;
+	s->nunique = flat->nlines;
+	s->ntotal = flat->total;
+	for( unsigned int i = 0; i < flat->nlines; i++ ){
+		struct part_t* part = flat->line[i].part;
+		if( NULL == part ){
+			s->nmissing++;
+		}
+		else if( part->status >= 0 && part->status < pstat_total ){
+			s->status[part->status]++;
+		}
+	}
+}
+
+/* Count parts of exploded project by status in a single pass. Cached in the
+ * project; counted again when the exploded project or any part revision
+ * changes */
+struct proj_stats_t* get_proj_stats( struct proj_t* p ){
+	struct proj_stats_t* s = NULL;
+	unsigned long part_stamp = 0;
+	struct proj_flat_t* flat = get_proj_flat( p );
+	if( NULL == flat ){
+		return NULL;
+	}
+
+	part_stamp = flat_part_stamp( flat );
+	if( NULL != p->stats && p->stats->stamp == flat->stamp && p->stats->part_stamp == part_stamp ){
+		return p->stats;
+	}
+
+	s = p->stats;
+	if( NULL == s ){
+		s = calloc( 1, sizeof( struct proj_stats_t ) );
+		if( NULL == s ){
+			y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; could not allocate memory for project stats", __func__ );
+			return NULL;
+		}
+		p->stats = s;
+	}
+	count_stats( flat, part_stamp, s );
+	y_log_message( Y_LOG_LEVEL_DEBUG, "Counted part status of project %u over %u parts", p->ipn, s->nunique );
+	return s;
 }
 
 /* Retrieve total number of supplied part status */
 unsigned int get_num_proj_partstatus( struct proj_t * p, enum part_status_t status ){
-	unsigned int nitems = 0;
+	struct proj_stats_t* s = get_proj_stats( p );
+	if( NULL == s || status < 0 || status >= pstat_total ){
+		return 0;
+	}
+	return s->status[status];
+}
 
+/* Explode project and its subprojects without writing to any of them. Only
+ * reads the tree, so can run on another thread as long as the tree is not
+ * freed. Returns NULL on failure */
+struct proj_hydrate_t* hydrate_proj_flat( struct proj_t* p ){
+	struct flat_memo_t memo = { 0 };
+	struct proj_hydrate_t* h = NULL;
 
-	/* Check if project is valid */
 	if( NULL == p ){
 		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
-		return 0;
+		return NULL;
 	}
 
-	/* First get items from all boms in topmost level */
-	for( unsigned int i = 0; i < p->nboms; i++ ){
-		if( NULL == p->boms || NULL == p->boms[i].bom ){
-			y_log_message( Y_LOG_LEVEL_ERROR, "Could not access project bom for project %d. NULL pointer found", p->ipn );
-			return 0;		
-		}
-		
-		/* Loop through the BOM for each part */
-		for( unsigned int j = 0; j < p->boms[i].bom->nitems; j++ ){
-			/* Check if status matches */
-			if( p->boms[i].bom->parts[j]->status == status ){
-				nitems++;
+	h = calloc( 1, sizeof( struct proj_hydrate_t ) );
+	if( NULL == h ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; could not allocate memory for project hydration", __func__ );
+		return NULL;
+	}
+	h->prj = p;
+
+	memo.detached = 1;
+	h->flat = explode_proj( p, &memo );
+
+	/* Subproject explosions move over from the memo */
+	if( NULL != h->flat && memo.n > 0 ){
+		h->sub = calloc( memo.n, sizeof( struct proj_t* ) );
+		h->subflat = calloc( memo.n, sizeof( struct proj_flat_t* ) );
+		if( NULL == h->sub || NULL == h->subflat ){
+			y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; could not allocate memory for subproject explosions", __func__ );
+			free( h->sub );
+			free( h->subflat );
+			h->sub = NULL;
+			h->subflat = NULL;
+			free_flat( h->flat );
+			h->flat = NULL;
+		}
+		else {
+			for( unsigned int i = 0; i < memo.n; i++ ){
+				h->sub[i] = memo.ent[i].prj;
+				h->subflat[i] = memo.ent[i].flat;
+				memo.ent[i].flat = NULL;
 			}
+			h->nsub = memo.n;
 		}
 	}
+	for( unsigned int i = 0; i < memo.n; i++ ){
+		free_flat( memo.ent[i].flat );
+	}
+	free( memo.ent );
 
-	/* Next loop through all other subprojects in project */
-	for( unsigned int i = 0; i < p->nsub; i++ ){
-		if( NULL == p->sub || NULL == p->sub[i].prj ){
-			y_log_message( Y_LOG_LEVEL_ERROR, "Could not access project bom for project %d. NULL pointer found", p->ipn );
-			return 0;		
+	if( NULL == h->flat ){
+		free_proj_hydrate_t( h );
+		return NULL;
+	}
+	return h;
+}
+
+/* Solve buildable units of hydrated project. Only reads the parts */
+int hydrate_proj_build( struct proj_hydrate_t* h ){
+	if( NULL == h || NULL == h->flat ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return -1;
+	}
+	free_build( h->build );
+	h->build = solve_build( h->flat );
+	return ( NULL != h->build ) ? 0 : -1;
+}
+
+/* Count parts of hydrated project by status. Only reads the parts */
+int hydrate_proj_stats( struct proj_hydrate_t* h ){
+	if( NULL == h || NULL == h->flat ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return -1;
+	}
+	if( NULL == h->stats ){
+		h->stats = calloc( 1, sizeof( struct proj_stats_t ) );
+		if( NULL == h->stats ){
+			y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; could not allocate memory for project stats", __func__ );
+			return -1;
 		}
-		/* Recursively go through subprojects */
-		nitems += get_num_proj_partstatus( p->sub[i].prj, status );
 	}
+	count_stats( h->flat, flat_part_stamp( h->flat ), h->stats );
+	return 0;
+}
 
-	return nitems;
+/* Attach hydrated results to the project and its subprojects. Anything the
+ * project already has for the same stamps is kept, so pointers held from
+ * earlier frames stay valid. Whatever is attached is taken out of h */
+int attach_proj_hydrate( struct proj_hydrate_t* h ){
+	struct proj_t* p = NULL;
+
+	if( NULL == h || NULL == h->prj || NULL == h->flat ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return -1;
+	}
+	p = h->prj;
+
+	for( unsigned int i = 0; i < h->nsub; i++ ){
+		struct proj_t* sub = h->sub[i];
+		if( NULL != sub->flat && sub->flat->stamp == h->subflat[i]->stamp ){
+			continue;
+		}
+		free_flat( sub->flat );
+		sub->flat = h->subflat[i];
+		h->subflat[i] = NULL;
+	}
+
+	if( NULL == p->flat || p->flat->stamp != h->flat->stamp ){
+		free_flat( p->flat );
+		p->flat = h->flat;
+		h->flat = NULL;
+	}
+	if( NULL != h->build && ( NULL == p->build || p->build->stamp != p->flat->stamp ) ){
+		h->build->gen = ( NULL != p->build ) ? p->build->gen + 1 : 0;
+		free_build( p->build );
+		p->build = h->build;
+		h->build = NULL;
+	}
+	if( NULL != h->stats && ( NULL == p->stats || p->stats->stamp != h->stats->stamp || p->stats->part_stamp != h->stats->part_stamp ) ){
+		free( p->stats );
+		p->stats = h->stats;
+		h->stats = NULL;
+	}
+	y_log_message( Y_LOG_LEVEL_DEBUG, "Hydrated project %u with %u unique parts", p->ipn, p->flat->nlines );
+	return 0;
+}
+
+/* Free hydration results; the projects are not touched */
+void free_proj_hydrate_t( struct proj_hydrate_t* h ){
+	if( NULL != h ){
+		for( unsigned int i = 0; i < h->nsub; i++ ){
+			free_flat( h->subflat[i] );
+		}
+		free( h->sub );
+		free( h->subflat );
+		free_flat( h->flat );
+		free_build( h->build );
+		free( h->stats );
+		free( h );
+	}
 }
@@ -0,0 +1,278 @@
+#include <stockhist.h>
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+
+/* Largest-Triangle-Three-Buckets. First and last points are kept, the rest
+ * are split into buckets and the point of each bucket making the largest
+ * triangle with the previous pick and the average of the next bucket is kept */
+static void lttb( const double* x, const double* y, unsigned int n, unsigned int threshold, std::vector<double>* ox, std::vector<double>* oy ){
+	ox->clear();
+	oy->clear();
+	if( threshold < 3 || threshold >= n ){
+		ox->assign( x, x + n );
+		oy->assign( y, y + n );
+		return;
+	}
+
+	ox->reserve( threshold );
+	oy->reserve( threshold );
+	double every = (double)( n - 2 ) / (double)( threshold - 2 );
+	unsigned int a = 0;
+	ox->push_back( x[0] );
+	oy->push_back( y[0] );
+
+	for( unsigned int i = 0; i < threshold - 2; i++ ){
+		/* Average of next bucket; the last point for the final bucket */
+		unsigned int avg_start = (unsigned int)( ( i + 1 ) * every ) + 1;
+		unsigned int avg_end = (unsigned int)( ( i + 2 ) * every ) + 1;
+		if( avg_end > n ){
+			avg_end = n;
+		}
+		double avg_x = 0.0;
+		double avg_y = 0.0;
+		for( unsigned int j = avg_start; j < avg_end; j++ ){
+			avg_x += x[j];
+			avg_y += y[j];
+		}
+		avg_x /= (double)( avg_end - avg_start );
+		avg_y /= (double)( avg_end - avg_start );
+
+		/* Point of this bucket with the largest triangle */
+		unsigned int start = (unsigned int)( i * every ) + 1;
+		unsigned int end = (unsigned int)( ( i + 1 ) * every ) + 1;
+		double max_area = -1.0;
+		unsigned int next = start;
+		for( unsigned int j = start; j < end; j++ ){
+			double area = fabs( ( x[a] - avg_x ) * ( y[j] - y[a] ) - ( x[a] - x[j] ) * ( avg_y - y[a] ) );
+			if( area > max_area ){
+				max_area = area;
+				next = j;
+			}
+		}
+		ox->push_back( x[next] );
+		oy->push_back( y[next] );
+		a = next;
+	}
+
+	ox->push_back( x[n - 1] );
+	oy->push_back( y[n - 1] );
+}
+
+/* Private functions for operations */
+
+/* Build step line of stock level from recorded changes, working back from
+ * current stock. Changes of every part are used if all is set, otherwise only
+ * those of ipn */
+void Stockhist::_steps( bool all, unsigned int ipn, long long stock, struct stockhist_series_t* s ){
+	long long level = stock;
+
+	s->t.clear();
+	s->q.clear();
+	s->view_valid = false;
+
+	/* Level before the first recorded change */
+	for( auto& e : events ){
+		if( all || e.ipn == ipn ){
+			level -= e.delta;
+		}
+	}
+
+	for( auto& e : events ){
+		if( !all && e.ipn != ipn ){
+			continue;
+		}
+		s->t.push_back( e.t );
+		s->q.push_back( (double)level );
+		level += e.delta;
+		s->t.push_back( e.t );
+		s->q.push_back( (double)level );
+	}
+
+	/* Carry current level up to now */
+	if( !s->t.empty() ){
+		double now = (double)time( nullptr );
+		s->t.push_back( ( now > s->t.back() ) ? now : s->t.back() );
+		s->q.push_back( (double)level );
+	}
+}
+
+/* Swap in history read on the task pool and build level of whole type from
+ * its stock when the read started. Runs on the UI thread */
+void Stockhist::_loaded( unsigned int seq, bool ok, struct stock_event_t* ev, unsigned int n, long long stock ){
+	/* Another part type was picked while reading */
+	if( seq != load_seq ){
+		return;
+	}
+	loading = false;
+	if( !ok ){
+		return;
+	}
+
+	events.assign( ev, ev + n );
+	_steps( true, 0, stock, &type_series );
+	loaded = true;
+	y_log_message( Y_LOG_LEVEL_DEBUG, "Stock history of %s has %u changes", type.c_str(), n );
+}
+
+/* Public functions */
+
+Stockhist::Stockhist(){
+	loaded = false;
+	loading = false;
+	load_seq = 0;
+	part_ipn = 0;
+	part_stock = 0;
+	have_part = false;
+	type_series.view_valid = false;
+	part_series.view_valid = false;
+}
+
+Stockhist::~Stockhist(){
+	cache_changes.purge( this );
+}
+
+/* Start reading stock history of the cache's part type on the task pool; its
+ * level is built once the history is swapped in. Part level is cleared */
+int Stockhist::load( class Partcache* cache ){
+	if( nullptr == cache ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return -1;
+	}
+
+	type = cache->type;
+	events.clear();
+	type_series.t.clear();
+	type_series.q.clear();
+	type_series.view_valid = false;
+	part_series.t.clear();
+	part_series.q.clear();
+	part_series.view_valid = false;
+	have_part = false;
+	loaded = false;
+
+	/* Current stock of whole type */
+	long long stock = 0;
+	for( unsigned int i = 0; i < cache->items(); i++ ){
+		struct part_t* p = cache->read( i );
+		if( nullptr != p ){
+			stock += get_part_total_inventory( p );
+		}
+	}
+
+	/* Results of an earlier read are dropped */
+	cache_changes.purge( this );
+	unsigned int seq = ++load_seq;
+	loading = true;
+
+	std::string t = type;
+	int retval = task_pool.submit( [this, t, seq, stock](){
+		struct stock_event_t* ev = nullptr;
+		unsigned int n = 0;
+		bool ok = ( 0 == redis_read_stock_history( t.c_str(), &ev, &n ) );
+		cache_changes.push( this,
+			[this, seq, ok, ev, n, stock](){
+				_loaded( seq, ok, ev, n, stock );
+				free( ev );
+			},
+			[ev](){
+				free( ev );
+			} );
+	});
+	if( retval ){
+		loading = false;
+		y_log_message( Y_LOG_LEVEL_ERROR, "Could not start reading stock history of %s", type.c_str() );
+		return -1;
+	}
+	return 0;
+}
+
+/* Build level of single part from the loaded history; only rebuilt when the
+ * part or its stock changed. NULL clears the part */
+int Stockhist::set_part( struct part_t* p ){
+	if( nullptr == p || nullptr == p->type || !loaded || type != p->type ){
+		have_part = false;
+		return 0;
+	}
+
+	unsigned int stock = get_part_total_inventory( p );
+	if( have_part && p->ipn == part_ipn && stock == part_stock ){
+		return 0;
+	}
+
+	_steps( false, p->ipn, stock, &part_series );
+	part_ipn = p->ipn;
+	part_stock = stock;
+	have_part = true;
+	return 0;
+}
+
+bool Stockhist::is_loaded( void ){
+	return loaded;
+}
+
+/* History is still being read */
+bool Stockhist::is_loading( void ){
+	return loading;
+}
+
+const std::string& Stockhist::get_type( void ){
+	return type;
+}
+
+/* Number of recorded changes loaded */
+unsigned int Stockhist::size( void ){
+	return events.size();
+}
+
+/* Level of whole part type; NULL if nothing was recorded */
+struct stockhist_series_t* Stockhist::get_type_series( void ){
+	if( !loaded || type_series.t.empty() ){
+		return nullptr;
+	}
+	return &type_series;
+}
+
+/* Level of selected part; NULL if no part is set or nothing was recorded */
+struct stockhist_series_t* Stockhist::get_part_series( void ){
+	if( !have_part || part_series.t.empty() ){
+		return nullptr;
+	}
+	return &part_series;
+}
+
+unsigned int stockhist_view( struct stockhist_series_t* s, double x_min, double x_max, unsigned int width ){
+	if( nullptr == s ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return 0;
+	}
+
+	if( s->view_valid && s->view_min == x_min && s->view_max == x_max && s->view_width == width ){
+		return s->view_t.size();
+	}
+
+	/* Keep one point either side so lines reach the edges */
+	unsigned int n = s->t.size();
+	unsigned int lo = std::lower_bound( s->t.begin(), s->t.end(), x_min ) - s->t.begin();
+	unsigned int hi = std::upper_bound( s->t.begin(), s->t.end(), x_max ) - s->t.begin();
+	if( lo > 0 ){
+		lo--;
+	}
+	if( hi < n ){
+		hi++;
+	}
+
+	if( lo < hi ){
+		lttb( &s->t[lo], &s->q[lo], hi - lo, width, &s->view_t, &s->view_q );
+	}
+	else {
+		s->view_t.clear();
+		s->view_q.clear();
+	}
+
+	s->view_min = x_min;
+	s->view_max = x_max;
+	s->view_width = width;
+	s->view_valid = true;
+	return s->view_t.size();
+}
@@ -0,0 +1,67 @@
+#include <tablesort.h>
+#include <algorithm>
+
+/* Fill perm with the display order of n rows, sorted by every column in the
+ * table sort specs. Large tables are sorted in chunks on the task pool, then
+ * merged pairwise; both steps are stable */
+void tablesort_perm( std::vector<unsigned int>* perm, unsigned int n, const ImGuiTableSortSpecs* specs, tablesort_cmp_t cmp ){
+	if( nullptr == perm ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "In: %s; NULL pointer passed", __func__ );
+		return;
+	}
+
+	perm->resize( n );
+	for( unsigned int i = 0; i < n; i++ ){
+		(*perm)[i] = i;
+	}
+	if( nullptr == specs || 0 == specs->SpecsCount || n < 2 ){
+		return;
+	}
+
+	/* Order on first column that differs */
+	auto less = [specs, &cmp]( unsigned int a, unsigned int b ){
+		for( int i = 0; i < specs->SpecsCount; i++ ){
+			const ImGuiTableColumnSortSpecs* s = &specs->Specs[i];
+			int c = cmp( a, b, s->ColumnIndex );
+			if( 0 != c ){
+				return ( ImGuiSortDirection_Descending == s->SortDirection ) ? c > 0 : c < 0;
+			}
+		}
+		return false;
+	};
+
+	unsigned int* data = perm->data();
+	if( n < TABLESORT_PARALLEL_MIN ){
+		std::stable_sort( data, data + n, less );
+		return;
+	}
+
+	/* Sort chunks on the task pool */
+	unsigned int nchunks = task_pool.size() + 1;
+	std::vector<unsigned int> bound( nchunks + 1 );
+	for( unsigned int c = 0; c <= nchunks; c++ ){
+		bound[c] = (unsigned int)( (unsigned long long)n * c / nchunks );
+	}
+	task_pool.parallel_for( nchunks, 1, [&]( unsigned int start, unsigned int end ){
+		for( unsigned int c = start; c < end; c++ ){
+			std::stable_sort( data + bound[c], data + bound[c + 1], less );
+		}
+	});
+
+	/* Merge neighbouring chunks until one is left; the left chunk always
+	 * holds earlier rows, so merging keeps ties in order */
+	for( unsigned int width = 1; width < nchunks; width *= 2 ){
+		unsigned int npairs = ( nchunks + 2 * width - 1 ) / ( 2 * width );
+		task_pool.parallel_for( npairs, 1, [&]( unsigned int start, unsigned int end ){
+			for( unsigned int p = start; p < end; p++ ){
+				unsigned int lo = p * 2 * width;
+				unsigned int mid = std::min( lo + width, nchunks );
+				unsigned int hi = std::min( lo + 2 * width, nchunks );
+				if( mid < hi ){
+					std::inplace_merge( data + bound[lo], data + bound[mid], data + bound[hi], less );
+				}
+			}
+		});
+	}
+	y_log_message( Y_LOG_LEVEL_DEBUG, "Sorted %u table rows in %u chunks", n, nchunks );
+}
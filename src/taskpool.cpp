@@ -0,0 +1,129 @@
+#include <taskpool.h>
+
+/* Workers shared by analytics */
+class Taskpool task_pool( TASKPOOL_THREADS );
+
+/* Private functions for operations; NOT THREAD SAFE. USE MUTEX IN CALLED
+ * FUNCTION */
+
+/* Start workers if not running yet */
+void Taskpool::_start( void ){
+	if( !workers.empty() || stop ){
+		return;
+	}
+	unsigned int n = nthreads;
+	if( 0 == n ){
+		n = std::thread::hardware_concurrency();
+	}
+	if( 0 == n ){
+		n = 1;
+	}
+	for( unsigned int i = 0; i < n; i++ ){
+		workers.emplace_back( &Taskpool::_worker, this );
+	}
+	y_log_message( Y_LOG_LEVEL_DEBUG, "Started %u task pool workers", n );
+}
+
+/* Run tasks until pool is shut down */
+void Taskpool::_worker( void ){
+	for( ;; ){
+		std::function<void(void)> task;
+		{
+			std::unique_lock<std::mutex> lock( cmtx );
+			cv.wait( lock, [this]{ return stop || !tasks.empty(); } );
+			if( tasks.empty() ){
+				/* Only reached when stopping */
+				return;
+			}
+			task = std::move( tasks.front() );
+			tasks.pop_front();
+		}
+		task();
+	}
+}
+
+/* Public functions */
+
+Taskpool::Taskpool( unsigned int threads ){
+	nthreads = threads;
+	stop = false;
+}
+
+/* Destructor; finishes queued tasks, then joins workers */
+Taskpool::~Taskpool(){
+	cmtx.lock();
+	stop = true;
+	cmtx.unlock();
+	cv.notify_all();
+	for( auto& w : workers ){
+		w.join();
+	}
+}
+
+/* Number of workers, starting them if needed */
+unsigned int Taskpool::size( void ){
+	unsigned int n = 0;
+	cmtx.lock();
+	_start();
+	n = workers.size();
+	cmtx.unlock();
+	return n;
+}
+
+/* Queue task to run on a worker */
+int Taskpool::submit( std::function<void(void)> task ){
+	cmtx.lock();
+	if( stop ){
+		cmtx.unlock();
+		y_log_message( Y_LOG_LEVEL_WARNING, "Task pool is shutting down; task not queued" );
+		return -1;
+	}
+	_start();
+	tasks.push_back( std::move( task ) );
+	cmtx.unlock();
+	cv.notify_one();
+	return 0;
+}
+
+/* Split [0, n) into chunks of at least min_chunk and run fn( start, end ) on
+ * each. The calling thread runs the first chunk and returns when all are
+ * done. Must not be called from inside a task */
+void Taskpool::parallel_for( unsigned int n, unsigned int min_chunk, std::function<void(unsigned int, unsigned int)> fn ){
+	if( 0 == n ){
+		return;
+	}
+	if( 0 == min_chunk ){
+		min_chunk = 1;
+	}
+
+	unsigned int nchunks = size() + 1;
+	if( nchunks > (n + min_chunk - 1) / min_chunk ){
+		nchunks = (n + min_chunk - 1) / min_chunk;
+	}
+
+	/* Count of chunks still running on workers */
+	std::mutex done_mtx;
+	std::condition_variable done_cv;
+	unsigned int pending = nchunks - 1;
+
+	for( unsigned int c = 1; c < nchunks; c++ ){
+		unsigned int start = (unsigned int)( (unsigned long long)n * c / nchunks );
+		unsigned int end = (unsigned int)( (unsigned long long)n * (c + 1) / nchunks );
+		auto task = [&, start, end]{
+			fn( start, end );
+			std::lock_guard<std::mutex> lock( done_mtx );
+			if( 0 == --pending ){
+				done_cv.notify_one();
+			}
+		};
+		if( submit( task ) ){
+			/* Pool is going away; do it here instead */
+			task();
+		}
+	}
+
+	fn( 0, (unsigned int)( (unsigned long long)n / nchunks ) );
+
+	std::unique_lock<std::mutex> lock( done_mtx );
+	done_cv.wait( lock, [&]{ return 0 == pending; } );
+}
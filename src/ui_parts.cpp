@@ -5,6 +5,12 @@
 void new_part_window( bool* show, struct dbinfo_t** info ){
 	static struct part_t part;
 	int err_flg = 0;
+	/* Result of last write; window stays open with the entered data on error */
+	static int write_err = 0;
+	/* IPN reserved for a part that could not be written yet, kept for the
+	 * next attempt */
+	static unsigned int reserved_ipn = 0;
+	static std::string reserved_type;
 	/* For entering in dynamic fields */
 	static unsigned int ninfo = 0;
 	static unsigned int nprice = 0;
@@ -259,6 +265,7 @@ void new_part_window( bool* show, struct dbinfo_t** info ){
 
 		/* Save and cancel buttons */
 		if( ImGui::Button("Save", ImVec2(0,0)) ){
+			write_err = 0;
 
 			/* Check if can save first */
 			if( nullptr != (*info) ){
@@ -361,103 +368,80 @@ void new_part_window( bool* show, struct dbinfo_t** info ){
 						part.inv[i].loc = 0;
 					}
 				}
-				unsigned int ptype_idx = dbinfo_get_ptype_index( info, type );
-				struct dbinfo_ptype_t* ptype = nullptr;
-				if( ptype_idx != (unsigned int)(-1) ){
-					mutex_spin_lock_dbinfo();
-					ptype = &((*info)->ptypes[ptype_idx]);
-					mutex_unlock_dbinfo();
+				/* Reserve the next IPN for this type on the server. New part
+				 * types are added to the database at the same time */
+				if( 0 != reserved_ipn && reserved_type != type ){
+					reserved_ipn = 0;
 				}
-	
-				if( nullptr == ptype ){
-					/* Type doesn't exist in database, need to add the new type */
-					y_log_message(Y_LOG_LEVEL_INFO, "Type: %s not found in database. Adding type to database", type);
-
-					/* Should break this out into function */
-					mutex_spin_lock_dbinfo();
-#ifndef _WIN32
-					struct dbinfo_ptype_t* tmp = (struct dbinfo_ptype_t*)reallocarray( (*info)->ptypes, (*info)->nptype + 1, sizeof(struct dbinfo_ptype_t) );
-#else
-					struct dbinfo_ptype_t* tmp = (struct dbinfo_ptype_t*)realloc( (*info)->ptypes, ((*info)->nptype + 1) *  sizeof(struct dbinfo_ptype_t) );
-#endif
-					mutex_unlock_dbinfo();
-					if( nullptr == tmp ){
-						y_log_message(Y_LOG_LEVEL_ERROR, "Could not reallocate memory for new part type");
+				if( !err_flg && 0 == reserved_ipn ){
+					if( redis_alloc_part_ipn( type, 1, &reserved_ipn ) ){
+						y_log_message(Y_LOG_LEVEL_ERROR, "Could not allocate IPN for new part of type %s", type);
+						reserved_ipn = 0;
 						err_flg = 2;
 					}
-					else {
-						mutex_spin_lock_dbinfo();
-						/* Able to reallocate, so continue adding to database  */
-						(*info)->nptype++;	
-						(*info)->ptypes = tmp;
-
-						/* Initialize dbinfo_ptype_t */
-						(*info)->ptypes[(*info)->nptype - 1].name = (char *)calloc( strnlen( type, sizeof( type )) + 1, sizeof( char ) );
-						if( nullptr == (*info)->ptypes[(*info)->nptype - 1].name ){
-							y_log_message(Y_LOG_LEVEL_ERROR, "Could not allocate memory for new database part type");							
-							err_flg = 3;
-							mutex_unlock_dbinfo();
-						}
-						else {
-							/* Copy string */
-							strncpy( (*info)->ptypes[(*info)->nptype - 1].name, type, strnlen( type, sizeof( type )) );	
-
-							/* Ensure that the number of parts is equal to zero */
-							(*info)->ptypes[(*info)->nptype - 1].npart = 0;
-
-							/* Now make sure that ptype is pointed towards new
-							 * index */
-							ptype = &((*info)->ptypes[(*info)->nptype - 1]);
-
-							/* Ensure that database is updated, even if the
-							 * write part fails */
-							redis_write_dbinfo( *info );
-						}
-
-						mutex_unlock_dbinfo();
-					}
-
+					reserved_type = type;
 				}
 				if( !err_flg ) {
-					/* Increment part in dbinfo */
-					ptype->npart++;
-					part.ipn = ptype->npart;
+					/* New part has no revision yet; the one of the last
+					 * part written is still held here */
+					part.ipn = reserved_ipn;
+					part.rev = 0;
 
 					/* Perform the write */
-					redis_write_part( &part );
-					y_log_message(Y_LOG_LEVEL_DEBUG, "Data written to database");
-
+					write_err = redis_write_part( &part );
+					if( write_err ){
+						y_log_message(Y_LOG_LEVEL_ERROR, "Could not write new part %s:%u to database", type, part.ipn);
+					}
+					else {
+						y_log_message(Y_LOG_LEVEL_DEBUG, "Data written to database");
+						reserved_ipn = 0;
 
-					redis_write_dbinfo( *info );
+						/* Read back database information for the new part count */
+						mutex_spin_lock_dbinfo();
+						if( nullptr != (*info) ){
+							free_dbinfo_t( (*info) );
+							free( *info );
+						}
+						*info = redis_read_dbinfo();
+						mutex_unlock_dbinfo();
+					}
 				}
 			}
 			else {
 				y_log_message(Y_LOG_LEVEL_ERROR, "Could not write new part to database");
 			}
-			*show = false;
+			if( 0 != write_err ){
+				/* Leave window open with the entered data */
+				free_part_addr_t( &part );
+				part.rev = 0;
+			}
+			else {
+				*show = false;
 			
-			/* Clear all input data */
+				/* Clear all input data */
 #if 0
-			part.q = 0;
-			part.ipn = 0;
-			part.type = NULL;
-			part.mpn = NULL;
-			part.mfg = NULL;
+				part.q = 0;
+				part.ipn = 0;
+				part.type = NULL;
+				part.mpn = NULL;
+				part.mfg = NULL;
 #endif
-			info_key.clear();
-			info_val.clear();
-			dist_name.clear();
-			dist_pn.clear();
-			price_q.clear();
-			price_cost.clear();
-
-			free_part_addr_t( &part );
+				info_key.clear();
+				info_val.clear();
+				dist_name.clear();
+				dist_pn.clear();
+				price_q.clear();
+				price_cost.clear();
+
+				free_part_addr_t( &part );
+				part.rev = 0;
 	
-			memset( quantity, 0, 127);
-			memset( type, 0, 255 );
-			memset( mfg, 0, 511 );
-			memset( mpn, 0, 511 );
-			y_log_message(Y_LOG_LEVEL_DEBUG, "Cleared out part, finished writing");
+				memset( quantity, 0, 127);
+				memset( type, 0, 255 );
+				memset( mfg, 0, 511 );
+				memset( mpn, 0, 511 );
+				y_log_message(Y_LOG_LEVEL_DEBUG, "Cleared out part, finished writing");
+			}
 
 		}
 		ImGui::SetItemDefaultFocus();
@@ -480,12 +464,20 @@ void new_part_window( bool* show, struct dbinfo_t** info ){
 			price_q.clear();
 			price_cost.clear();
 			free_part_addr_t( &part );
+			part.rev = 0;
+			write_err = 0;
 			memset( quantity, 0, 127);
 			memset( type, 0, 255 );
 			memset( mfg, 0, 511 );
 			memset( mpn, 0, 511 );
 			y_log_message(Y_LOG_LEVEL_DEBUG, "Cleared out part, exiting window");
 		}
+		if( DB_ERR_CONFLICT == write_err ){
+			ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "A part with IPN %u already exists. Part was not saved.", reserved_ipn);
+		}
+		else if( 0 != write_err ){
+			ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "Could not save part to database. Part was not saved.");
+		}
 
 		ImGui::End();
 	}
@@ -495,6 +487,10 @@ void new_part_window( bool* show, struct dbinfo_t** info ){
 void edit_part_window( bool* show, struct part_t* part_in, struct dbinfo_t** info ){
 	static struct part_t* part;
 	static bool first_run = true;
+	/* Part was changed by someone else while being edited */
+	static bool conflict = false;
+	/* Revision edits are written against; part_in is shared and read only */
+	static unsigned int edit_rev = 0;
 	int err_flg = 0;
 
 	/* For entering in dynamic fields */
@@ -562,6 +558,8 @@ void edit_part_window( bool* show, struct part_t* part_in, struct dbinfo_t** inf
 		free( part->mfg );
 
 		selection_idx = (int)part->status;
+		conflict = false;
+		edit_rev = part_in->rev;
 	
 		/* Populate vectors with existing data */
 		for( unsigned int i = 0; i < ninfo; i++ ){
@@ -936,45 +934,81 @@ void edit_part_window( bool* show, struct part_t* part_in, struct dbinfo_t** inf
 				if( !err_flg ) {
 
 					/* Perform the write */
-					redis_write_part( part );
-					y_log_message(Y_LOG_LEVEL_DEBUG, "Data written to database");
+					part->rev = edit_rev;
+					conflict = ( DB_ERR_CONFLICT == redis_write_part( part ) );
+					if( conflict ){
+						/* Keep the edits, but take the latest revision so
+						 * that saving again is a deliberate overwrite. Stock
+						 * is most likely what changed, so the latest is shown
+						 * instead of writing back the stale amounts */
+						struct part_t* latest = get_part_from_ipn( part->type, part->ipn );
+						if( nullptr != latest ){
+							edit_rev = latest->rev;
+							inv_loc.clear();
+							inv_amount.clear();
+							mutex_spin_lock_dbinfo();
+							for( unsigned int i = 0; i < latest->inv_len; i++ ){
+								if( latest->inv[i].loc < (*info)->ninv ){
+									inv_loc.push_back( std::string( (*info)->invs[ latest->inv[i].loc ].name ) );
+								}
+								else {
+									inv_loc.push_back( std::to_string( latest->inv[i].loc ) );
+								}
+								inv_amount.push_back( latest->inv[i].q );
+							}
+							mutex_unlock_dbinfo();
+							ninv = latest->inv_len;
+							free_part_t( latest );
+						}
+					}
+					else {
+						y_log_message(Y_LOG_LEVEL_DEBUG, "Data written to database");
+					}
 				}
 			}
 			else {
 				y_log_message(Y_LOG_LEVEL_ERROR, "Could not write new part to database");
 			}
-			*show = false;
+			if( conflict ){
+				/* Leave window open with the entered data */
+				free_part_t( part );
+				part = nullptr;
+			}
+			else {
+				*show = false;
 			
-			/* Clear all input data */
-			ninfo = 0;
-			nprice = 0;
-			ndist = 0;
-
-			info_key.clear();
-			info_val.clear();
-			dist_name.clear();
-			dist_pn.clear();
-			price_q.clear();
-			price_cost.clear();
-			inv_loc.clear();
-			inv_amount.clear();
-
-			free_part_t( part );
-			part = nullptr;
+				/* Clear all input data */
+				ninfo = 0;
+				nprice = 0;
+				ndist = 0;
+
+				info_key.clear();
+				info_val.clear();
+				dist_name.clear();
+				dist_pn.clear();
+				price_q.clear();
+				price_cost.clear();
+				inv_loc.clear();
+				inv_amount.clear();
+
+				free_part_t( part );
+				part = nullptr;
 	
-			memset( quantity, 0, 127);
-			memset( type, 0, 255 );
-			memset( mfg, 0, 511 );
-			memset( mpn, 0, 511 );
-			selection_idx = 0;
-			y_log_message(Y_LOG_LEVEL_DEBUG, "Cleared out part, finished writing");
-			first_run = true;
+				memset( quantity, 0, 127);
+				memset( type, 0, 255 );
+				memset( mfg, 0, 511 );
+				memset( mpn, 0, 511 );
+				selection_idx = 0;
+				y_log_message(Y_LOG_LEVEL_DEBUG, "Cleared out part, finished writing");
+				first_run = true;
+			}
 
 		}
 		ImGui::SetItemDefaultFocus();
 		ImGui::SameLine();
 		if ( ImGui::Button("Cancel", ImVec2(0, 0) )){
 			*show = false;
+			conflict = false;
 			/* Clear all input data */
 			ninfo = 0;
 			nprice = 0;
@@ -1000,6 +1034,9 @@ void edit_part_window( bool* show, struct part_t* part_in, struct dbinfo_t** inf
 			y_log_message(Y_LOG_LEVEL_DEBUG, "Cleared out part, exiting window");
 			first_run = true;
 		}
+		if( conflict ){
+			ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "Part was changed by someone else. Stock was reloaded; save again to overwrite the rest.");
+		}
 
 		ImGui::End();
 	}
@@ -1,13 +1,37 @@
 #include <ui_projview.h>
 #include <dbstat_def.h>
 #include <implot.h>
+#include <cstring>
+#include <algorithm>
 
 #define PARTINFO_SPACING	200
 
+/* Minimum planned parts priced by each task pool chunk */
+#define PLANNER_LINES_PER_TASK	256
+
+/* Part status labels and their plot positions */
+static const double part_status_positions[pstat_total] = {
+													pstat_unknown,
+													pstat_prod,
+													pstat_low_stock,
+													pstat_unavailable,
+													pstat_nrnd,
+													pstat_lasttimebuy,
+													pstat_obsolete
+												};
+static const char* part_status_str[pstat_total] = { "Unknown",
+													"Production",
+													"Low Stock",
+													"Unavailable",
+													"NRND",
+													"Last Time Buy",
+													"Obsolete"
+												};
+
 static void show_project_select_window( int* db_stat, bool show_all_projects, class Prjcache* cache );
 static void proj_data_window( struct dbinfo_t** info, class Prjcache* cache );
 static void proj_info_tab( struct dbinfo_t** info, struct proj_t* prj, int* bom_index );
-static void proj_bom_tab( struct dbinfo_t** info, struct bom_t* bom );
+static void proj_bom_tab( struct dbinfo_t** info, struct proj_t* prj, struct bom_t* bom, unsigned int gen );
 
 void show_project_view( int * db_stat, struct dbinfo_t** info, bool show_all_projects, class Prjcache* cache, ImGuiTableFlags table_flags ){
 	if( ImGui::BeginTable("view_split", 2, table_flags) ){
@@ -84,6 +108,25 @@ static void show_project_select_window( int* db_stat, bool show_all_projects, cl
 static void proj_data_window( struct dbinfo_t** info, class Prjcache* cache ){
 	static int bom_index = 0;
 	static bom_t* bom = nullptr;
+
+	/* Exploding the project happens on the task pool; show progress until
+	 * the results are swapped in */
+	struct proj_t* prj = cache->get_selected();
+	if( 1 == cache->hydrate( prj ) ){
+		float progress = cache->hydrate_progress( prj );
+		const char* step = "Exploding BOMs";
+		if( progress >= 2.0f / PRJCACHE_HYDRATE_STEPS ){
+			step = "Counting parts";
+		}
+		else if( progress >= 1.0f / PRJCACHE_HYDRATE_STEPS ){
+			step = "Solving buildable units";
+		}
+		ImGui::Text( "%s", prj->name );
+		ImGui::Separator();
+		ImGui::TextDisabled( "Loading project..." );
+		ImGui::ProgressBar( progress, ImVec2( -FLT_MIN, 0.0f ), step );
+		return;
+	}
 	/* Show BOM/Information View */
 	ImGuiTabBarFlags tabbar_flags = ImGuiTabBarFlags_None;
 	if( ImGui::BeginTabBar("Project Info", tabbar_flags ) ){
@@ -103,7 +146,7 @@ static void proj_data_window( struct dbinfo_t** info, class Prjcache* cache ){
 				 * never initialized, can now copy data */
 				bom = copy_bom_t(cache->get_selected()->boms[bom_index].bom);
 			}
-			proj_bom_tab( info, bom );
+			proj_bom_tab( info, cache->get_selected(), bom, cache->generation() );
 			ImGui::EndTabItem();
 		}
 		
@@ -115,8 +158,6 @@ static void proj_data_window( struct dbinfo_t** info, class Prjcache* cache ){
 
 static void proj_info_tab( struct dbinfo_t** info, struct proj_t* prj, int* bom_index ){
 
-	static unsigned int nitems = 0;
-	static unsigned int nunique = 0;
 	static unsigned int nunits = 1;
 	static unsigned int last_nunits = 0;
 	static double cost = 0.0;
@@ -126,44 +167,27 @@ static void proj_info_tab( struct dbinfo_t** info, struct proj_t* prj, int* bom_
 	static double savings_per = 0.0;
 	static unsigned int last_prjipn = 0;
 	static part_t** limiting_parts = nullptr;
-	static int part_status_count[pstat_total] = {0};
-	static const double part_status_positions[pstat_total] = {
-														pstat_unknown,
-														pstat_prod,
-														pstat_low_stock,
-														pstat_unavailable,
-														pstat_nrnd,
-														pstat_lasttimebuy,
-														pstat_obsolete
-													};
-	static const char* part_status_str[pstat_total] = { "Unknown",
-														"Production",
-														"Low Stock",
-														"Unavailable",
-														"NRND",
-														"Last Time Buy",
-														"Obsolete"
-													};
+	static struct proj_shortfall_t* short_parts = nullptr;
+	static unsigned int nshort = 0;
+	static unsigned int nbuildable = 0;
+	static struct proj_build_t* last_build = nullptr;
+	static unsigned int last_build_gen = 0;
+	static unsigned int last_short_nunits = 0;
+	static struct proj_stats_t stats = {};
+	static struct proj_build_t* last_stats_build = nullptr;
+	static unsigned int last_stats_gen = 0;
 
 	/* Check if already retrieved data from this project */
 	if( last_prjipn != prj->ipn ){
 //		printf("Different project than last time; update values\n");
 		y_log_message( Y_LOG_LEVEL_DEBUG, "Different project than last time, update values" );
-		nitems = get_num_all_proj_items( prj );
-		nunique = get_num_all_uniq_proj_items( prj );
 		/* Force update of price calculation */
 		last_nunits = 0;
 		nunits = 1;
-#if 0
-		if( limiting_parts != nullptr ){
-			free( limiting_parts );
-			limiting_parts = nullptr;
-		}
-		limiting_parts = get_proj_prod_lim_factor( prj );
-#endif
 		last_prjipn = prj->ipn;
 	}
 	if( nunits != last_nunits ){
+		PROF_SCOPE( prof_rollup );
 		y_log_message( Y_LOG_LEVEL_DEBUG, "Updating cost" );
 //		printf("Updating cost\n");
 		optimal_cost = get_optimal_project_cost( prj, nunits );
@@ -172,14 +196,25 @@ static void proj_info_tab( struct dbinfo_t** info, struct proj_t* prj, int* bom_
 		optimal_cost_per = optimal_cost / (double)nunits;
 		savings_per = (cost / (double)(nunits) ) - optimal_cost_per;
 
-		for( unsigned int i = 0; i < (unsigned int)pstat_total; i++ ){
-			part_status_count[i] = get_num_proj_partstatus( prj, (enum part_status_t)i  );
-			printf("Part status count for %s: %u\n", part_status_str[i], part_status_count[i] );
-		}
-
 		last_nunits = nunits;
 	}
 
+	/* Part counters don't depend on units; only counted again when the
+	 * project or its parts change */
+	struct proj_build_t* build = get_proj_build( prj );
+	if( build != last_stats_build || ( nullptr != build && build->gen != last_stats_gen ) ){
+		PROF_SCOPE( prof_rollup );
+		struct proj_stats_t* s = get_proj_stats( prj );
+		if( nullptr != s ){
+			stats = *s;
+		}
+		else {
+			stats = {};
+		}
+		last_stats_build = build;
+		last_stats_gen = ( nullptr != build ) ? build->gen : 0;
+	}
+
 	/* Show information about project with selections for versions etc */
 	ImGui::Text("Project Information Tab");
 	ImGui::Separator();
@@ -223,34 +258,433 @@ static void proj_info_tab( struct dbinfo_t** info, struct proj_t* prj, int* bom_
 //		ImPlot::PlotPieChart( part_status_str, part_status_count, pstat_total, 0.5, 0.5, 0.4, "%.0f", 90, pie_flags);
 		ImPlot::SetupAxes("#","Status",ImPlotAxisFlags_AutoFit,ImPlotAxisFlags_AutoFit);
 		ImPlot::SetupAxisTicks(ImAxis_Y1, part_status_positions, (int)pstat_total, part_status_str);
-		ImPlot::PlotBars("##part_status_plot", part_status_count, (int)pstat_total, 0.4, 0, ImPlotBarsFlags_Horizontal );
+		ImPlot::PlotBars("##part_status_plot", stats.status, (int)pstat_total, 0.4, 0, ImPlotBarsFlags_Horizontal );
+		ImPlot::EndPlot();
+	}
+
+	/* Cost over a range of unit counts; only recomputed when the project or
+	 * range changes */
+	static class Costsweep sweep;
+	static int sweep_max = 1000;
+	static bool sweep_per_unit = true;
+	ImGui::Spacing();
+	ImGui::Text("Cost Curve up to");
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth( 120 );
+	ImGui::InputInt("units##cost_sweep_max", &sweep_max );
+	if( sweep_max < 1 ){
+		sweep_max = 1;
+	}
+	ImGui::SameLine();
+	ImGui::Checkbox("Per unit##cost_sweep_per_unit", &sweep_per_unit );
+	{
+		PROF_SCOPE( prof_rollup );
+		sweep.run( prj, (unsigned int)sweep_max );
+	}
+	if( sweep.size() > 0 && ImPlot::BeginPlot("##project_cost_curve", ImVec2(-1, 250), ImPlotFlags_NoMouseText ) ){
+		ImPlot::SetupAxes("Units", sweep_per_unit ? "Cost per unit" : "Total cost", ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit );
+		ImPlot::PlotLine("Exact", sweep.get_units(), sweep.get_exact( sweep_per_unit ), (int)sweep.size() );
+		ImPlot::PlotLine("Optimal", sweep.get_units(), sweep.get_optimal( sweep_per_unit ), (int)sweep.size() );
+		/* Currently selected number of units */
+		double sel_units = (double)nunits;
+		ImPlot::PlotInfLines("Selected", &sel_units, 1 );
 		ImPlot::EndPlot();
 	}
 
 
 
-	ImGui::Text("Number of unique parts in Project: %d", nunique);
-	ImGui::Text("Number of total parts in Project: %d", nitems);
+	ImGui::Text("Number of unique parts in Project: %u", stats.nunique);
+	ImGui::Text("Number of total parts in Project: %u", stats.ntotal);
+	if( stats.nmissing > 0 ){
+		ImGui::Text("Parts that could not be loaded: %u", stats.nmissing);
+	}
 	ImGui::Text("Total Optimal Cost for %d units: %.2lf", nunits, optimal_cost);
 	ImGui::Text("Total Cost Optimization Savings: %.2lf", savings);
 
 	ImGui::Text("Optimal Cost Per Unit: %.4lf", optimal_cost_per );
 	ImGui::Text("Cost Optimization Savings Per Unit: %.4lf", savings_per );
 
-#if 0
-	if( nullptr != limiting_parts ){
-		ImGui::Text("Number of parts with insufficient inventory: %d", sizeof( limiting_parts ) / sizeof( struct part_t * ) );
+
+	/* Buildable units; only solved again when stock, project or target changes */
+	if( nullptr != build && ( build != last_build || build->gen != last_build_gen || nunits != last_short_nunits ) ){
+		PROF_SCOPE( prof_rollup );
+		if( nullptr != limiting_parts ){
+			free( limiting_parts );
+			limiting_parts = nullptr;
+		}
+		if( nullptr != short_parts ){
+			free( short_parts );
+			short_parts = nullptr;
+		}
+		nbuildable = get_proj_prod_nunit( prj );
+		limiting_parts = get_proj_prod_lim_factor( prj );
+		nshort = get_proj_prod_shortfall( prj, nunits, &short_parts );
+		last_build = build;
+		last_build_gen = build->gen;
+		last_short_nunits = nunits;
+	}
+
+	ImGui::Spacing();
+	ImGui::Text("Buildable units with current inventory: %u", nbuildable );
+	if( nullptr != limiting_parts && nullptr != limiting_parts[0] ){
+		ImGui::Text("Limited by:");
+		ImGui::Indent();
+		for( unsigned int i = 0; nullptr != limiting_parts[i]; i++ ){
+			ImGui::Text("%s", limiting_parts[i]->mpn );
+		}
+		ImGui::Unindent();
+	}
+	if( nshort > 0 ){
+		ImGui::Text("Parts short for %u units: %u", nunits, nshort );
+		ImGui::Indent();
+		for( unsigned int i = 0; i < nshort; i++ ){
+			if( nullptr != short_parts[i].part ){
+				ImGui::Text("%s", short_parts[i].part->mpn );
+			}
+			else {
+				ImGui::Text("%s:%u", short_parts[i].type, short_parts[i].ipn );
+			}
+			ImGui::SameLine( PARTINFO_SPACING );
+			ImGui::Text("Need %u, have %u, short %u", short_parts[i].need, short_parts[i].have, short_parts[i].need - short_parts[i].have );
+		}
+		ImGui::Unindent();
+	}
+}
+
+/* Display record of a BOM line, built once per BOM revision */
+struct bom_row_t {
+	std::string num;				/* Line number label */
+	std::string pn;					/* MPN, or IPN if part could not be loaded */
+	std::string mfg;
+	std::string q;
+	std::string type;
+	struct part_t* part;			/* Part handle; owned by BOM */
+};
+
+/* Fill display record of BOM line */
+static void set_bom_row( struct bom_row_t* row, struct bom_t* bom, unsigned int i ){
+	row->part = ( nullptr != bom->parts ) ? bom->parts[i] : nullptr;
+	row->num = std::to_string( i );
+	row->q = std::to_string( bom->line[i].q );
+	row->type = ( nullptr != bom->line[i].type ) ? bom->line[i].type : "";
+	if( nullptr == row->part ){
+		row->pn = std::to_string( bom->line[i].ipn );
+		row->mfg = "";
+		return;
+	}
+	row->pn = ( nullptr != row->part->mpn ) ? row->part->mpn : "";
+	row->mfg = ( nullptr != row->part->mfg ) ? row->part->mfg : "";
+	if( nullptr != row->part->type ){
+		row->type = row->part->type;
+	}
+}
+
+/* Compare strings that may be NULL; NULL sorts first */
+static int cmp_cstr( const char* a, const char* b ){
+	if( nullptr == a || nullptr == b ){
+		return (nullptr != a) - (nullptr != b);
+	}
+	return strcmp( a, b );
+}
+
+/* Compare BOM lines on a single column of the BOM table */
+static int cmp_bom_line( const struct bom_t* bom, unsigned int a, unsigned int b, int column ){
+	const struct part_t* pa = ( nullptr != bom->parts ) ? bom->parts[a] : nullptr;
+	const struct part_t* pb = ( nullptr != bom->parts ) ? bom->parts[b] : nullptr;
+	switch( column ){
+		case 0:
+			return (a > b) - (a < b);
+		case 1:
+			if( nullptr != pa && nullptr != pb ){
+				return cmp_cstr( pa->mpn, pb->mpn );
+			}
+			return (bom->line[a].ipn > bom->line[b].ipn) - (bom->line[a].ipn < bom->line[b].ipn);
+		case 2:
+			return cmp_cstr( ( nullptr != pa ) ? pa->mfg : nullptr, ( nullptr != pb ) ? pb->mfg : nullptr );
+		case 3:
+			return (bom->line[a].q > bom->line[b].q) - (bom->line[a].q < bom->line[b].q);
+		case 4:
+			return cmp_cstr( bom->line[a].type, bom->line[b].type );
+		default:
+			return 0;
+	}
+}
+
+/* BOM lines sharing part type and manufacturer, totalled once per BOM
+ * revision */
+struct bom_group_t {
+	std::string label;				/* Type and manufacturer */
+	std::string nlines;				/* Unique parts in group */
+	std::string q;					/* Parts per BOM set */
+	double cost;					/* Exact cost of one BOM set */
+	unsigned int start;				/* First part of group */
+	unsigned int end;				/* One past last part of group */
+	bool open;
+};
+
+/* Display record of a part in a group */
+struct bom_group_line_t {
+	std::string pn;					/* MPN, or IPN if part could not be loaded */
+	std::string ipn;
+	std::string q;
+	double cost;					/* Exact cost of one BOM set */
+	struct part_t* part;			/* Part handle; owned by BOM */
+};
+
+/* Manufacturer of flattened line, if its part is loaded */
+static const char* flat_line_mfg( const struct proj_flat_line_t* l ){
+	return ( nullptr != l->part ) ? l->part->mfg : nullptr;
+}
+
+/* Compare flattened lines by type, then manufacturer, then ipn */
+static int cmp_group_line( const struct proj_flat_line_t* a, const struct proj_flat_line_t* b ){
+	int c = cmp_cstr( a->type, b->type );
+	if( 0 == c ){
+		c = cmp_cstr( flat_line_mfg( a ), flat_line_mfg( b ) );
+	}
+	if( 0 == c ){
+		c = (a->ipn > b->ipn) - (a->ipn < b->ipn);
+	}
+	return c;
+}
+
+/* Group BOM by part type and manufacturer. The BOM is flattened so repeated
+ * parts are merged, then lines and groups are priced through the same cost
+ * sum as exploded projects. Groups that were open stay open */
+static void build_bom_groups( struct bom_t* bom, std::vector<struct bom_group_t>* groups, std::vector<struct bom_group_line_t>* lines ){
+	const unsigned int one = 1;
+	std::vector<std::string> open;
+
+	for( auto& g : *groups ){
+		if( g.open ){
+			open.push_back( g.label );
+		}
+	}
+	groups->clear();
+	lines->clear();
+
+	struct proj_flat_t* flat = get_bom_flat( bom );
+	if( nullptr == flat ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "Could not flatten BOM %u for grouping", bom->ipn );
+		return;
+	}
+
+	/* Lines of a group end up next to each other */
+	std::sort( flat->line, flat->line + flat->nlines, []( const struct proj_flat_line_t& a, const struct proj_flat_line_t& b ){
+		return cmp_group_line( &a, &b ) < 0;
+	});
+
+	lines->resize( flat->nlines );
+	for( unsigned int i = 0; i < flat->nlines; i++ ){
+		struct proj_flat_line_t* l = &flat->line[i];
+		struct bom_group_line_t* gl = &(*lines)[i];
+		double optimal = 0.0;
+
+		gl->part = l->part;
+		gl->ipn = std::to_string( l->ipn );
+		gl->q = std::to_string( l->q );
+		gl->pn = ( nullptr != l->part && nullptr != l->part->mpn ) ? l->part->mpn : gl->ipn;
+		gl->cost = 0.0;
+		sum_proj_flat_cost( flat, i, i + 1, &one, 1, &optimal, &gl->cost );
+
+		/* New group wherever type or manufacturer changes */
+		if( 0 == i || cmp_cstr( l->type, flat->line[i - 1].type ) || cmp_cstr( flat_line_mfg( l ), flat_line_mfg( &flat->line[i - 1] ) ) ){
+			struct bom_group_t g = {};
+			const char* mfg = flat_line_mfg( l );
+			g.label = ( nullptr != l->type ) ? l->type : "Unknown";
+			g.label += " / ";
+			g.label += ( nullptr != mfg ) ? mfg : "Unknown";
+			g.start = i;
+			groups->push_back( g );
+		}
+		groups->back().end = i + 1;
+	}
+
+	/* Totals of each group */
+	for( auto& g : *groups ){
+		double optimal = 0.0;
+		unsigned int q = 0;
+		for( unsigned int i = g.start; i < g.end; i++ ){
+			q += flat->line[i].q;
+		}
+		g.nlines = std::to_string( g.end - g.start );
+		g.q = std::to_string( q );
+		g.cost = 0.0;
+		sum_proj_flat_cost( flat, g.start, g.end, &one, 1, &optimal, &g.cost );
+		g.open = ( std::find( open.begin(), open.end(), g.label ) != open.end() );
+	}
+
+	free_proj_flat_t( flat );
+}
+
+/* Hold shared handle of part picked from BOM and open its popup; BOM copy may
+ * be freed while the popup is still open */
+static void bom_select_part( struct part_t** selected_item, struct part_t* part, const char* pn ){
+	ImGui::OpenPopup("PartInfo");
+	y_log_message(Y_LOG_LEVEL_DEBUG, "%s was selected", pn);
+	if( nullptr != *selected_item ){
+		free_part_t( *selected_item );
+	}
+	*selected_item = ref_part_t( part );
+}
+
+/* Popup of part picked from BOM; handle is released once it closes */
+static void bom_part_popup( struct dbinfo_t** info, struct proj_t* prj, struct part_t** selected_item ){
+	/* Keep buildable units current without solving project again */
+	if( partinfo_window( info, selected_item ) && nullptr != *selected_item ){
+		unsigned int stock = get_part_total_inventory( *selected_item );
+		update_proj_build_stock( prj, (*selected_item)->type, (*selected_item)->ipn, stock );
+		/* Other projects using the part pick it up on next update */
+		portfolio.stock_changed( (*selected_item)->type, (*selected_item)->ipn, stock );
+	}
+	if( nullptr != *selected_item && !ImGui::IsPopupOpen( "PartInfo" ) ){
+		free_part_t( *selected_item );
+		*selected_item = nullptr;
+	}
+}
+
+/* BOM grouped by part type and manufacturer, with collapsible groups. gen is
+ * the project cache generation bom was loaded in */
+static void proj_bom_groups( struct dbinfo_t** info, struct proj_t* prj, struct bom_t* bom, unsigned int gen, struct part_t** selected_item ){
+	static ImGuiTableFlags table_flags = ImGuiTableFlags_SizingStretchProp | \
+										 ImGuiTableFlags_Resizable | \
+										 ImGuiTableFlags_NoSavedSettings | \
+										 ImGuiTableFlags_BordersOuter | \
+										 ImGuiTableFlags_ScrollY | \
+										 ImGuiTableFlags_BordersV;
+
+	if( ImGui::BeginTable("BOMGroups", 4, table_flags ) ){
+		ImGui::TableSetupScrollFreeze( 0, 1 );
+		ImGui::TableSetupColumn("Type / Manufacturer");
+		ImGui::TableSetupColumn("Parts");
+		ImGui::TableSetupColumn("Quantity");
+		ImGui::TableSetupColumn("Cost / BOM");
+		ImGui::TableHeadersRow();
+
+		if( nullptr != bom ){
+			static struct bom_t* grp_bom = nullptr;
+			static unsigned int grp_rev = 0;
+			static unsigned int grp_nitems = 0;
+			static unsigned int grp_gen = 0;
+			static unsigned int grp_ipn = 0;
+			static int sel_line = -1;
+			static std::vector<struct bom_group_t> groups;
+			static std::vector<struct bom_group_line_t> lines;
+			/* Rows in view; group g is stored as -(g + 1), parts as their
+			 * index in lines */
+			static std::vector<int> shown;
+			static bool shown_dirty = true;
+
+			/* Grouped and totalled once for this BOM revision. Lines hold
+			 * parts of the BOM, and another BOM or a refresh may reuse its
+			 * address, so ipn and cache generation are checked too */
+			if( bom != grp_bom || bom->ipn != grp_ipn || bom->rev != grp_rev || bom->nitems != grp_nitems || gen != grp_gen ){
+				PROF_SCOPE( prof_rollup );
+				if( bom != grp_bom || bom->ipn != grp_ipn ){
+					groups.clear();
+				}
+				sel_line = -1;
+				build_bom_groups( bom, &groups, &lines );
+				grp_bom = bom;
+				grp_rev = bom->rev;
+				grp_nitems = bom->nitems;
+				grp_gen = gen;
+				grp_ipn = bom->ipn;
+				shown_dirty = true;
+			}
+
+			/* Only rebuilt when a group opens or closes */
+			if( shown_dirty ){
+				shown.clear();
+				for( unsigned int g = 0; g < groups.size(); g++ ){
+					shown.push_back( -(int)g - 1 );
+					if( groups[g].open ){
+						for( unsigned int i = groups[g].start; i < groups[g].end; i++ ){
+							shown.push_back( (int)i );
+						}
+					}
+				}
+				shown_dirty = false;
+			}
+
+			/* Only rows in view are drawn */
+			ImGuiListClipper clipper;
+			clipper.Begin( (int)shown.size() );
+			while( clipper.Step() ){
+				for( int r = clipper.DisplayStart; r < clipper.DisplayEnd; r++ ){
+					ImGui::TableNextRow();
+					ImGui::PushID( r );
+
+					if( shown[r] < 0 ){
+						struct bom_group_t* g = &groups[-shown[r] - 1];
+						ImGui::TableSetColumnIndex(0);
+						ImGui::SetNextItemOpen( g->open );
+						bool open = ImGui::TreeNodeEx( g->label.c_str(), ImGuiTreeNodeFlags_NoTreePushOnOpen | ImGuiTreeNodeFlags_SpanFullWidth );
+						if( open != g->open ){
+							/* Rows change from next frame */
+							g->open = open;
+							shown_dirty = true;
+						}
+
+						ImGui::TableSetColumnIndex(1);
+						ImGui::TextUnformatted( g->nlines.c_str() );
+
+						ImGui::TableSetColumnIndex(2);
+						ImGui::TextUnformatted( g->q.c_str() );
+
+						ImGui::TableSetColumnIndex(3);
+						ImGui::Text("%.2lf", g->cost );
+					}
+					else {
+						int i = shown[r];
+						const struct bom_group_line_t* l = &lines[i];
+						ImGui::TableSetColumnIndex(0);
+						ImGui::Indent();
+						bool clicked = ImGui::Selectable( l->pn.c_str(), sel_line == i, ImGuiSelectableFlags_SpanAllColumns );
+						ImGui::Unindent();
+
+						ImGui::TableSetColumnIndex(1);
+						ImGui::TextUnformatted( l->ipn.c_str() );
+
+						ImGui::TableSetColumnIndex(2);
+						ImGui::TextUnformatted( l->q.c_str() );
+
+						ImGui::TableSetColumnIndex(3);
+						ImGui::Text("%.2lf", l->cost );
+
+						if( clicked && nullptr != l->part ){
+							sel_line = i;
+							bom_select_part( selected_item, l->part, l->pn.c_str() );
+						}
+					}
+
+					ImGui::PopID();
+				}
+			}
+
+			bom_part_popup( info, prj, selected_item );
+		}
+		else{
+			y_log_message(Y_LOG_LEVEL_ERROR, "Issue getting bom for project bom tab");
+		}
+		ImGui::EndTable();
 	}
-#endif
 }
 
-static void proj_bom_tab( struct dbinfo_t** info, struct bom_t* bom ){
+static void proj_bom_tab( struct dbinfo_t** info, struct proj_t* prj, struct bom_t* bom, unsigned int gen ){
 
 	static part_t *selected_item = NULL;	
 
 
 	ImGui::Text("Project BOM Tab");
 
+	static bool grouped = false;
+	ImGui::Checkbox( "Group by type and manufacturer", &grouped );
+	if( grouped ){
+		proj_bom_groups( info, prj, bom, gen, &selected_item );
+		return;
+	}
+
 	/* BOM Specific table view */
 
 	static ImGuiTableFlags table_flags = ImGuiTableFlags_SizingStretchProp | \
@@ -273,66 +707,85 @@ static void proj_bom_tab( struct dbinfo_t** info, struct bom_t* bom ){
 
 		ImGui::TableHeadersRow();
 
-#if 0 
-		/* Sort the bom items list based off of what is currently
-		 * selected for sorting */
-		if(ImGuiTableSortSpecs* bom_sort_specs = ImGui::TableGetSortSpecs()){
-			/* Criteria changed; need to resort */
-			if( bom_sort_specs->SpecsDirty ){
-				if( bom.item.size() > 1 ){
-					//qsort( &bom.item[0], (size_t)bom.item.size(), sizeof( bom.item[0] ) );	
+		if( nullptr != bom ){
+			/* Selected line is kept between frames, and cleared when another
+			 * BOM is shown */
+			static struct bom_t* sel_bom = nullptr;
+			static unsigned int sel_rev = 0;
+			static unsigned int sel_gen = 0;
+			static unsigned int sel_ipn = 0;
+			static int sel_line = -1;
+			static std::vector<struct bom_row_t> rows;
+			static std::vector<unsigned int> order;
+			bool lines_changed = false;
+			/* Rows hold parts of the BOM, and another BOM or a refresh may
+			 * reuse its address, so ipn and cache generation are checked too */
+			if( bom != sel_bom || bom->ipn != sel_ipn || bom->rev != sel_rev || rows.size() != bom->nitems || gen != sel_gen ){
+				if( bom != sel_bom || bom->ipn != sel_ipn ){
+					sel_line = -1;
 				}
-				bom_sort_specs->SpecsDirty = false;
+				/* Build display records once for this BOM revision */
+				rows.resize( bom->nitems );
+				for( unsigned int i = 0; i < bom->nitems; i++ ){
+					set_bom_row( &rows[i], bom, i );
+				}
+				sel_bom = bom;
+				sel_rev = bom->rev;
+				sel_gen = gen;
+				sel_ipn = bom->ipn;
+				lines_changed = true;
 			}
-		}
-#endif
-			
-		if( nullptr != bom ){
-			/* Used for selecting specific item in BOM */
-			bool item_sel[ bom->nitems ] = {};
-			char line_item_label[64]; /* May need to change size at some point */
 
-			for( int i = 0; i < bom->nitems; i++){
-				ImGui::TableNextRow();
+			/* Sort display order when criteria or BOM change; lines stay
+			 * where they are */
+			ImGuiTableSortSpecs* sort_specs = ImGui::TableGetSortSpecs();
+			if( lines_changed || ( nullptr != sort_specs && sort_specs->SpecsDirty ) ){
+				tablesort_perm( &order, bom->nitems, sort_specs, [bom]( unsigned int a, unsigned int b, int column ){
+					return cmp_bom_line( bom, a, b, column );
+				});
+				if( nullptr != sort_specs ){
+					sort_specs->SpecsDirty = false;
+				}
+			}
 
-				/* BOM Line item */
-				ImGui::TableSetColumnIndex(0);
-				/* Selectable line item number */
-				snprintf(line_item_label, 64, "%d", i);
-				ImGui::Selectable(line_item_label, &item_sel[i], ImGuiSelectableFlags_SpanAllColumns);
+			/* Only lines in view are drawn */
+			ImGuiListClipper clipper;
+			clipper.Begin( (int)order.size() );
+			while( clipper.Step() ){
+				for( int r = clipper.DisplayStart; r < clipper.DisplayEnd; r++ ){
+					int i = (int)order[r];
+					const struct bom_row_t* row = &rows[i];
+					ImGui::TableNextRow();
 
-				/* Part number */
-				ImGui::TableSetColumnIndex(1);
-				ImGui::Text("%s", bom->parts[i]->mpn );
+					/* Selectable line item number */
+					ImGui::TableSetColumnIndex(0);
+					bool clicked = ImGui::Selectable( row->num.c_str(), sel_line == i, ImGuiSelectableFlags_SpanAllColumns );
 
-				/* Manufacturer */
-				ImGui::TableSetColumnIndex(2);
-				ImGui::Text("%s", bom->parts[i]->mfg );
+					/* Part number */
+					ImGui::TableSetColumnIndex(1);
+					ImGui::TextUnformatted( row->pn.c_str() );
 
-				/* Quantity */
-				ImGui::TableSetColumnIndex(3);
-				ImGui::Text("%d", bom->line[i].q );
-
-				/* Type */
-				ImGui::TableSetColumnIndex(4);
-				ImGui::Text("%s", bom->parts[i]->type);
-
-				if( item_sel[i] ){
-					/* Open popup for part info */
-					ImGui::OpenPopup("PartInfo");
-					y_log_message(Y_LOG_LEVEL_DEBUG, "%s was selected", bom->parts[i]->mpn);
-#if 0
-					if( nullptr != selected_item ){
-						free_part_t( selected_item );
-						selected_item = nullptr;
+					/* Manufacturer */
+					ImGui::TableSetColumnIndex(2);
+					ImGui::TextUnformatted( row->mfg.c_str() );
+
+					/* Quantity */
+					ImGui::TableSetColumnIndex(3);
+					ImGui::TextUnformatted( row->q.c_str() );
+
+					/* Type */
+					ImGui::TableSetColumnIndex(4);
+					ImGui::TextUnformatted( row->type.c_str() );
+
+					if( clicked && nullptr != row->part ){
+						sel_line = i;
+						/* Open popup for part info */
+						bom_select_part( &selected_item, row->part, row->pn.c_str() );
 					}
-					selected_item = copy_part_t(bom->parts[i]);
-#endif
-					selected_item = bom->parts[i];
 				}
 			}
 
-			partinfo_window( info, selected_item);
+			bom_part_popup( info, prj, &selected_item );
 			
 		}
 		else{
@@ -343,7 +796,25 @@ static void proj_bom_tab( struct dbinfo_t** info, struct bom_t* bom ){
 
 }
 
-void partinfo_window( struct dbinfo_t** info, struct part_t* selected_item){
+/* Change stock at inventory entry of selected part. Shared handles are read
+ * only, so the part is swapped for a copy holding the new stock; caches pick up
+ * the change from the database on their next refresh */
+static bool partinfo_adjust( struct part_t** part, unsigned int i, int delta ){
+	struct part_t* p = copy_part_t( *part );
+	if( nullptr == p ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "Could not copy part %u to change its stock", (*part)->ipn );
+		return false;
+	}
+	p->inv[i].q += delta;
+	inv_coalesce.add( p, p->inv[i].loc, delta );
+	free_part_t( *part );
+	*part = p;
+	return true;
+}
+
+bool partinfo_window( struct dbinfo_t** info, struct part_t** selected){
+	bool stock_changed = false;
+	struct part_t* selected_item = ( nullptr != selected ) ? *selected : nullptr;
 	/* Popup window for Part info */
 	ImVec2 center = ImGui::GetMainViewport()->GetCenter();
 	ImGui::SetNextWindowPos(center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
@@ -401,6 +872,20 @@ void partinfo_window( struct dbinfo_t** info, struct part_t* selected_item){
 				mutex_unlock_dbinfo();
 				ImGui::SameLine(PARTINFO_SPACING); 
 				ImGui::Text("%ld", selected_item->inv[i].q  );
+
+				/* Quick stock adjustments; written out in batches */
+				ImGui::PushID( i );
+				ImGui::SameLine();
+				if( ImGui::SmallButton("-") && selected_item->inv[i].q > 0 && partinfo_adjust( selected, i, -1 ) ){
+					selected_item = *selected;
+					stock_changed = true;
+				}
+				ImGui::SameLine();
+				if( ImGui::SmallButton("+") && partinfo_adjust( selected, i, 1 ) ){
+					selected_item = *selected;
+					stock_changed = true;
+				}
+				ImGui::PopID();
 			}
 			ImGui::Unindent();
 			ImGui::Spacing();
@@ -443,4 +928,385 @@ void partinfo_window( struct dbinfo_t** info, struct part_t* selected_item){
 		ImGui::EndPopup();
 	}
 
+	return stock_changed;
+}
+
+/* Build entered in the production planner; kept by ipn and version since
+ * project pointers change when the cache is refreshed */
+struct planner_row_t {
+	unsigned int ipn;
+	std::string ver;
+	std::string name;
+	int units;
+};
+
+/* Plan results copied out of the projects for display */
+struct planner_build_res_t {
+	std::string name;
+	unsigned int units;
+	unsigned int nbuild;
+	unsigned int nshort;
+	bool found;
+};
+
+struct planner_part_res_t {
+	std::string mpn;
+	std::string type;
+	unsigned int ipn;
+	unsigned int stock;
+	unsigned int demand;
+	unsigned int shortage;
+	unsigned int order_q;
+	double order_cost;
+	double separate_cost;
+};
+
+/* Run planner over the rows. Cache must be locked */
+static double planner_run( class Prjcache* cache, std::vector<struct planner_row_t>* rows, std::vector<struct planner_build_res_t>* build_res, std::vector<struct planner_part_res_t>* part_res, double* separate_cost ){
+	std::vector<struct plan_build_t> builds;
+	std::vector<unsigned int> row_build;
+	double cost = 0.0;
+
+	build_res->clear();
+	part_res->clear();
+	*separate_cost = 0.0;
+
+	/* Find projects for each row */
+	for( unsigned int r = 0; r < rows->size(); r++ ){
+		struct planner_build_res_t res = { (*rows)[r].name + " " + (*rows)[r].ver, (unsigned int)(*rows)[r].units, 0, 0, false };
+		for( unsigned int i = 0; i < cache->items(); i++ ){
+			struct proj_t* p = cache->read( i );
+			if( nullptr != p && p->ipn == (*rows)[r].ipn && (*rows)[r].ver == p->ver ){
+				struct plan_build_t b = { p, (unsigned int)(*rows)[r].units, 0, 0 };
+				row_build.push_back( builds.size() );
+				builds.push_back( b );
+				res.found = true;
+				break;
+			}
+		}
+		if( !res.found ){
+			row_build.push_back( (unsigned int)-1 );
+		}
+		build_res->push_back( res );
+	}
+
+	if( builds.empty() ){
+		return 0.0;
+	}
+
+	struct plan_t* plan = plan_builds( builds.data(), builds.size() );
+	if( nullptr == plan ){
+		y_log_message( Y_LOG_LEVEL_ERROR, "Could not plan builds" );
+		return 0.0;
+	}
+
+	/* Pick order quantities over the combined demand of every build */
+	task_pool.parallel_for( plan->nlines, PLANNER_LINES_PER_TASK, [plan]( unsigned int start, unsigned int end ){
+		plan_purchase_lines( plan, start, end );
+	});
+	plan_purchase_total( plan );
+
+	for( unsigned int r = 0; r < rows->size(); r++ ){
+		if( (unsigned int)-1 != row_build[r] ){
+			(*build_res)[r].nbuild = builds[row_build[r]].nbuild;
+			(*build_res)[r].nshort = builds[row_build[r]].nshort;
+		}
+	}
+
+	part_res->reserve( plan->nshort );
+	for( unsigned int i = 0; i < plan->nlines; i++ ){
+		struct plan_line_t* l = &plan->line[i];
+		if( 0 == l->shortage ){
+			continue;
+		}
+		struct planner_part_res_t res;
+		res.mpn = ( nullptr != l->part && nullptr != l->part->mpn ) ? l->part->mpn : "";
+		res.type = ( nullptr != l->type ) ? l->type : "";
+		res.ipn = l->ipn;
+		res.stock = l->stock;
+		res.demand = l->demand;
+		res.shortage = l->shortage;
+		res.order_q = l->order_q;
+		res.order_cost = l->order_cost;
+		res.separate_cost = l->separate_cost;
+		part_res->push_back( res );
+	}
+	cost = plan->purchase_cost;
+	*separate_cost = plan->separate_cost;
+	free_plan_t( plan );
+	return cost;
+}
+
+/* Plan several builds against shared stock */
+void planner_window( bool* show, class Prjcache* cache ){
+	static std::vector<struct planner_row_t> rows;
+	static std::vector<struct planner_build_res_t> build_res;
+	static std::vector<struct planner_part_res_t> part_res;
+	static double purchase_cost = 0.0;
+	static double separate_cost = 0.0;
+	static bool planned = false;
+	static unsigned int plan_gen = 0;
+	bool run = false;
+
+	ImGui::SetNextWindowSize( ImVec2( 700, 500 ), ImGuiCond_FirstUseEver );
+	if( ImGui::Begin("Production Planner", show ) ){
+		cache->getmutex(true);
+
+		/* Add projects to the plan */
+		if( ImGui::BeginCombo("##planner_add", "Add project") ){
+			for( unsigned int i = 0; i < cache->items(); i++ ){
+				struct proj_t* p = cache->read( i );
+				if( nullptr == p ){
+					continue;
+				}
+				ImGui::PushID( i );
+				char label[128];
+				snprintf( label, sizeof( label ), "%s %s", p->name, p->ver );
+				if( ImGui::Selectable( label ) ){
+					struct planner_row_t row = { p->ipn, p->ver, p->name, 1 };
+					rows.push_back( row );
+				}
+				ImGui::PopID();
+			}
+			ImGui::EndCombo();
+		}
+
+		/* Builds in priority order */
+		static ImGuiTableFlags row_flags = ImGuiTableFlags_BordersOuter | ImGuiTableFlags_BordersV | ImGuiTableFlags_RowBg;
+		if( rows.size() > 0 && ImGui::BeginTable("planner_rows", 4, row_flags ) ){
+			ImGui::TableSetupColumn("Priority", ImGuiTableColumnFlags_WidthFixed );
+			ImGui::TableSetupColumn("Project" );
+			ImGui::TableSetupColumn("Units", ImGuiTableColumnFlags_WidthFixed, 120.0f );
+			ImGui::TableSetupColumn("##planner_actions", ImGuiTableColumnFlags_WidthFixed );
+			ImGui::TableHeadersRow();
+
+			int move_from = -1;
+			int move_to = -1;
+			int remove = -1;
+			for( unsigned int r = 0; r < rows.size(); r++ ){
+				ImGui::PushID( r );
+				ImGui::TableNextRow();
+				ImGui::TableSetColumnIndex(0);
+				ImGui::Text("%u", r + 1 );
+				ImGui::TableSetColumnIndex(1);
+				ImGui::Text("%s %s", rows[r].name.c_str(), rows[r].ver.c_str() );
+				ImGui::TableSetColumnIndex(2);
+				ImGui::SetNextItemWidth( -1 );
+				ImGui::InputInt("##units", &rows[r].units );
+				if( rows[r].units < 0 ){
+					rows[r].units = 0;
+				}
+				ImGui::TableSetColumnIndex(3);
+				if( ImGui::SmallButton("Up") && r > 0 ){
+					move_from = r;
+					move_to = r - 1;
+				}
+				ImGui::SameLine();
+				if( ImGui::SmallButton("Down") && r + 1 < rows.size() ){
+					move_from = r;
+					move_to = r + 1;
+				}
+				ImGui::SameLine();
+				if( ImGui::SmallButton("Remove") ){
+					remove = r;
+				}
+				ImGui::PopID();
+			}
+			ImGui::EndTable();
+
+			if( move_from >= 0 ){
+				std::swap( rows[move_from], rows[move_to] );
+			}
+			if( remove >= 0 ){
+				rows.erase( rows.begin() + remove );
+			}
+		}
+
+		if( ImGui::Button("Plan", ImVec2(120, 0)) ){
+			run = true;
+		}
+		ImGui::SameLine();
+		if( ImGui::Button("Clear", ImVec2(120, 0)) ){
+			rows.clear();
+			build_res.clear();
+			part_res.clear();
+			purchase_cost = 0.0;
+			separate_cost = 0.0;
+			planned = false;
+		}
+
+		/* Plan again when the cache has been refreshed */
+		if( run || ( planned && plan_gen != cache->generation() ) ){
+			PROF_SCOPE( prof_rollup );
+			purchase_cost = planner_run( cache, &rows, &build_res, &part_res, &separate_cost );
+			plan_gen = cache->generation();
+			planned = true;
+		}
+		cache->releasemutex();
+
+		if( planned ){
+			ImGui::Separator();
+			ImGui::Text("Builds");
+			if( ImGui::BeginTable("planner_builds", 4, row_flags ) ){
+				ImGui::TableSetupColumn("Project");
+				ImGui::TableSetupColumn("Wanted");
+				ImGui::TableSetupColumn("Buildable");
+				ImGui::TableSetupColumn("Parts Short");
+				ImGui::TableHeadersRow();
+				for( auto& b : build_res ){
+					ImGui::TableNextRow();
+					ImGui::TableSetColumnIndex(0);
+					ImGui::Text("%s", b.name.c_str() );
+					ImGui::TableSetColumnIndex(1);
+					ImGui::Text("%u", b.units );
+					ImGui::TableSetColumnIndex(2);
+					if( b.found ){
+						ImGui::Text("%u", b.nbuild );
+					}
+					else {
+						ImGui::Text("Not loaded");
+					}
+					ImGui::TableSetColumnIndex(3);
+					ImGui::Text("%u", b.nshort );
+				}
+				ImGui::EndTable();
+			}
+
+			ImGui::Spacing();
+			ImGui::Text("Purchase List: %u parts, %.2lf total", (unsigned int)part_res.size(), purchase_cost );
+			ImGui::Text("Savings against ordering per project: %.2lf", separate_cost - purchase_cost );
+			static ImGuiTableFlags part_flags = row_flags | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable;
+			if( part_res.size() > 0 && ImGui::BeginTable("planner_parts", 8, part_flags ) ){
+				ImGui::TableSetupScrollFreeze( 0, 1 );
+				ImGui::TableSetupColumn("P/N");
+				ImGui::TableSetupColumn("Type");
+				ImGui::TableSetupColumn("Stock");
+				ImGui::TableSetupColumn("Needed");
+				ImGui::TableSetupColumn("Short");
+				ImGui::TableSetupColumn("Order");
+				ImGui::TableSetupColumn("Cost");
+				ImGui::TableSetupColumn("Per Project Cost");
+				ImGui::TableHeadersRow();
+				ImGuiListClipper clipper;
+				clipper.Begin( (int)part_res.size() );
+				while( clipper.Step() ){
+					for( int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++ ){
+						struct planner_part_res_t* l = &part_res[i];
+						ImGui::TableNextRow();
+						ImGui::TableSetColumnIndex(0);
+						ImGui::Text("%s", l->mpn.c_str() );
+						ImGui::TableSetColumnIndex(1);
+						ImGui::Text("%s:%u", l->type.c_str(), l->ipn );
+						ImGui::TableSetColumnIndex(2);
+						ImGui::Text("%u", l->stock );
+						ImGui::TableSetColumnIndex(3);
+						ImGui::Text("%u", l->demand );
+						ImGui::TableSetColumnIndex(4);
+						ImGui::Text("%u", l->shortage );
+						ImGui::TableSetColumnIndex(5);
+						ImGui::Text("%u", l->order_q );
+						ImGui::TableSetColumnIndex(6);
+						ImGui::Text("%.2lf", l->order_cost );
+						ImGui::TableSetColumnIndex(7);
+						ImGui::Text("%.2lf", l->separate_cost );
+					}
+				}
+				ImGui::EndTable();
+			}
+		}
+	}
+	ImGui::End();
+}
+
+/* Cost, buildability and part status of every loaded project */
+void portfolio_window( bool* show, class Prjcache* cache ){
+	static int units = 1;
+	bool force = false;
+
+	ImGui::SetNextWindowSize( ImVec2( 800, 500 ), ImGuiCond_FirstUseEver );
+	if( ImGui::Begin("Portfolio", show ) ){
+		ImGui::Text("Units per project");
+		ImGui::SameLine();
+		ImGui::SetNextItemWidth( 120 );
+		ImGui::InputInt("##portfolio_units", &units );
+		if( units < 1 ){
+			units = 1;
+		}
+		ImGui::SameLine();
+		if( ImGui::Button("Refresh") ){
+			force = true;
+		}
+
+		/* Only changed projects are computed again */
+		cache->getmutex(true);
+		{
+			PROF_SCOPE( prof_rollup );
+			portfolio.update( cache, (unsigned int)units, force );
+		}
+
+		ImGui::Text("%u projects, %.2lf total for %u units each, %u short of parts", portfolio.size(), portfolio.get_optimal_total(), portfolio.get_units(), portfolio.get_nshort_projects() );
+
+		ImGui::Text("Part Status Distribution");
+		if( ImPlot::BeginPlot("##portfolio_status", ImVec2(-1, 150), ImPlotFlags_NoMouseText ) ){
+			ImPlot::SetupAxes("#","Status",ImPlotAxisFlags_AutoFit,ImPlotAxisFlags_AutoFit);
+			ImPlot::SetupAxisTicks(ImAxis_Y1, part_status_positions, (int)pstat_total, part_status_str);
+			ImPlot::PlotBars("##portfolio_status_plot", portfolio.get_status_mix(), (int)pstat_total, 0.4, 0, ImPlotBarsFlags_Horizontal );
+			ImPlot::EndPlot();
+		}
+
+		static ImGuiTableFlags flags = ImGuiTableFlags_BordersOuter | ImGuiTableFlags_BordersV | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable;
+		if( portfolio.size() > 0 && ImGui::BeginTable("portfolio_projects", 8, flags ) ){
+			ImGui::TableSetupScrollFreeze( 0, 1 );
+			ImGui::TableSetupColumn("P/N");
+			ImGui::TableSetupColumn("Project");
+			ImGui::TableSetupColumn("Parts");
+			ImGui::TableSetupColumn("Unit Cost");
+			ImGui::TableSetupColumn("Total Cost");
+			ImGui::TableSetupColumn("Buildable");
+			ImGui::TableSetupColumn("Parts Short");
+			ImGui::TableSetupColumn("At Risk");
+			ImGui::TableHeadersRow();
+			ImGuiListClipper clipper;
+			clipper.Begin( (int)portfolio.size() );
+			while( clipper.Step() ){
+				for( int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++ ){
+					const struct portfolio_row_t* r = portfolio.row( i );
+					if( nullptr == r || nullptr == r->prj ){
+						continue;
+					}
+					ImGui::PushID( i );
+					ImGui::TableNextRow();
+					ImGui::TableSetColumnIndex(0);
+					/* Select project for the project view */
+					if( ImGui::Selectable( r->pn.c_str(), cache->get_selected() == r->prj, ImGuiSelectableFlags_SpanAllColumns ) ){
+						cache->select_ptr( r->prj );
+					}
+					ImGui::TableSetColumnIndex(1);
+					ImGui::Text("%s %s", r->name.c_str(), r->ver.c_str() );
+					if( !r->valid ){
+						ImGui::TableSetColumnIndex(2);
+						ImGui::Text( r->busy ? "Computing..." : "Could not compute" );
+						ImGui::PopID();
+						continue;
+					}
+					ImGui::TableSetColumnIndex(2);
+					ImGui::Text("%u", r->nlines );
+					ImGui::TableSetColumnIndex(3);
+					ImGui::Text("%.4lf", r->optimal_cost / (double)portfolio.get_units() );
+					ImGui::TableSetColumnIndex(4);
+					ImGui::Text("%.2lf", r->optimal_cost );
+					ImGui::TableSetColumnIndex(5);
+					ImGui::Text("%u", r->nbuild );
+					ImGui::TableSetColumnIndex(6);
+					ImGui::Text("%u", r->nshort );
+					ImGui::TableSetColumnIndex(7);
+					ImGui::Text("%u", r->status[pstat_unavailable] + r->status[pstat_nrnd] + r->status[pstat_lasttimebuy] + r->status[pstat_obsolete] );
+					ImGui::PopID();
+				}
+			}
+			ImGui::EndTable();
+		}
+		cache->releasemutex();
+	}
+	ImGui::End();
 }
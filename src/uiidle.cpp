@@ -0,0 +1,55 @@
+#include <uiidle.h>
+#include <GLFW/glfw3.h>
+
+/* Idle control of the main UI loop */
+class Uiidle ui_idle;
+
+Uiidle::Uiidle(){
+	woken = false;
+	ready = false;
+	active_until = std::chrono::steady_clock::now();
+}
+
+Uiidle::~Uiidle(){
+
+}
+
+/* Set once the window exists, and cleared before it is destroyed */
+void Uiidle::set_ready( bool r ){
+	ready_mtx.lock();
+	ready = r;
+	ready_mtx.unlock();
+}
+
+/* Wake the UI thread from any thread, so it draws the next frame */
+void Uiidle::wake( void ){
+	woken = true;
+	ready_mtx.lock();
+	if( ready ){
+		glfwPostEmptyEvent();
+	}
+	ready_mtx.unlock();
+}
+
+/* User is interacting; keep drawing at full rate for a while. UI thread only */
+void Uiidle::active( void ){
+	active_until = std::chrono::steady_clock::now() + std::chrono::milliseconds( UIIDLE_ACTIVE_MS );
+}
+
+/* Handle events, sleeping up to timeout seconds for one when idle. UI thread
+ * only */
+void Uiidle::wait( double timeout ){
+	auto start = std::chrono::steady_clock::now();
+	if( woken.exchange( false ) || start < active_until ){
+		glfwPollEvents();
+		return;
+	}
+
+	glfwWaitEventsTimeout( timeout );
+
+	/* Returned before the timeout, so something happened; let it settle */
+	if( std::chrono::steady_clock::now() - start < std::chrono::duration<double>( timeout ) ){
+		woken = false;
+		active();
+	}
+}